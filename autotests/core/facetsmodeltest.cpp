@@ -0,0 +1,206 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+
+#include "cache.h"
+#include "enginebase.h"
+#include "facetsmodel.h"
+
+using namespace KNSCore;
+
+class FacetsModelTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testSamePageAgain();
+    void testStatusChange();
+    void testFacetDropsToZero();
+
+private:
+    Entry createEntry(const QString &id, const QString &category, const QStringList &tags = {}) const;
+    QString providerId() const;
+    void verifyRows() const;
+
+    EngineBase *engine = nullptr;
+    FacetsModel *model = nullptr;
+};
+
+QString FacetsModelTest::providerId() const
+{
+    return QUrl::fromLocalFile(QStringLiteral(DATA_DIR "facetsmodeltest/feed.xml")).toString();
+}
+
+Entry FacetsModelTest::createEntry(const QString &id, const QString &category, const QStringList &tags) const
+{
+    Entry entry;
+    entry.setProviderId(providerId());
+    entry.setUniqueId(id);
+    entry.setName(id);
+    entry.setCategory(category);
+    entry.setTags(tags);
+    entry.setStatus(Entry::Downloadable);
+    return entry;
+}
+
+// What the rows say must be what count() says, whatever happened to them before
+void FacetsModelTest::verifyRows() const
+{
+    for (int row = 0; row < model->rowCount(); ++row) {
+        const QModelIndex index = model->index(row);
+        const auto kind = FacetsModel::FacetKind(index.data(FacetsModel::KindRole).toInt());
+        const QString value = index.data(FacetsModel::ValueRole).toString();
+        const int count = index.data(FacetsModel::CountRole).toInt();
+        QVERIFY(count > 0);
+        QCOMPARE(model->count(kind, value), count);
+    }
+}
+
+void FacetsModelTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void FacetsModelTest::init()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    QFile::remove(dataPath + QLatin1String("/knewstuff3/facetsmodeltest.knsregistry"));
+    engine = new EngineBase(this);
+    QVERIFY(engine->init(QStringLiteral(DATA_DIR "facetsmodeltest/facetsmodeltest.knsrc")));
+    QSignalSpy loaded(engine, &EngineBase::signalProvidersLoaded);
+    QVERIFY(loaded.wait());
+    QVERIFY(engine->provider(providerId()));
+    QVERIFY(engine->cache()->registry().isEmpty());
+    model = new FacetsModel(this);
+    model->setEngine(engine);
+    QCOMPARE(model->rowCount(), 0);
+}
+
+void FacetsModelTest::cleanup()
+{
+    delete model;
+    model = nullptr;
+    delete engine;
+    engine = nullptr;
+}
+
+void FacetsModelTest::testSamePageAgain()
+{
+    const QSharedPointer<Provider> provider = engine->provider(providerId());
+    const Entry::List entries{
+        createEntry(QStringLiteral("alpha"), QStringLiteral("icons"), {QStringLiteral("dark")}),
+        createEntry(QStringLiteral("beta"), QStringLiteral("icons")),
+    };
+    Provider::SearchRequest request(Provider::Newest, Provider::None, QString(), {}, 0);
+    Q_EMIT provider->loadingFinished(request, entries);
+    QCOMPARE(model->count(FacetsModel::CategoryFacet, QStringLiteral("icons")), 2);
+    QCOMPARE(model->count(FacetsModel::TagFacet, QStringLiteral("dark")), 1);
+    QCOMPARE(model->count(FacetsModel::StatusFacet, QStringLiteral("Downloadable")), 2);
+    QCOMPARE(model->rowCount(), 3);
+
+    // The same entries turning up again, on the same page and on later ones, are not counted again
+    QSignalSpy dataChanged(model, &FacetsModel::dataChanged);
+    QSignalSpy rowsInserted(model, &FacetsModel::rowsInserted);
+    Q_EMIT provider->loadingFinished(request, entries);
+    request.page = 1;
+    Q_EMIT provider->loadingFinished(request, entries);
+    request.page = 2;
+    Q_EMIT provider->loadingFinished(request, {entries.at(1)});
+    QCOMPARE(model->count(FacetsModel::CategoryFacet, QStringLiteral("icons")), 2);
+    QCOMPARE(model->count(FacetsModel::TagFacet, QStringLiteral("dark")), 1);
+    QCOMPARE(model->count(FacetsModel::StatusFacet, QStringLiteral("Downloadable")), 2);
+    QCOMPARE(model->rowCount(), 3);
+    QCOMPARE(dataChanged.count(), 0);
+    QCOMPARE(rowsInserted.count(), 0);
+    verifyRows();
+}
+
+void FacetsModelTest::testStatusChange()
+{
+    const QSharedPointer<Provider> provider = engine->provider(providerId());
+    Entry alpha = createEntry(QStringLiteral("alpha"), QStringLiteral("icons"));
+    const Entry beta = createEntry(QStringLiteral("beta"), QStringLiteral("icons"));
+    Q_EMIT provider->loadingFinished(Provider::SearchRequest(Provider::Newest, Provider::None, QString(), {}, 0), {alpha, beta});
+    QCOMPARE(model->count(FacetsModel::StatusFacet, QStringLiteral("Downloadable")), 2);
+    QCOMPARE(model->count(FacetsModel::StatusFacet, QStringLiteral("Installed")), 0);
+
+    // Installing alpha moves it from one status to the other, and leaves its category alone
+    QSignalSpy rowsInserted(model, &FacetsModel::rowsInserted);
+    alpha.setStatus(Entry::Installed);
+    engine->cache()->registerChangedEntry(alpha);
+    QCOMPARE(model->count(FacetsModel::StatusFacet, QStringLiteral("Downloadable")), 1);
+    QCOMPARE(model->count(FacetsModel::StatusFacet, QStringLiteral("Installed")), 1);
+    QCOMPARE(model->count(FacetsModel::CategoryFacet, QStringLiteral("icons")), 2);
+    QCOMPARE(rowsInserted.count(), 1);
+    QCOMPARE(model->rowCount(), 3);
+
+    // And again once an update turns up, after which it coming by on a later page changes nothing
+    alpha.setStatus(Entry::Updateable);
+    engine->cache()->registerChangedEntry(alpha);
+    QCOMPARE(model->count(FacetsModel::StatusFacet, QStringLiteral("Installed")), 0);
+    QCOMPARE(model->count(FacetsModel::StatusFacet, QStringLiteral("Updateable")), 1);
+    Q_EMIT provider->loadingFinished(Provider::SearchRequest(Provider::Newest, Provider::None, QString(), {}, 1), {alpha, beta});
+    QCOMPARE(model->count(FacetsModel::StatusFacet, QStringLiteral("Updateable")), 1);
+    QCOMPARE(model->count(FacetsModel::StatusFacet, QStringLiteral("Downloadable")), 1);
+    verifyRows();
+}
+
+void FacetsModelTest::testFacetDropsToZero()
+{
+    const QSharedPointer<Provider> provider = engine->provider(providerId());
+    Entry alpha = createEntry(QStringLiteral("alpha"), QStringLiteral("icons"), {QStringLiteral("dark")});
+    Entry beta = createEntry(QStringLiteral("beta"), QStringLiteral("wallpapers"), {QStringLiteral("dark")});
+    const Entry gamma = createEntry(QStringLiteral("gamma"), QStringLiteral("wallpapers"));
+    Q_EMIT provider->loadingFinished(Provider::SearchRequest(Provider::Newest, Provider::None, QString(), {}, 0), {alpha, beta, gamma});
+    // Downloadable, icons, dark and wallpapers
+    QCOMPARE(model->rowCount(), 4);
+
+    // alpha was the only one in icons, so moving it elsewhere takes that row away
+    QSignalSpy rowsRemoved(model, &FacetsModel::rowsRemoved);
+    alpha.setCategory(QStringLiteral("wallpapers"));
+    Q_EMIT provider->entryDetailsLoaded(alpha);
+    QCOMPARE(rowsRemoved.count(), 1);
+    QCOMPARE(model->rowCount(), 3);
+    QCOMPARE(model->count(FacetsModel::CategoryFacet, QStringLiteral("icons")), 0);
+    QCOMPARE(model->count(FacetsModel::CategoryFacet, QStringLiteral("wallpapers")), 3);
+    QCOMPARE(model->count(FacetsModel::TagFacet, QStringLiteral("dark")), 2);
+    verifyRows();
+
+    // Deleted entries are not counted at all, so the last two with the tag take it away with them
+    alpha.setStatus(Entry::Deleted);
+    engine->cache()->registerChangedEntry(alpha);
+    QCOMPARE(model->count(FacetsModel::TagFacet, QStringLiteral("dark")), 1);
+    QCOMPARE(model->count(FacetsModel::CategoryFacet, QStringLiteral("wallpapers")), 2);
+    QCOMPARE(rowsRemoved.count(), 1);
+    beta.setStatus(Entry::Deleted);
+    engine->cache()->registerChangedEntry(beta);
+    QCOMPARE(model->count(FacetsModel::TagFacet, QStringLiteral("dark")), 0);
+    QCOMPARE(rowsRemoved.count(), 2);
+    // Downloadable and wallpapers, both of which only gamma has left
+    QCOMPARE(model->rowCount(), 2);
+    QCOMPARE(model->count(FacetsModel::StatusFacet, QStringLiteral("Downloadable")), 1);
+    QCOMPARE(model->count(FacetsModel::CategoryFacet, QStringLiteral("wallpapers")), 1);
+    verifyRows();
+
+    // Once gone, a facet comes back as a new row when an entry has it again
+    QSignalSpy rowsInserted(model, &FacetsModel::rowsInserted);
+    Q_EMIT provider->loadingFinished(Provider::SearchRequest(Provider::Newest, Provider::None, QString(), {}, 1),
+                                     {createEntry(QStringLiteral("delta"), QStringLiteral("icons"))});
+    QCOMPARE(rowsInserted.count(), 1);
+    QCOMPARE(model->count(FacetsModel::CategoryFacet, QStringLiteral("icons")), 1);
+    QCOMPARE(model->rowCount(), 3);
+    verifyRows();
+}
+
+QTEST_GUILESS_MAIN(FacetsModelTest)
+
+#include "facetsmodeltest.moc"
@@ -0,0 +1,93 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "core/jobs/httpjob.h"
+
+using namespace KNSCore;
+
+class HTTPReplayTest : public QObject
+{
+    Q_OBJECT
+public:
+    QTemporaryDir archive;
+
+private Q_SLOTS:
+    void initTestCase();
+    void testReplay();
+    void testReplayInOrder();
+    void testMissingRecording();
+};
+
+void HTTPReplayTest::initTestCase()
+{
+    QVERIFY(archive.isValid());
+    const QDir dir(archive.path());
+    auto writeFile = [&dir](const QString &name, const QByteArray &data) {
+        QFile file(dir.filePath(name));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(data);
+    };
+    writeFile(QStringLiteral("1.body"), QByteArrayLiteral("<knewstuff></knewstuff>"));
+    writeFile(QStringLiteral("2.body"), QByteArrayLiteral("first"));
+    writeFile(QStringLiteral("3.body"), QByteArrayLiteral("second"));
+    writeFile(QStringLiteral("index.jsonl"),
+              "{\"url\":\"https://example.org/feed.xml\",\"status\":200,\"headers\":[[\"ETag\",\"abc\"]],\"firstByte\":40,\"total\":50,\"error\":\"\","
+              "\"body\":\"1.body\"}\n"
+              "{\"url\":\"https://example.org/changing\",\"status\":200,\"headers\":[],\"firstByte\":1,\"total\":2,\"error\":\"\",\"body\":\"2.body\"}\n"
+              "{\"url\":\"https://example.org/changing\",\"status\":200,\"headers\":[],\"firstByte\":1,\"total\":2,\"error\":\"\",\"body\":\"3.body\"}\n");
+
+    // The archive is read when the first request is made, so this has to happen before that
+    qputenv("KNEWSTUFF_NETWORK_REPLAY", QFile::encodeName(archive.path()));
+    qputenv("KNEWSTUFF_NETWORK_REPLAY_SPEED", "0");
+}
+
+void HTTPReplayTest::testReplay()
+{
+    HTTPJob *job = HTTPJob::get(QUrl(QStringLiteral("https://example.org/feed.xml")), NoReload, HideProgressInfo);
+    QByteArray data;
+    connect(job, &HTTPJob::data, this, [&data](KJob *, const QByteArray &chunk) {
+        data += chunk;
+    });
+    QSignalSpy resultSpy(job, &KJob::result);
+    QVERIFY(resultSpy.wait());
+    QCOMPARE(job->error(), 0);
+    QCOMPARE(data, QByteArrayLiteral("<knewstuff></knewstuff>"));
+    QCOMPARE(job->statusCode(), 200);
+    QCOMPARE(job->responseHeader("etag"), QByteArrayLiteral("abc"));
+}
+
+void HTTPReplayTest::testReplayInOrder()
+{
+    const QByteArrayList expected{QByteArrayLiteral("first"), QByteArrayLiteral("second"), QByteArrayLiteral("second")};
+    for (const QByteArray &expectedData : expected) {
+        HTTPJob *job = HTTPJob::get(QUrl(QStringLiteral("https://example.org/changing")), NoReload, HideProgressInfo);
+        QByteArray data;
+        connect(job, &HTTPJob::data, this, [&data](KJob *, const QByteArray &chunk) {
+            data += chunk;
+        });
+        QSignalSpy resultSpy(job, &KJob::result);
+        QVERIFY(resultSpy.wait());
+        QCOMPARE(data, expectedData);
+    }
+}
+
+void HTTPReplayTest::testMissingRecording()
+{
+    HTTPJob *job = HTTPJob::get(QUrl(QStringLiteral("https://example.org/not-recorded")), NoReload, HideProgressInfo);
+    QSignalSpy resultSpy(job, &KJob::result);
+    QVERIFY(resultSpy.wait());
+    QVERIFY(job->error() != 0);
+}
+
+QTEST_GUILESS_MAIN(HTTPReplayTest)
+
+#include "httpreplaytest.moc"
@@ -0,0 +1,121 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+#include <QTimer>
+
+#include "enginebase.h"
+#include "mirrorbuilder.h"
+#include "resultsstream.h"
+
+using namespace KNSCore;
+
+class MirrorBuilderTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void testBuild();
+
+private:
+    QByteArray readFile(const QString &url) const;
+    QString providerId() const;
+};
+
+QByteArray MirrorBuilderTest::readFile(const QString &url) const
+{
+    QFile file(QUrl(url).toLocalFile());
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+QString MirrorBuilderTest::providerId() const
+{
+    return QUrl::fromLocalFile(QStringLiteral(DATA_DIR "mirrorbuildertest/feed.xml")).toString();
+}
+
+void MirrorBuilderTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    QFile::remove(dataPath + QLatin1String("/knewstuff3/mirrorbuildertest.knsregistry"));
+    QFile::remove(dataPath + QLatin1String("/knewstuff3/mirrorbuildertest-mirror.knsregistry"));
+    QDir(QStringLiteral(DATA_DIR "mirrorbuildertest/mirror")).removeRecursively();
+}
+
+void MirrorBuilderTest::testBuild()
+{
+    // alpha comes in two flavours and has all the previews, beta is as simple as it gets, and the payload of gamma is missing
+    MirrorBuilder builder;
+    QVERIFY(builder.init(QStringLiteral(DATA_DIR "mirrorbuildertest/mirrorbuildertest.knsrc")));
+    QSignalSpy finished(&builder, &MirrorBuilder::finished);
+    builder.build(QStringLiteral(DATA_DIR "mirrorbuildertest/mirror"));
+    QVERIFY(finished.wait());
+    QCOMPARE(finished.constFirst().constFirst().toBool(), true);
+    QCOMPARE(builder.mirroredEntries(), 2);
+    QCOMPARE(builder.failedEntries(), 1);
+
+    // Everything is served from the mirror now, and the entries keep the id of the provider they came from
+    EngineBase engine;
+    QVERIFY(engine.init(QStringLiteral(DATA_DIR "mirrorbuildertest/mirrorbuildertest-mirror.knsrc")));
+    QSignalSpy loaded(&engine, &EngineBase::signalProvidersLoaded);
+    QVERIFY(loaded.wait());
+    QCOMPARE(engine.providerIDs(), QStringList{providerId()});
+
+    Entry::List entries;
+    bool searchFinished = false;
+    ResultsStream *stream = engine.search(Provider::SearchRequest(Provider::Alphabetical, Provider::None, QString(), {}, 0));
+    connect(stream, &ResultsStream::entriesFound, this, [&entries, stream](const Entry::List &found) {
+        entries << found;
+        QTimer::singleShot(0, stream, &ResultsStream::fetchMore);
+    });
+    connect(stream, &ResultsStream::finished, this, [&searchFinished]() {
+        searchFinished = true;
+    });
+    stream->fetch();
+    QTRY_VERIFY(searchFinished);
+    QCOMPARE(entries.count(), 2);
+
+    const QString mirrorUrl = QUrl::fromLocalFile(QStringLiteral(DATA_DIR "mirrorbuildertest/mirror")).toString();
+    const Entry alpha = entries.at(0).uniqueId() == QLatin1String("alpha") ? entries.at(0) : entries.at(1);
+    const Entry beta = entries.at(0).uniqueId() == QLatin1String("beta") ? entries.at(0) : entries.at(1);
+    QCOMPARE(alpha.uniqueId(), QStringLiteral("alpha"));
+    QCOMPARE(beta.uniqueId(), QStringLiteral("beta"));
+
+    // Every preview, each pointing at a copy of the original
+    QCOMPARE(readFile(alpha.previewUrl(Entry::PreviewSmall1)), QByteArray("The contents of small1.png"));
+    QCOMPARE(readFile(alpha.previewUrl(Entry::PreviewSmall2)), QByteArray("The contents of small2.png"));
+    QVERIFY(alpha.previewUrl(Entry::PreviewSmall3).isEmpty());
+    QCOMPARE(readFile(alpha.previewUrl(Entry::PreviewBig1)), QByteArray("The contents of big1.png"));
+    QVERIFY(alpha.previewUrl(Entry::PreviewBig2).isEmpty());
+    QCOMPARE(readFile(alpha.previewUrl(Entry::PreviewBig3)), QByteArray("The contents of big3.png"));
+    QVERIFY(alpha.previewUrl(Entry::PreviewSmall1).startsWith(mirrorUrl));
+    // The same file is only mirrored once
+    QCOMPARE(beta.previewUrl(Entry::PreviewBig1), beta.previewUrl(Entry::PreviewSmall1));
+
+    // Every download link, and the provider hands out whichever is asked for
+    const QList<Entry::DownloadLinkInformation> links = alpha.downloadLinkInformationList();
+    QCOMPARE(links.count(), 2);
+    QCOMPARE(links.at(1).id, 2);
+    QCOMPARE(links.at(1).name, QStringLiteral("Alpha Extra"));
+    QSharedPointer<Provider> provider = engine.provider(providerId());
+    QSignalSpy payloadLinkLoaded(provider.data(), &Provider::payloadLinkLoaded);
+    for (const int linkId : {1, 2}) {
+        provider->loadPayloadLink(alpha, linkId);
+        QTRY_COMPARE(payloadLinkLoaded.count(), linkId);
+        const QString payload = payloadLinkLoaded.constLast().constFirst().value<Entry>().payload();
+        QVERIFY(payload.startsWith(mirrorUrl));
+        QCOMPARE(readFile(payload), QByteArray("The contents of ") + (linkId == 1 ? "alpha.txt" : "alpha-extra.txt"));
+    }
+    QCOMPARE(readFile(beta.payload()), QByteArray("The contents of beta.txt"));
+}
+
+QTEST_GUILESS_MAIN(MirrorBuilderTest)
+
+#include "mirrorbuildertest.moc"
@@ -0,0 +1,115 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "core/payloadstore_p.h"
+
+using namespace KNSCore;
+
+class PayloadStoreTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testAddAndFind();
+    void testDeduplicate();
+    void testReferences();
+    void testUpdate();
+
+private:
+    QString writeFile(const QString &name, const QByteArray &content);
+    static QByteArray readFile(const QString &path);
+    QTemporaryDir dir;
+};
+
+QString PayloadStoreTest::writeFile(const QString &name, const QByteArray &content)
+{
+    const QString path = dir.filePath(name);
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(content);
+    return path;
+}
+
+QByteArray PayloadStoreTest::readFile(const QString &path)
+{
+    QFile file(path);
+    file.open(QIODevice::ReadOnly);
+    return file.readAll();
+}
+
+void PayloadStoreTest::testAddAndFind()
+{
+    PayloadStore store(dir.filePath(QStringLiteral("store-find")));
+    QVERIFY(store.find(QStringLiteral("provider/1/theme.tar.gz"), QStringLiteral("1.0")).isEmpty());
+
+    const QString download = writeFile(QStringLiteral("download-find"), "payload");
+    const QString hash = store.add(download, QStringLiteral("provider/1/theme.tar.gz"), QStringLiteral("1.0"));
+    QVERIFY(!hash.isEmpty());
+    QVERIFY(!QFile::exists(download));
+    QCOMPARE(store.find(QStringLiteral("provider/1/theme.tar.gz"), QStringLiteral("1.0")), hash);
+    QVERIFY(store.find(QStringLiteral("provider/1/theme.tar.gz"), QStringLiteral("2.0")).isEmpty());
+
+    const QString checkout = store.checkout(hash, QStringLiteral("theme.tar.gz"));
+    QVERIFY(checkout.endsWith(QLatin1String("theme.tar.gz")));
+    QCOMPARE(readFile(checkout), QByteArray("payload"));
+}
+
+void PayloadStoreTest::testDeduplicate()
+{
+    PayloadStore store(dir.filePath(QStringLiteral("store-dedup")));
+    const QString first = store.add(writeFile(QStringLiteral("download-a"), "shared"), QStringLiteral("a/1/font.ttf"), QStringLiteral("1"));
+    const QString second = store.add(writeFile(QStringLiteral("download-b"), "shared"), QStringLiteral("b/7/font.ttf"), QStringLiteral("3"));
+    QCOMPARE(first, second);
+    // Either source finds the one payload
+    QCOMPARE(store.find(QStringLiteral("a/1/font.ttf"), QStringLiteral("1")), first);
+    QCOMPARE(store.find(QStringLiteral("b/7/font.ttf"), QStringLiteral("3")), first);
+}
+
+void PayloadStoreTest::testReferences()
+{
+    PayloadStore store(dir.filePath(QStringLiteral("store-refs")));
+    const QString hash = store.add(writeFile(QStringLiteral("download-refs"), "icons"), QStringLiteral("p/2/icons.tar"), QStringLiteral("1"));
+    const QString firstTarget = dir.filePath(QStringLiteral("installed-1"));
+    const QString secondTarget = dir.filePath(QStringLiteral("installed-2"));
+    QVERIFY(PayloadStore::materialize(store.checkout(hash, QStringLiteral("icons.tar")), firstTarget));
+    QVERIFY(PayloadStore::materialize(store.checkout(hash, QStringLiteral("icons.tar")), secondTarget));
+    store.addReferences(hash, {firstTarget});
+    store.addReferences(hash, {secondTarget});
+    QCOMPARE(store.referenceCount(hash), 2);
+
+    // Still needed by the second installation
+    store.release({firstTarget});
+    QCOMPARE(store.referenceCount(hash), 1);
+    QCOMPARE(store.find(QStringLiteral("p/2/icons.tar"), QStringLiteral("1")), hash);
+
+    store.release({secondTarget});
+    QCOMPARE(store.referenceCount(hash), 0);
+    QVERIFY(store.find(QStringLiteral("p/2/icons.tar"), QStringLiteral("1")).isEmpty());
+    // Installed files are independent of the store
+    QCOMPARE(readFile(secondTarget), QByteArray("icons"));
+}
+
+void PayloadStoreTest::testUpdate()
+{
+    PayloadStore store(dir.filePath(QStringLiteral("store-update")));
+    const QString target = dir.filePath(QStringLiteral("installed-update"));
+    const QString oldHash = store.add(writeFile(QStringLiteral("download-old"), "old"), QStringLiteral("p/3/w.png"), QStringLiteral("1"));
+    store.addReferences(oldHash, {target});
+    const QString newHash = store.add(writeFile(QStringLiteral("download-new"), "new"), QStringLiteral("p/3/w.png"), QStringLiteral("2"));
+    store.addReferences(newHash, {target});
+
+    // Nothing refers to the old version any longer
+    QCOMPARE(store.referenceCount(newHash), 1);
+    QVERIFY(store.find(QStringLiteral("p/3/w.png"), QStringLiteral("1")).isEmpty());
+    QCOMPARE(store.find(QStringLiteral("p/3/w.png"), QStringLiteral("2")), newHash);
+}
+
+QTEST_GUILESS_MAIN(PayloadStoreTest)
+
+#include "payloadstoretest.moc"
@@ -0,0 +1,191 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+
+#include "cache.h"
+#include "enginebase.h"
+#include "installation_p.h"
+#include "provisioner.h"
+#include "question.h"
+#include "questionmanager.h"
+
+using namespace KNSCore;
+
+// Gives access to the installation, to see what actually gets installed
+class TestEngine : public EngineBase
+{
+public:
+    using EngineBase::installation;
+};
+
+class ProvisionerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+    void testInstall();
+    void testExportManifest();
+    void testSkipInstalled();
+    void testParallel();
+
+private:
+    QString providerId() const;
+
+    TestEngine *engine = nullptr;
+};
+
+QString ProvisionerTest::providerId() const
+{
+    return QUrl::fromLocalFile(QStringLiteral(DATA_DIR "provisionertest/feed.xml")).toString();
+}
+
+void ProvisionerTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    cleanupTestCase();
+    connect(QuestionManager::instance(), &QuestionManager::askQuestion, this, [](Question *question) {
+        question->setResponse(Question::YesResponse);
+    });
+}
+
+void ProvisionerTest::cleanupTestCase()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    QFile::remove(dataPath + QLatin1String("/knewstuff3/provisionertest.knsregistry"));
+    QDir(dataPath + QLatin1String("/provisionertest")).removeRecursively();
+}
+
+void ProvisionerTest::init()
+{
+    engine = new TestEngine;
+    QVERIFY(engine->init(QStringLiteral(DATA_DIR "provisionertest/provisionertest.knsrc")));
+    QSignalSpy loaded(engine, &EngineBase::signalProvidersLoaded);
+    QVERIFY(loaded.wait());
+}
+
+void ProvisionerTest::cleanup()
+{
+    delete engine;
+}
+
+void ProvisionerTest::testInstall()
+{
+    Provisioner provisioner(engine);
+    QSignalSpy entryFinished(&provisioner, &Provisioner::entryFinished);
+    QSignalSpy finished(&provisioner, &Provisioner::finished);
+    // More entries than are looked up at once, all of which are answered by the one listing of the feed
+    provisioner.setMaxParallel(2);
+    provisioner.install({
+        {providerId(), QStringLiteral("alpha"), QStringLiteral("1"), 1},
+        {providerId(), QStringLiteral("beta"), QStringLiteral("1"), 1},
+        {providerId(), QStringLiteral("missing"), QStringLiteral("1"), 1},
+    });
+    QVERIFY(finished.wait());
+    QCOMPARE(entryFinished.count(), 3);
+
+    QMap<QString, bool> results;
+    for (const QList<QVariant> &arguments : std::as_const(entryFinished)) {
+        results.insert(arguments.at(0).value<Provisioner::ManifestEntry>().uniqueId, arguments.at(1).toBool());
+    }
+    QCOMPARE(results.value(QStringLiteral("alpha")), true);
+    QCOMPARE(results.value(QStringLiteral("beta")), true);
+    QCOMPARE(results.value(QStringLiteral("missing")), false);
+    QCOMPARE(provisioner.statistics().installed, 2);
+    QCOMPARE(provisioner.statistics().failed, 1);
+
+    const Entry::List installed = engine->cache()->registryForProvider(providerId());
+    QCOMPARE(installed.count(), 2);
+    for (const Entry &entry : installed) {
+        QCOMPARE(entry.status(), Entry::Installed);
+        QCOMPARE(entry.installedLinkId(), 1);
+    }
+}
+
+void ProvisionerTest::testExportManifest()
+{
+    // Whichever link an entry was installed from is what the manifest asks for
+    const auto entry = [this](const QString &id, Entry::Status status, int linkId) {
+        Entry entry;
+        entry.setProviderId(providerId());
+        entry.setUniqueId(id);
+        entry.setVersion(QStringLiteral("1"));
+        entry.setStatus(status);
+        entry.setInstalledLinkId(linkId);
+        return entry;
+    };
+    const Entry::List entries{
+        entry(QStringLiteral("alpha"), Entry::Installed, 2),
+        entry(QStringLiteral("beta"), Entry::Installed, 0),
+        entry(QStringLiteral("gamma"), Entry::Downloadable, 0),
+    };
+
+    bool ok = false;
+    const QList<Provisioner::ManifestEntry> manifest = Provisioner::parseManifest(Provisioner::exportManifest(entries), &ok);
+    QVERIFY(ok);
+    QCOMPARE(manifest.count(), 2);
+    QCOMPARE(manifest.at(0).uniqueId, QStringLiteral("alpha"));
+    QCOMPARE(manifest.at(0).providerId, providerId());
+    QCOMPARE(manifest.at(0).version, QStringLiteral("1"));
+    QCOMPARE(manifest.at(0).linkId, 2);
+    QCOMPARE(manifest.at(1).uniqueId, QStringLiteral("beta"));
+    QCOMPARE(manifest.at(1).linkId, 1);
+}
+
+void ProvisionerTest::testSkipInstalled()
+{
+    // Still installed from testInstall()
+    Provisioner provisioner(engine);
+    QSignalSpy finished(&provisioner, &Provisioner::finished);
+    provisioner.install(Provisioner::parseManifest(Provisioner::exportManifest(engine->cache()->registryForProvider(providerId()))));
+    QVERIFY(finished.wait());
+    QCOMPARE(provisioner.statistics().skipped, 2);
+    QCOMPARE(provisioner.statistics().installed, 0);
+    QCOMPARE(provisioner.statistics().failed, 0);
+}
+
+void ProvisionerTest::testParallel()
+{
+    // All of them at once, each of which must only be installed the once, even though the provider tells
+    // every transaction about every link
+    QMap<QString, int> installed;
+    QObject context;
+    connect(engine->installation(), &Installation::signalInstallationFinished, &context, [&installed](const KNSCore::Entry &entry) {
+        ++installed[entry.uniqueId()];
+    });
+    Provisioner provisioner(engine);
+    QSignalSpy entryFinished(&provisioner, &Provisioner::entryFinished);
+    QSignalSpy finished(&provisioner, &Provisioner::finished);
+    provisioner.setMaxParallel(4);
+    provisioner.install({
+        {providerId(), QStringLiteral("gamma"), QStringLiteral("1"), 1},
+        {providerId(), QStringLiteral("delta"), QStringLiteral("1"), 1},
+        {providerId(), QStringLiteral("epsilon"), QStringLiteral("1"), 1},
+        {providerId(), QStringLiteral("zeta"), QStringLiteral("1"), 1},
+    });
+    QVERIFY(finished.wait());
+    QCOMPARE(entryFinished.count(), 4);
+    QCOMPARE(provisioner.statistics().installed, 4);
+    QCOMPARE(provisioner.statistics().failed, 0);
+    const QMap<QString, int> expected{
+        {QStringLiteral("gamma"), 1},
+        {QStringLiteral("delta"), 1},
+        {QStringLiteral("epsilon"), 1},
+        {QStringLiteral("zeta"), 1},
+    };
+    QCOMPARE(installed, expected);
+}
+
+QTEST_GUILESS_MAIN(ProvisionerTest)
+
+#include "provisionertest.moc"
@@ -0,0 +1,260 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+
+#include "cache.h"
+#include "enginebase.h"
+#include "provider.h"
+#include "resultsstream.h"
+
+using namespace KNSCore;
+
+// A provider which answers requests for entries as told to by the test
+class TestProvider : public Provider
+{
+public:
+    enum Response {
+        Respond, // Right away, from within loadEntries()
+        Wait, // Only once the test calls respond()
+    };
+
+    explicit TestProvider(const QString &id)
+        : m_id(id)
+    {
+    }
+
+    QString id() const override
+    {
+        return m_id;
+    }
+    bool setProviderXML(const QDomElement &) override
+    {
+        return true;
+    }
+    bool isInitialized() const override
+    {
+        return true;
+    }
+    void setCachedEntries(const KNSCore::Entry::List &) override
+    {
+    }
+    void loadEntries(const KNSCore::Provider::SearchRequest &request) override
+    {
+        requests << request;
+        if (response == Respond) {
+            respond(request);
+        }
+    }
+    void loadPayloadLink(const KNSCore::Entry &, int) override
+    {
+    }
+
+    void respond(const KNSCore::Provider::SearchRequest &request)
+    {
+        Q_EMIT loadingFinished(request, pages.value(request.page));
+    }
+
+    Entry::List page(int page, int count)
+    {
+        Entry::List entries;
+        for (int i = 0; i < count; ++i) {
+            Entry entry;
+            entry.setProviderId(m_id);
+            entry.setUniqueId(QStringLiteral("%1-%2").arg(page).arg(i));
+            entry.setName(QStringLiteral("Entry %1 of page %2").arg(i).arg(page));
+            entries << entry;
+        }
+        return entries;
+    }
+
+    Response response = Respond;
+    QHash<int, Entry::List> pages;
+    QList<SearchRequest> requests;
+
+private:
+    const QString m_id;
+};
+
+class TestEngine : public EngineBase
+{
+public:
+    using EngineBase::addProvider;
+};
+
+class ResultsStreamTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testExhaustedVsPageLoaded();
+    void testTimedOut();
+    void testDeadlineRestarted();
+    void testLateResults();
+    void testSynchronousFetch();
+    void testLocalOnlyEntries();
+
+private:
+    TestEngine *engine = nullptr;
+    QSharedPointer<TestProvider> first;
+    QSharedPointer<TestProvider> second;
+};
+
+void ResultsStreamTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QLatin1String("/knewstuff3/resultsstreamtest.knsregistry"));
+}
+
+void ResultsStreamTest::init()
+{
+    engine = new TestEngine;
+    // No providers of its own, the test ones are added instead
+    QVERIFY(engine->init(QStringLiteral(DATA_DIR "resultsstreamtest/resultsstreamtest.knsrc")));
+    first.reset(new TestProvider(QStringLiteral("first")));
+    second.reset(new TestProvider(QStringLiteral("second")));
+    engine->addProvider(first);
+    engine->addProvider(second);
+}
+
+void ResultsStreamTest::cleanup()
+{
+    delete engine;
+    first.reset();
+    second.reset();
+}
+
+void ResultsStreamTest::testExhaustedVsPageLoaded()
+{
+    first->pages.insert(0, first->page(0, 3));
+    ResultsStream *stream = engine->search(Provider::SearchRequest(Provider::Newest, Provider::None, QString(), {}, 0));
+    QSignalSpy found(stream, &ResultsStream::entriesFound);
+    QSignalSpy finished(stream, &ResultsStream::finished);
+    stream->fetch();
+    QCOMPARE(found.count(), 2);
+    QCOMPARE(found.at(0).at(0).value<Entry::List>().count() + found.at(1).at(0).value<Entry::List>().count(), 3);
+    // The first provider may have more
+    QCOMPARE(finished.count(), 0);
+
+    stream->fetchMore();
+    // The second one ran out already, so it is not asked again
+    QCOMPARE(first->requests.count(), 2);
+    QCOMPARE(second->requests.count(), 1);
+    QCOMPARE(first->requests.last().page, 1);
+    QCOMPARE(finished.count(), 1);
+    QVERIFY(stream->timedOutProviders().isEmpty());
+}
+
+void ResultsStreamTest::testTimedOut()
+{
+    first->pages.insert(0, first->page(0, 2));
+    second->response = TestProvider::Wait;
+    Provider::SearchRequest request(Provider::Newest, Provider::None, QString(), {}, 0);
+    request.deadline = 200;
+    ResultsStream *stream = engine->search(request);
+    QSignalSpy found(stream, &ResultsStream::entriesFound);
+    QSignalSpy finished(stream, &ResultsStream::finished);
+    stream->fetch();
+    QCOMPARE(found.count(), 1);
+    QCOMPARE(finished.count(), 0);
+    QVERIFY(finished.wait());
+    QCOMPARE(stream->timedOutProviders(), QStringList{QStringLiteral("second")});
+}
+
+void ResultsStreamTest::testDeadlineRestarted()
+{
+    first->response = TestProvider::Wait;
+    first->pages.insert(0, first->page(0, 2));
+    second->response = TestProvider::Wait;
+    Provider::SearchRequest request(Provider::Newest, Provider::None, QString(), {}, 0);
+    request.deadline = 400;
+    ResultsStream *stream = engine->search(request);
+    QSignalSpy finished(stream, &ResultsStream::finished);
+    stream->fetch();
+    QTest::qWait(300);
+    first->respond(first->requests.last());
+
+    // Past the deadline counted from the start, but not from the last response
+    QTest::qWait(300);
+    QCOMPARE(finished.count(), 0);
+    QVERIFY(finished.wait());
+    QCOMPARE(stream->timedOutProviders(), QStringList{QStringLiteral("second")});
+}
+
+void ResultsStreamTest::testLateResults()
+{
+    second->response = TestProvider::Wait;
+    second->pages.insert(0, second->page(0, 4));
+    Provider::SearchRequest request(Provider::Newest, Provider::None, QString(), {}, 0);
+    request.deadline = 200;
+    ResultsStream *stream = engine->search(request);
+    QSignalSpy found(stream, &ResultsStream::entriesFound);
+    QSignalSpy finished(stream, &ResultsStream::finished);
+    QSignalSpy destroyed(stream, &QObject::destroyed);
+    stream->fetch();
+    QVERIFY(finished.wait());
+    QCOMPARE(found.count(), 1);
+
+    // Still delivered after the deadline, and the stream goes away once nobody is left to wait for
+    second->respond(second->requests.last());
+    QCOMPARE(found.count(), 2);
+    QCOMPARE(found.last().at(0).value<Entry::List>().count(), 4);
+    QCOMPARE(finished.count(), 1);
+    QVERIFY(destroyed.wait());
+}
+
+void ResultsStreamTest::testSynchronousFetch()
+{
+    ResultsStream *stream = engine->search(Provider::SearchRequest(Provider::Newest, Provider::None, QString(), {}, 0));
+    QSignalSpy finished(stream, &ResultsStream::finished);
+    QSignalSpy destroyed(stream, &QObject::destroyed);
+    stream->fetch();
+    // Both providers answered from within fetch(), with nothing
+    QCOMPARE(finished.count(), 1);
+    QVERIFY(destroyed.wait());
+    QCOMPARE(finished.count(), 1);
+}
+
+void ResultsStreamTest::testLocalOnlyEntries()
+{
+    const auto installed = [](const QString &providerId, const QString &id) {
+        Entry entry;
+        entry.setProviderId(providerId);
+        entry.setUniqueId(id);
+        entry.setName(QStringLiteral("Searched for %1").arg(id));
+        entry.setStatus(Entry::Installed);
+        return entry;
+    };
+    // One still on offer, one which is gone from its provider, and one of a provider which is not in use
+    engine->cache()->registerChangedEntry(installed(QStringLiteral("first"), QStringLiteral("kept")));
+    engine->cache()->registerChangedEntry(installed(QStringLiteral("first"), QStringLiteral("gone")));
+    engine->cache()->registerChangedEntry(installed(QStringLiteral("unused"), QStringLiteral("other")));
+    first->pages.insert(0, {installed(QStringLiteral("first"), QStringLiteral("kept"))});
+
+    ResultsStream *stream = engine->search(Provider::SearchRequest(Provider::Newest, Provider::None, QStringLiteral("searched"), {}, 0));
+    QSignalSpy found(stream, &ResultsStream::entriesFound);
+    QSignalSpy removed(stream, &ResultsStream::entriesRemoved);
+    stream->fetch();
+    QVERIFY(found.count() >= 1);
+    const Entry::List localEntries = found.first().at(0).value<Entry::List>();
+    QCOMPARE(localEntries.count(), 2);
+    for (const Entry &entry : localEntries) {
+        QCOMPARE(entry.providerId(), QStringLiteral("first"));
+    }
+    QCOMPARE(removed.count(), 1);
+    const Entry::List removedEntries = removed.first().at(0).value<Entry::List>();
+    QCOMPARE(removedEntries.count(), 1);
+    QCOMPARE(removedEntries.first().uniqueId(), QStringLiteral("gone"));
+}
+
+QTEST_GUILESS_MAIN(ResultsStreamTest)
+
+#include "resultsstreamtest.moc"
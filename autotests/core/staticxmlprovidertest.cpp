@@ -0,0 +1,154 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+#include <QTimer>
+
+#include "cache.h"
+#include "enginebase.h"
+#include "resultsstream.h"
+
+using namespace KNSCore;
+
+// Collects everything a search turns up, asking for more until there is nothing left
+class SearchResults : public QObject
+{
+public:
+    SearchResults(EngineBase *engine, const Provider::SearchRequest &request)
+    {
+        ResultsStream *stream = engine->search(request);
+        connect(stream, &ResultsStream::entriesFound, this, [this, stream](const Entry::List &found) {
+            entries << found;
+            QTimer::singleShot(0, stream, &ResultsStream::fetchMore);
+        });
+        connect(stream, &ResultsStream::finished, this, [this]() {
+            finished = true;
+        });
+        stream->fetch();
+    }
+
+    QStringList ids() const
+    {
+        QStringList ids;
+        for (const Entry &entry : entries) {
+            ids << entry.uniqueId();
+        }
+        return ids;
+    }
+
+    Entry::List entries;
+    bool finished = false;
+};
+
+class StaticXmlProviderTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testShards();
+    void testConcurrentSearches();
+    void testExactEntryId();
+    void testUpdateManifest();
+
+private:
+    EngineBase *engine = nullptr;
+};
+
+void StaticXmlProviderTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    // Nothing installed from an earlier run should turn up in the results
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QLatin1String("/knewstuff3/staticxmlprovidertest.knsregistry"));
+}
+
+void StaticXmlProviderTest::init()
+{
+    engine = new EngineBase;
+    // The feed is split into two shards, and the update manifest only knows about a new version of alpha
+    QVERIFY(engine->init(QStringLiteral(DATA_DIR "staticxmlprovidertest/staticxmlprovidertest.knsrc")));
+}
+
+void StaticXmlProviderTest::cleanup()
+{
+    delete engine;
+}
+
+void StaticXmlProviderTest::testShards()
+{
+    QSignalSpy loaded(engine, &EngineBase::signalProvidersLoaded);
+    QVERIFY(loaded.wait());
+    QCOMPARE(engine->providers().count(), 1);
+
+    SearchResults results(engine, Provider::SearchRequest(Provider::Alphabetical, Provider::None, QString(), {}, 0));
+    QTRY_VERIFY(results.finished);
+    // Everything from both shards, in the order the shards were given in
+    QCOMPARE(results.ids(), (QStringList{QStringLiteral("alpha"), QStringLiteral("beta"), QStringLiteral("gamma")}));
+    for (const Entry &entry : std::as_const(results.entries)) {
+        QCOMPARE(entry.status(), Entry::Downloadable);
+        QVERIFY(entry.payload().startsWith(QUrl::fromLocalFile(QStringLiteral(DATA_DIR "staticxmlprovidertest/")).toString()));
+    }
+}
+
+void StaticXmlProviderTest::testConcurrentSearches()
+{
+    QSignalSpy loaded(engine, &EngineBase::signalProvidersLoaded);
+    QVERIFY(loaded.wait());
+
+    // Both are underway at the same time, and each must only be answered with what it asked for
+    SearchResults themes(engine, Provider::SearchRequest(Provider::Alphabetical, Provider::None, QStringLiteral("theme"), {}, 0));
+    SearchResults icons(engine, Provider::SearchRequest(Provider::Alphabetical, Provider::None, QStringLiteral("icons"), {}, 0));
+    QTRY_VERIFY(themes.finished && icons.finished);
+    QCOMPARE(themes.ids(), (QStringList{QStringLiteral("alpha"), QStringLiteral("beta")}));
+    QCOMPARE(icons.ids(), QStringList{QStringLiteral("gamma")});
+}
+
+void StaticXmlProviderTest::testExactEntryId()
+{
+    QSignalSpy loaded(engine, &EngineBase::signalProvidersLoaded);
+    QVERIFY(loaded.wait());
+
+    // The id is not in the name, which must not matter
+    SearchResults results(engine, Provider::SearchRequest(Provider::Alphabetical, Provider::ExactEntryId, QStringLiteral("gamma"), {}, 0));
+    QTRY_VERIFY(results.finished);
+    QCOMPARE(results.ids(), QStringList{QStringLiteral("gamma")});
+}
+
+void StaticXmlProviderTest::testUpdateManifest()
+{
+    // Installed before the provider gets to see the registry
+    const QString providerId = QUrl::fromLocalFile(QStringLiteral(DATA_DIR "staticxmlprovidertest/shard-1.xml")).toString();
+    for (const QString &id : {QStringLiteral("alpha"), QStringLiteral("beta")}) {
+        Entry entry;
+        entry.setProviderId(providerId);
+        entry.setUniqueId(id);
+        entry.setName(id);
+        entry.setVersion(QStringLiteral("1"));
+        entry.setReleaseDate(QDate(2024, 1, 1));
+        entry.setStatus(Entry::Installed);
+        engine->cache()->registerChangedEntry(entry);
+    }
+
+    QSignalSpy loaded(engine, &EngineBase::signalProvidersLoaded);
+    QVERIFY(loaded.wait());
+
+    // Only alpha has a new version, and the manifest is enough to tell
+    SearchResults results(engine, Provider::SearchRequest(Provider::Alphabetical, Provider::Updates, QString(), {}, 0));
+    QTRY_VERIFY(results.finished);
+    QCOMPARE(results.ids(), QStringList{QStringLiteral("alpha")});
+    const Entry alpha = results.entries.constFirst();
+    QCOMPARE(alpha.status(), Entry::Updateable);
+    QCOMPARE(alpha.version(), QStringLiteral("1"));
+    QCOMPARE(alpha.updateVersion(), QStringLiteral("2"));
+}
+
+QTEST_GUILESS_MAIN(StaticXmlProviderTest)
+
+#include "staticxmlprovidertest.moc"
@@ -0,0 +1,89 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include <QTest>
+
+#include "core/trigramindex_p.h"
+
+using namespace KNSCore;
+
+class TrigramIndexTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void testSearch_data();
+    void testSearch();
+    void testReplace();
+
+private:
+    static Entry entry(const QString &id, const QString &name, const QString &summary, const QStringList &tags = {});
+    TrigramIndex index;
+};
+
+Entry TrigramIndexTest::entry(const QString &id, const QString &name, const QString &summary, const QStringList &tags)
+{
+    Entry entry;
+    entry.setUniqueId(id);
+    entry.setProviderId(QStringLiteral("test"));
+    entry.setName(name);
+    entry.setSummary(summary);
+    entry.setTags(tags);
+    return entry;
+}
+
+void TrigramIndexTest::initTestCase()
+{
+    index.add(entry(QStringLiteral("1"), QStringLiteral("Breeze Icons"), QStringLiteral("The default icon theme")));
+    index.add(entry(QStringLiteral("2"), QStringLiteral("Papirus"), QStringLiteral("A colourful icon theme")));
+    index.add(entry(QStringLiteral("3"), QStringLiteral("Nordic"), QStringLiteral("A dark plasma theme"), {QStringLiteral("dark")}));
+    index.add(entry(QStringLiteral("4"), QStringLiteral("Sunset wallpaper"), QStringLiteral("Orange skies")));
+    QCOMPARE(index.count(), 4);
+}
+
+void TrigramIndexTest::testSearch_data()
+{
+    QTest::addColumn<QString>("term");
+    QTest::addColumn<QStringList>("expectedIds");
+
+    QTest::newRow("exact name") << QStringLiteral("Papirus") << QStringList{QStringLiteral("2")};
+    QTest::newRow("case") << QStringLiteral("nORDIC") << QStringList{QStringLiteral("3")};
+    QTest::newRow("typo") << QStringLiteral("breze") << QStringList{QStringLiteral("1")};
+    QTest::newRow("summary") << QStringLiteral("skies") << QStringList{QStringLiteral("4")};
+    QTest::newRow("tag") << QStringLiteral("dark") << QStringList{QStringLiteral("3")};
+    QTest::newRow("several") << QStringLiteral("icon theme") << QStringList{QStringLiteral("1"), QStringLiteral("2"), QStringLiteral("3")};
+    QTest::newRow("nothing") << QStringLiteral("xylophone") << QStringList{};
+    QTest::newRow("empty") << QString() << QStringList{};
+}
+
+void TrigramIndexTest::testSearch()
+{
+    QFETCH(QString, term);
+    QFETCH(QStringList, expectedIds);
+
+    const Entry::List entries = index.search(term);
+    QStringList ids;
+    for (const Entry &entry : entries) {
+        ids << entry.uniqueId();
+    }
+    // The order amongst equally good matches is not what is tested here
+    ids.sort();
+    QCOMPARE(ids, expectedIds);
+}
+
+void TrigramIndexTest::testReplace()
+{
+    TrigramIndex replaced;
+    replaced.add(entry(QStringLiteral("1"), QStringLiteral("Old name"), QString()));
+    replaced.add(entry(QStringLiteral("1"), QStringLiteral("Renamed"), QString()));
+    QCOMPARE(replaced.count(), 1);
+    QVERIFY(replaced.search(QStringLiteral("old")).isEmpty());
+    QCOMPARE(replaced.search(QStringLiteral("renamed")).count(), 1);
+}
+
+QTEST_GUILESS_MAIN(TrigramIndexTest)
+
+#include "trigramindextest.moc"
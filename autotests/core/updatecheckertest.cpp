@@ -0,0 +1,95 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+
+#include "cache.h"
+#include "updatechecker.h"
+
+using namespace KNSCore;
+
+class UpdateCheckerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void testSharedProvider();
+
+private:
+    QString providerId() const;
+};
+
+QString UpdateCheckerTest::providerId() const
+{
+    return QUrl::fromLocalFile(QStringLiteral(DATA_DIR "updatecheckertest/feed.xml")).toString();
+}
+
+void UpdateCheckerTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    cleanupTestCase();
+
+    // Both configurations use the same provider, which has a new version of everything. The first
+    // configuration installed alpha, the second one beta, and nobody installed gamma.
+    const QList<QPair<QString, QString>> installed{
+        {QStringLiteral("updatecheckertest-first"), QStringLiteral("alpha")},
+        {QStringLiteral("updatecheckertest-second"), QStringLiteral("beta")},
+    };
+    for (const auto &[name, id] : installed) {
+        Entry entry;
+        entry.setProviderId(providerId());
+        entry.setUniqueId(id);
+        entry.setName(id);
+        entry.setVersion(QStringLiteral("1"));
+        entry.setReleaseDate(QDate(2024, 1, 1));
+        entry.setStatus(Entry::Installed);
+        const QSharedPointer<Cache> cache = Cache::getCache(name);
+        cache->registerChangedEntry(entry);
+        cache->writeRegistry();
+    }
+}
+
+void UpdateCheckerTest::cleanupTestCase()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    QFile::remove(dataPath + QLatin1String("/knewstuff3/updatecheckertest-first.knsregistry"));
+    QFile::remove(dataPath + QLatin1String("/knewstuff3/updatecheckertest-second.knsregistry"));
+}
+
+void UpdateCheckerTest::testSharedProvider()
+{
+    const QString first = QStringLiteral(DATA_DIR "updatecheckertest/updatecheckertest-first.knsrc");
+    const QString second = QStringLiteral(DATA_DIR "updatecheckertest/updatecheckertest-second.knsrc");
+    UpdateChecker checker;
+    checker.setConfigFiles({first, second});
+    QSignalSpy finished(&checker, &UpdateChecker::finished);
+    checker.check();
+    QVERIFY(finished.wait());
+
+    // The provider is only loaded once, but must be asked about what either configuration installed
+    const auto ids = [&checker](const QString &configFile) {
+        QStringList ids;
+        const Entry::List entries = checker.updateableEntries(configFile);
+        for (const Entry &entry : entries) {
+            if (entry.status() == Entry::Updateable) {
+                ids << entry.uniqueId();
+            }
+        }
+        ids.sort();
+        return ids;
+    };
+    QCOMPARE(ids(first), QStringList{QStringLiteral("alpha")});
+    QCOMPARE(ids(second), QStringList{QStringLiteral("beta")});
+    QCOMPARE(ids(QString()), (QStringList{QStringLiteral("alpha"), QStringLiteral("beta")}));
+}
+
+QTEST_GUILESS_MAIN(UpdateCheckerTest)
+
+#include "updatecheckertest.moc"
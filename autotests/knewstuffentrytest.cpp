@@ -60,6 +60,7 @@ private Q_SLOTS:
     void testCopy();
     void testAssignment();
     void testDomImplementation();
+    void testKey();
 };
 
 KNSCore::Entry testEntry::createEntryOld()
@@ -130,5 +131,37 @@ void testEntry::testDomImplementation()
     QCOMPARE(entry.version(), entry2.version());
 }
 
+void testEntry::testKey()
+{
+    KNSCore::Entry entry = createEntry();
+    KNSCore::Entry entry2 = createEntryOld();
+    QCOMPARE(entry.key(), KNSCore::entryKey(QStringLiteral("https://api.opendesktop.org/v1/"), QStringLiteral("12345")));
+    QCOMPARE(entry.key(), entry2.key());
+    QCOMPARE(qHash(entry), qHash(entry2));
+    QVERIFY(entry == entry2);
+
+    // The same id on a different provider is a different entry
+    KNSCore::Entry other;
+    other.setUniqueId(entry.uniqueId());
+    other.setProviderId(QStringLiteral("https://some.other.provider/"));
+    QVERIFY(other.key() != entry.key());
+    QVERIFY(!(other == entry));
+    QVERIFY(other < entry || entry < other);
+
+    // The key follows the ids
+    other.setProviderId(entry.providerId());
+    QCOMPARE(other.key(), entry.key());
+    QVERIFY(other == entry);
+    QVERIFY(!(other < entry) && !(entry < other));
+
+    // Sorted by id, whatever the keys are
+    other.setUniqueId(QStringLiteral("12346"));
+    QVERIFY(entry < other);
+    other.setUniqueId(QStringLiteral("12344"));
+    QVERIFY(other < entry);
+
+    QVERIFY(KNSCore::entryKey(QStringLiteral("ab"), QStringLiteral("c")) != KNSCore::entryKey(QStringLiteral("a"), QStringLiteral("bc")));
+}
+
 QTEST_GUILESS_MAIN(testEntry)
 #include "knewstuffentrytest.moc"
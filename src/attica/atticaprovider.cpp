@@ -8,14 +8,17 @@
 
 #include "commentsmodel.h"
 #include "question.h"
-#include "tagsfilterchecker.h"
 
 #include <KFormat>
 #include <KLocalizedString>
 #include <QCollator>
 #include <QDomDocument>
+#include <QTimer>
+#include <QUrlQuery>
 #include <knewstuffcore_debug.h>
 
+#include <algorithm>
+
 #include <attica/accountbalance.h>
 #include <attica/config.h>
 #include <attica/content.h>
@@ -27,6 +30,12 @@
 
 using namespace Attica;
 
+// How much content we remember, and for how long (in seconds) we trust it to be current
+static const int CONTENT_CACHE_SIZE{500};
+static const int CONTENT_MAX_AGE{5 * 60};
+// How many installed entries are checked for updates at the same time
+static const int MAX_PARALLEL_UPDATE_CHECKS{4};
+
 namespace KNSCore
 {
 AtticaProvider::AtticaProvider(const QStringList &categories, const QString &additionalAgentInformation)
@@ -95,7 +104,10 @@ bool AtticaProvider::setProviderXML(const QDomElement &xmldata)
 
 void AtticaProvider::setCachedEntries(const KNSCore::Entry::List &cachedEntries)
 {
-    mCachedEntries = cachedEntries;
+    mCachedEntries.clear();
+    for (const Entry &entry : cachedEntries) {
+        mCachedEntries.insert(entry);
+    }
 }
 
 void AtticaProvider::providerLoaded(const Attica::Provider &provider)
@@ -226,21 +238,57 @@ void AtticaProvider::loadEntries(const KNSCore::Provider::SearchRequest &request
 
 void AtticaProvider::checkForUpdates()
 {
-    if (mCachedEntries.isEmpty()) {
-        Q_EMIT loadingFinished(mCurrentRequest, {});
+    m_pendingUpdateChecks.clear();
+    const Entry::List installed = installedEntries();
+    for (const Entry &e : installed) {
+        if (hasFreshContent(e.uniqueId())) {
+            // We saw this content only just now, so it tells us as much as asking again would
+            entryFromAtticaContent(cachedContent(e.uniqueId()));
+        } else {
+            m_pendingUpdateChecks << e.uniqueId();
+        }
     }
+    startUpdateChecks();
+}
 
-    for (const Entry &e : std::as_const(mCachedEntries)) {
-        ItemJob<Content> *job = m_provider.requestContent(e.uniqueId());
+void AtticaProvider::startUpdateChecks()
+{
+    while (m_updateJobs.count() < MAX_PARALLEL_UPDATE_CHECKS && !m_pendingUpdateChecks.isEmpty()) {
+        const QString id = m_pendingUpdateChecks.takeFirst();
+        ItemJob<Content> *job = m_provider.requestContent(id);
         connect(job, &BaseJob::finished, this, &AtticaProvider::detailsLoaded);
         m_updateJobs.insert(job);
         job->start();
-        qCDebug(KNEWSTUFFCORE) << "Checking for update: " << e.name();
+        qCDebug(KNEWSTUFFCORE) << "Checking for update: " << id;
+    }
+
+    if (m_updateJobs.isEmpty() && m_pendingUpdateChecks.isEmpty()) {
+        qCDebug(KNEWSTUFFCORE) << "check update finished.";
+        QList<Entry> updatable;
+        for (const Entry &entry : std::as_const(mCachedEntries)) {
+            if (entry.status() == KNSCore::Entry::Updateable) {
+                updatable.append(entry);
+            }
+        }
+        Q_EMIT loadingFinished(mCurrentRequest, updatable);
     }
 }
 
 void AtticaProvider::loadEntryDetails(const KNSCore::Entry &entry)
 {
+    // Installed entries know the version available online as their update version
+    const Content cached = cachedContent(entry.uniqueId());
+    if (cached.isValid()
+        && (hasFreshContent(entry.uniqueId())
+            || ((cached.version() == entry.version() || cached.version() == entry.updateVersion())
+                && (cached.updated().date() == entry.releaseDate() || cached.updated().date() == entry.updateReleaseDate())))) {
+        // We already know all about this version of the content
+        const Entry details = entryFromAtticaContent(cached);
+        QTimer::singleShot(0, this, [this, details]() {
+            Q_EMIT entryDetailsLoaded(details);
+        });
+        return;
+    }
     ItemJob<Content> *job = m_provider.requestContent(entry.uniqueId());
     connect(job, &BaseJob::finished, this, &AtticaProvider::detailsLoaded);
     job->start();
@@ -251,21 +299,55 @@ void AtticaProvider::detailsLoaded(BaseJob *job)
     if (jobSuccess(job)) {
         auto *contentJob = static_cast<ItemJob<Content> *>(job);
         Content content = contentJob->result();
+        cacheContent(content);
         Entry entry = entryFromAtticaContent(content);
         Q_EMIT entryDetailsLoaded(entry);
         qCDebug(KNEWSTUFFCORE) << "check update finished: " << entry.name();
     }
 
-    if (m_updateJobs.remove(job) && m_updateJobs.isEmpty()) {
-        qCDebug(KNEWSTUFFCORE) << "check update finished.";
-        QList<Entry> updatable;
-        for (const Entry &entry : std::as_const(mCachedEntries)) {
-            if (entry.status() == KNSCore::Entry::Updateable) {
-                updatable.append(entry);
-            }
+    if (m_updateJobs.remove(job)) {
+        startUpdateChecks();
+    }
+}
+
+void AtticaProvider::cacheContent(const Attica::Content &content)
+{
+    const auto cached = mCachedContent.constFind(content.id());
+    if (cached != mCachedContent.constEnd() && cached->content.updated() > content.updated()) {
+        // Listings can lag behind, so do not let them take us back to an older version
+        return;
+    }
+    if (cached != mCachedContent.constEnd() && cached->content.updated() < content.updated()) {
+        // A newer version of the content may well have moved things around
+        mPayloadLinks.removeIf([&content](const QHash<PayloadLinkId, PayloadLink>::iterator &it) {
+            return it.key().first == content.id();
+        });
+    }
+    if (cached == mCachedContent.constEnd() && mCachedContent.size() >= CONTENT_CACHE_SIZE) {
+        // Make some room by forgetting the content we saw longest ago
+        QList<QPair<QDateTime, QString>> byAge;
+        byAge.reserve(mCachedContent.size());
+        for (auto it = mCachedContent.cbegin(); it != mCachedContent.cend(); ++it) {
+            byAge << qMakePair(it->fetched, it.key());
+        }
+        const auto evicted = byAge.begin() + CONTENT_CACHE_SIZE / 4;
+        std::nth_element(byAge.begin(), evicted, byAge.end());
+        for (auto it = byAge.cbegin(); it != evicted; ++it) {
+            mCachedContent.remove(it->second);
         }
-        Q_EMIT loadingFinished(mCurrentRequest, updatable);
     }
+    mCachedContent.insert(content.id(), CachedContent{content, QDateTime::currentDateTimeUtc()});
+}
+
+Attica::Content AtticaProvider::cachedContent(const QString &id) const
+{
+    return mCachedContent.value(id).content;
+}
+
+bool AtticaProvider::hasFreshContent(const QString &id) const
+{
+    const auto cached = mCachedContent.constFind(id);
+    return cached != mCachedContent.constEnd() && cached->fetched.secsTo(QDateTime::currentDateTimeUtc()) < CONTENT_MAX_AGE;
 }
 
 void AtticaProvider::categoryContentsLoaded(BaseJob *job)
@@ -277,9 +359,7 @@ void AtticaProvider::categoryContentsLoaded(BaseJob *job)
     auto *listJob = static_cast<ListJob<Content> *>(job);
     const Content::List contents = listJob->itemList();
 
-    Entry::List entries;
-    TagsFilterChecker checker(tagFilter());
-    TagsFilterChecker downloadschecker(downloadTagFilter());
+    Entry::List unfiltered;
     for (const Content &content : contents) {
         if (!content.isValid()) {
             qCDebug(KNEWSTUFFCORE)
@@ -287,28 +367,12 @@ void AtticaProvider::categoryContentsLoaded(BaseJob *job)
                 << name() << "and inform them there is an issue with content in the category or categories" << mCurrentRequest.categories;
             continue;
         }
-        if (checker.filterAccepts(content.tags())) {
-            bool filterAcceptsDownloads = true;
-            if (content.downloads() > 0) {
-                filterAcceptsDownloads = false;
-                const QList<Attica::DownloadDescription> descs = content.downloadUrlDescriptions();
-                for (const Attica::DownloadDescription &dli : descs) {
-                    if (downloadschecker.filterAccepts(dli.tags())) {
-                        filterAcceptsDownloads = true;
-                        break;
-                    }
-                }
-            }
-            if (filterAcceptsDownloads) {
-                mCachedContent.insert(content.id(), content);
-                entries.append(entryFromAtticaContent(content));
-            } else {
-                qCDebug(KNEWSTUFFCORE) << "Filter has excluded" << content.name() << "on download filter" << downloadTagFilter();
-            }
-        } else {
-            qCDebug(KNEWSTUFFCORE) << "Filter has excluded" << content.name() << "on entry filter" << tagFilter();
-        }
+        cacheContent(content);
+        unfiltered.append(entryFromAtticaContent(content));
     }
+    // Changes to the tag filters can then be applied to this page without asking for it again
+    retainResults(mCurrentRequest, unfiltered);
+    const Entry::List entries = applyTagFilters(unfiltered);
 
     qCDebug(KNEWSTUFFCORE) << "loaded: " << mCurrentRequest.hashForRequest() << " count: " << entries.size();
     Q_EMIT loadingFinished(mCurrentRequest, entries);
@@ -331,7 +395,7 @@ Attica::Provider::SortMode AtticaProvider::atticaSortMode(SortMode sortMode)
 
 void AtticaProvider::loadPayloadLink(const KNSCore::Entry &entry, int linkId)
 {
-    Attica::Content content = mCachedContent.value(entry.uniqueId());
+    Attica::Content content = cachedContent(entry.uniqueId());
     const DownloadDescription desc = content.downloadUrlDescription(linkId);
 
     if (desc.hasPrice()) {
@@ -343,6 +407,25 @@ void AtticaProvider::loadPayloadLink(const KNSCore::Entry &entry, int linkId)
 
         qCDebug(KNEWSTUFFCORE) << "get account balance";
     } else {
+        const PayloadLinkId payloadLinkId(entry.uniqueId(), linkId);
+        if (hasFreshPayloadLink(payloadLinkId)) {
+            qCDebug(KNEWSTUFFCORE) << "Using the prefetched link" << linkId << "for" << entry.uniqueId();
+            Entry copy(entry);
+            copy.setPayload(mPayloadLinks.value(payloadLinkId).url.toString());
+            // Callers do not expect to be told about the link before this function returns
+            QTimer::singleShot(0, this, [this, copy]() {
+                Q_EMIT payloadLinkLoaded(copy);
+            });
+            return;
+        }
+        if (std::find(mPayloadLinkPrefetchJobs.cbegin(), mPayloadLinkPrefetchJobs.cend(), payloadLinkId) != mPayloadLinkPrefetchJobs.cend()) {
+            qCDebug(KNEWSTUFFCORE) << "Waiting for the prefetch of link" << linkId << "for" << entry.uniqueId();
+            mPayloadLinkWaiters.insert(payloadLinkId, entry);
+            return;
+        }
+        // Somebody wants it now, so it is not up to the prefetch queue anymore
+        mPayloadLinkPrefetchQueue.removeOne(payloadLinkId);
+
         ItemJob<DownloadItem> *job = m_provider.downloadLink(entry.uniqueId(), QString::number(linkId));
         connect(job, &BaseJob::finished, this, &AtticaProvider::downloadItemLoaded);
         mDownloadLinkJobs[job] = qMakePair(entry, linkId);
@@ -352,6 +435,135 @@ void AtticaProvider::loadPayloadLink(const KNSCore::Entry &entry, int linkId)
     }
 }
 
+void AtticaProvider::prefetchPayloadLink(const Entry &entry, int linkId)
+{
+    const Attica::Content content = cachedContent(entry.uniqueId());
+    if (!content.isValid() || content.downloadUrlDescription(linkId).hasPrice()) {
+        // Paid-for content means asking the user about their balance, which is nothing to do on speculation
+        return;
+    }
+    const PayloadLinkId payloadLinkId(entry.uniqueId(), linkId);
+    if (hasFreshPayloadLink(payloadLinkId)
+        || std::find(mPayloadLinkPrefetchJobs.cbegin(), mPayloadLinkPrefetchJobs.cend(), payloadLinkId) != mPayloadLinkPrefetchJobs.cend()
+        || mPayloadLinkPrefetchQueue.contains(payloadLinkId)) {
+        return;
+    }
+
+    // Speculative requests should not get in the way of the ones people are waiting for
+    static constexpr int maxPrefetchJobs = 2;
+    if (mPayloadLinkPrefetchJobs.count() >= maxPrefetchJobs) {
+        mPayloadLinkPrefetchQueue << payloadLinkId;
+        return;
+    }
+    startPayloadLinkPrefetch(payloadLinkId);
+}
+
+void AtticaProvider::startPayloadLinkPrefetch(const PayloadLinkId &payloadLinkId)
+{
+    ItemJob<DownloadItem> *job = m_provider.downloadLink(payloadLinkId.first, QString::number(payloadLinkId.second));
+    connect(job, &BaseJob::finished, this, &AtticaProvider::payloadLinkPrefetched);
+    mPayloadLinkPrefetchJobs.insert(job, payloadLinkId);
+    job->start();
+    qCDebug(KNEWSTUFFCORE) << "Prefetching link" << payloadLinkId.second << "for" << payloadLinkId.first;
+}
+
+qint64 AtticaProvider::memoryUsage() const
+{
+    qint64 size = 0;
+    for (const Entry &entry : std::as_const(mCachedEntries)) {
+        size += entry.memoryUsage();
+    }
+    for (const CachedContent &cached : std::as_const(mCachedContent)) {
+        size += sizeof(CachedContent);
+        const QMap<QString, QString> attributes = cached.content.attributes();
+        for (auto it = attributes.cbegin(); it != attributes.cend(); ++it) {
+            size += (it.key().size() + it.value().size()) * sizeof(QChar);
+        }
+    }
+    for (const PayloadLink &link : std::as_const(mPayloadLinks)) {
+        size += sizeof(PayloadLink) + link.url.toString().size() * sizeof(QChar);
+    }
+    return size;
+}
+
+void AtticaProvider::trimMemory()
+{
+    // Without the content, entry details and payload links are simply asked for again. Entries
+    // are needed to keep track of what is installed, so those stay.
+    qCDebug(KNEWSTUFFCORE) << "Dropping" << mCachedContent.count() << "cached contents and" << mPayloadLinks.count() << "payload links";
+    mCachedContent.clear();
+    mPayloadLinks.clear();
+}
+
+// Download links are frequently signed, and stop working after a while. If the link says when that
+// happens, we believe it, and otherwise we assume it is good for a little while.
+static QDateTime payloadLinkExpiry(const QUrl &url)
+{
+    static constexpr int defaultLifetime = 10 * 60;
+    static constexpr int safetyMargin = 30;
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    QDateTime expires = now.addSecs(defaultLifetime);
+    const QUrlQuery query(url);
+    for (const QString &key : {QStringLiteral("expires"), QStringLiteral("Expires")}) {
+        bool isTimestamp = false;
+        const qint64 timestamp = query.queryItemValue(key).toLongLong(&isTimestamp);
+        if (isTimestamp) {
+            expires = qMin(expires, QDateTime::fromSecsSinceEpoch(timestamp));
+        }
+    }
+    return expires.addSecs(-safetyMargin);
+}
+
+bool AtticaProvider::hasFreshPayloadLink(const PayloadLinkId &linkId) const
+{
+    const auto it = mPayloadLinks.constFind(linkId);
+    if (it == mPayloadLinks.constEnd() || it->expires <= QDateTime::currentDateTimeUtc()) {
+        return false;
+    }
+    // A newer version of the content may well have moved things around
+    const auto content = mCachedContent.constFind(linkId.first);
+    return content == mCachedContent.constEnd() || content->content.updated() == it->contentUpdated;
+}
+
+void AtticaProvider::payloadLinkPrefetched(Attica::BaseJob *baseJob)
+{
+    const PayloadLinkId payloadLinkId = mPayloadLinkPrefetchJobs.take(baseJob);
+    const QList<Entry> waiting = mPayloadLinkWaiters.values(payloadLinkId);
+    mPayloadLinkWaiters.remove(payloadLinkId);
+    while (!mPayloadLinkPrefetchQueue.isEmpty()) {
+        const PayloadLinkId next = mPayloadLinkPrefetchQueue.takeFirst();
+        if (!hasFreshPayloadLink(next)) {
+            startPayloadLinkPrefetch(next);
+            break;
+        }
+    }
+
+    if (baseJob->metadata().error() != Attica::Metadata::NoError) {
+        // Nobody asked for this, so there is nobody to complain to either. Anybody who asked
+        // in the meantime gets to try again, and will see errors as usual.
+        qCDebug(KNEWSTUFFCORE) << "Prefetching link" << payloadLinkId.second << "for" << payloadLinkId.first << "failed:" << baseJob->metadata().message();
+        for (const Entry &entry : waiting) {
+            loadPayloadLink(entry, payloadLinkId.second);
+        }
+        return;
+    }
+
+    // Forget about links which are of no use anymore
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    mPayloadLinks.removeIf([&now](const QHash<PayloadLinkId, PayloadLink>::iterator &it) {
+        return it->expires <= now;
+    });
+
+    auto *job = static_cast<ItemJob<DownloadItem> *>(baseJob);
+    const QUrl url = job->result().url();
+    mPayloadLinks.insert(payloadLinkId, PayloadLink{url, payloadLinkExpiry(url), cachedContent(payloadLinkId.first).updated()});
+    for (const Entry &entry : waiting) {
+        Entry copy(entry);
+        copy.setPayload(url.toString());
+        Q_EMIT payloadLinkLoaded(copy);
+    }
+}
+
 void AtticaProvider::loadComments(const Entry &entry, int commentsPerPage, int page)
 {
     ListJob<Attica::Comment> *job = m_provider.requestComments(Attica::Comment::ContentComment, entry.uniqueId(), QStringLiteral("0"), page, commentsPerPage);
@@ -471,7 +683,7 @@ void AtticaProvider::accountBalanceLoaded(Attica::BaseJob *baseJob)
 
     QPair<Entry, int> pair = mDownloadLinkJobs.take(job);
     Entry entry(pair.first);
-    Content content = mCachedContent.value(entry.uniqueId());
+    Content content = cachedContent(entry.uniqueId());
     if (content.downloadUrlDescription(pair.second).priceAmount() < item.balance()) {
         qCDebug(KNEWSTUFFCORE) << "Your balance is greater than the price." << content.downloadUrlDescription(pair.second).priceAmount()
                                << " balance: " << item.balance();
@@ -619,9 +831,8 @@ Entry AtticaProvider::entryFromAtticaContent(const Attica::Content &content)
     entry.setReleaseDate(content.updated().date());
     entry.setCategory(content.attribute(QStringLiteral("typeid")));
 
-    int index = mCachedEntries.indexOf(entry);
-    if (index >= 0) {
-        Entry &cacheEntry = mCachedEntries[index];
+    if (mCachedEntries.contains(entry.key())) {
+        Entry cacheEntry = mCachedEntries.value(entry.key());
         // check if updateable
         if (((cacheEntry.status() == KNSCore::Entry::Installed) || (cacheEntry.status() == KNSCore::Entry::Updateable))
             && ((cacheEntry.version() != entry.version()) || (cacheEntry.releaseDate() != entry.releaseDate()))) {
@@ -631,7 +842,7 @@ Entry AtticaProvider::entryFromAtticaContent(const Attica::Content &content)
         }
         entry = cacheEntry;
     } else {
-        mCachedEntries.append(entry);
+        mCachedEntries.insert(entry);
     }
 
     entry.setName(content.name());
@@ -14,6 +14,7 @@
 #include <attica/provider.h>
 #include <attica/providermanager.h>
 
+#include "cachedentries_p.h"
 #include "provider.h"
 
 namespace Attica
@@ -55,6 +56,9 @@ public:
     void loadEntries(const KNSCore::Provider::SearchRequest &request) override;
     void loadEntryDetails(const KNSCore::Entry &entry) override;
     void loadPayloadLink(const Entry &entry, int linkId) override;
+    void prefetchPayloadLink(const Entry &entry, int linkId) override;
+    qint64 memoryUsage() const override;
+    void trimMemory() override;
     /**
      * The slot which causes loading of comments for the Attica provider
      * @see Provider::loadComments(const Entry &entry, int commentsPerPage, int page)
@@ -94,6 +98,7 @@ private Q_SLOTS:
     void listOfCategoriesLoaded(Attica::BaseJob *);
     void categoryContentsLoaded(Attica::BaseJob *job);
     void downloadItemLoaded(Attica::BaseJob *job);
+    void payloadLinkPrefetched(Attica::BaseJob *job);
     void accountBalanceLoaded(Attica::BaseJob *job);
     void onAuthenticationCredentialsMissing(const Attica::Provider &);
     void votingFinished(Attica::BaseJob *);
@@ -118,19 +123,48 @@ private:
     Attica::ProviderManager m_providerManager;
     Attica::Provider m_provider;
 
-    KNSCore::Entry::List mCachedEntries;
-    QHash<QString, Attica::Content> mCachedContent;
+    CachedEntries mCachedEntries;
+
+    // The content most recently seen for each id, along with when we saw it. This is what details,
+    // update checks and payload links are worked out from, for as long as it is fresh enough.
+    struct CachedContent {
+        Attica::Content content;
+        QDateTime fetched;
+    };
+    QHash<QString, CachedContent> mCachedContent;
+    void cacheContent(const Attica::Content &content);
+    Attica::Content cachedContent(const QString &id) const;
+    bool hasFreshContent(const QString &id) const;
 
     // Associate job and entry, this is needed when fetching
     // download links or the account balance in order to continue
     // when the result is there.
     QHash<Attica::BaseJob *, QPair<Entry, int>> mDownloadLinkJobs;
 
+    // Payload links resolved ahead of time, identified by content id and link id
+    typedef QPair<QString, int> PayloadLinkId;
+    struct PayloadLink {
+        QUrl url;
+        QDateTime expires;
+        QDateTime contentUpdated; // The content the link was resolved for, so we know when it is outdated
+    };
+    bool hasFreshPayloadLink(const PayloadLinkId &linkId) const;
+    QHash<PayloadLinkId, PayloadLink> mPayloadLinks;
+    QHash<Attica::BaseJob *, PayloadLinkId> mPayloadLinkPrefetchJobs;
+    // Prefetches waiting for one of the few running at a time to finish
+    QList<PayloadLinkId> mPayloadLinkPrefetchQueue;
+    void startPayloadLinkPrefetch(const PayloadLinkId &payloadLinkId);
+    // Entries someone asked the payload link for while it was being prefetched
+    QMultiHash<PayloadLinkId, Entry> mPayloadLinkWaiters;
+
     // keep track of the current request
     QPointer<Attica::BaseJob> mEntryJob;
     Provider::SearchRequest mCurrentRequest;
 
     QSet<Attica::BaseJob *> m_updateJobs;
+    // Installed entries still to be checked for updates, as only a few are checked at a time
+    QStringList m_pendingUpdateChecks;
+    void startUpdateChecks();
 
     bool mInitialized;
     QString m_providerId;
@@ -6,6 +6,7 @@
 */
 
 #include "cache.h"
+#include "trigramindex_p.h"
 
 #include <QDir>
 #include <QDomElement>
@@ -13,6 +14,7 @@
 #include <QFileInfo>
 #include <QFileSystemWatcher>
 #include <QPointer>
+#include <QSet>
 #include <QTimer>
 #include <QXmlStreamReader>
 #include <knewstuffcore_debug.h>
@@ -39,6 +41,11 @@ public:
 
     QSet<Entry> cache;
 
+    // Covers both the registry and the remembered requests. Rebuilt when next searched after
+    // anything was dropped from either, and otherwise kept up to date as entries come in.
+    TrigramIndex searchIndex;
+    bool searchIndexDirty = true;
+
     bool dirty = false;
     bool writingRegistry = false;
     bool reloadingRegistry = false;
@@ -79,6 +86,7 @@ Cache::Cache(const QString &appName)
             QTimer::singleShot(0, this, changeChecker);
         } else {
             d->reloadingRegistry = true;
+            d->searchIndexDirty = true;
             const QSet<KNSCore::Entry> oldCache = d->cache;
             d->cache.clear();
             readRegistry();
@@ -171,6 +179,7 @@ void Cache::readRegistry()
         d->cache.insert(e);
         Q_ASSERT(reader.tokenType() == QXmlStreamReader::EndElement);
     }
+    d->searchIndexDirty = true;
 
     qCDebug(KNEWSTUFFCORE) << "Cache read... entries: " << d->cache.size();
 }
@@ -241,21 +250,148 @@ void Cache::registerChangedEntry(const KNSCore::Entry &entry)
         d->cache.remove(entry); // If value already exists in the set, the set is left unchanged
         d->cache.insert(entry);
         d->throttleWrite();
+        if (!d->searchIndexDirty) {
+            d->searchIndex.add(entry);
+        }
+        Q_EMIT entryRegistered(entry);
     }
 }
 
 void Cache::insertRequest(const KNSCore::Provider::SearchRequest &request, const KNSCore::Entry::List &entries)
 {
-    // append new entries
+    if (!d->searchIndexDirty) {
+        d->searchIndex.add(entries);
+    }
     auto &cacheList = d->requestCache[request.hashForRequest()];
+    if (cacheList.isEmpty()) {
+        // The common case: a page we have not seen before, which we can simply share with the provider
+        cacheList = entries;
+        qCDebug(KNEWSTUFFCORE) << request.hashForRequest() << " add to cache: " << entries.size() << " keys: " << d->requestCache.keys();
+        return;
+    }
+
+    // append new entries
+    QSet<EntryKey> knownEntries;
+    knownEntries.reserve(cacheList.size());
+    for (const auto &entry : std::as_const(cacheList)) {
+        knownEntries.insert(entry.key());
+    }
     for (const auto &entry : entries) {
-        if (!cacheList.contains(entry)) {
+        if (!knownEntries.contains(entry.key())) {
+            knownEntries.insert(entry.key());
             cacheList.append(entry);
         }
     }
     qCDebug(KNEWSTUFFCORE) << request.hashForRequest() << " add to cache: " << entries.size() << " keys: " << d->requestCache.keys();
 }
 
+void Cache::replaceRequest(const KNSCore::Provider::SearchRequest &request, const KNSCore::Entry::List &entries)
+{
+    d->requestCache.insert(request.hashForRequest(), entries);
+    // What was dropped may still be in the search index
+    d->searchIndexDirty = true;
+}
+
+void Cache::removeRequest(const KNSCore::Provider::SearchRequest &request)
+{
+    if (d->requestCache.remove(request.hashForRequest())) {
+        d->searchIndexDirty = true;
+    }
+}
+
+void Cache::clearRequestCache()
+{
+    qCDebug(KNEWSTUFFCORE) << "Dropping" << d->requestCache.count() << "remembered requests";
+    d->requestCache.clear();
+    d->searchIndexDirty = true;
+}
+
+Entry::List Cache::search(const QString &term, int maxResults)
+{
+    if (d->searchIndexDirty) {
+        d->searchIndex.clear();
+        for (const Entry &entry : std::as_const(d->cache)) {
+            d->searchIndex.add(entry);
+        }
+        // Entries seen in results are more recent than what the registry remembers of them
+        for (const Entry::List &entries : std::as_const(d->requestCache)) {
+            d->searchIndex.add(entries);
+        }
+        d->searchIndexDirty = false;
+        qCDebug(KNEWSTUFFCORE) << "Indexed" << d->searchIndex.count() << "entries for searching";
+    }
+    return d->searchIndex.search(term, maxResults);
+}
+
+qint64 Cache::registryMemoryUsage() const
+{
+    qint64 size = 0;
+    for (const Entry &entry : std::as_const(d->cache)) {
+        size += entry.memoryUsage();
+    }
+    return size;
+}
+
+qint64 Cache::requestCacheMemoryUsage() const
+{
+    // Pages are frequently shared between requests, so only count each of them once
+    QSet<const Entry *> pages;
+    qint64 size = 0;
+    for (const Entry::List &entries : std::as_const(d->requestCache)) {
+        if (entries.isEmpty() || pages.contains(entries.constData())) {
+            continue;
+        }
+        pages.insert(entries.constData());
+        size += entries.capacity() * sizeof(Entry);
+        for (const Entry &entry : entries) {
+            size += entry.memoryUsage();
+        }
+    }
+    return size;
+}
+
+template<typename Function>
+static void forEachPreviewImage(const QSet<Entry> &registry, const QHash<QString, Entry::List> &requestCache, Function function)
+{
+    // The same entry shows up in many places, but its images only need looking at once
+    QSet<EntryKey> seen;
+    auto visit = [&seen, &function](const Entry &entry) {
+        if (seen.contains(entry.key())) {
+            return;
+        }
+        seen.insert(entry.key());
+        for (int type = Entry::PreviewSmall1; type <= Entry::PreviewBig3; ++type) {
+            function(entry, static_cast<Entry::PreviewType>(type));
+        }
+    };
+    for (const Entry &entry : registry) {
+        visit(entry);
+    }
+    for (const Entry::List &entries : requestCache) {
+        for (const Entry &entry : entries) {
+            visit(entry);
+        }
+    }
+}
+
+qint64 Cache::previewImageMemoryUsage() const
+{
+    qint64 size = 0;
+    forEachPreviewImage(d->cache, d->requestCache, [&size](const Entry &entry, Entry::PreviewType type) {
+        size += entry.previewImage(type).sizeInBytes();
+    });
+    return size;
+}
+
+void Cache::clearPreviewImages()
+{
+    forEachPreviewImage(d->cache, d->requestCache, [](Entry entry, Entry::PreviewType type) {
+        if (!entry.previewImage(type).isNull()) {
+            entry.setPreviewImage(QImage(), type);
+        }
+    });
+}
+
 Entry::List Cache::requestFromCache(const KNSCore::Provider::SearchRequest &request)
 {
     qCDebug(KNEWSTUFFCORE) << "from cache" << request.hashForRequest();
@@ -284,6 +420,7 @@ void KNSCore::Cache::removeDeletedEntries()
         if (!installedFileExists) {
             i.remove();
             d->dirty = true;
+            d->searchIndexDirty = true;
         }
     }
     writeRegistry();
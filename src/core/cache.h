@@ -48,9 +48,69 @@ public:
     /// Save the list of installed entries
     void writeRegistry();
 
+    /**
+     * Remember the entries a request resulted in. A request seen for the first time shares
+     * the list with the caller rather than copying it, so treat result pages as immutable.
+     */
     void insertRequest(const KNSCore::Provider::SearchRequest &, const KNSCore::Entry::List &entries);
+    /**
+     * The entries previously remembered for the request. The returned list is shared with the cache.
+     */
     Entry::List requestFromCache(const KNSCore::Provider::SearchRequest &);
 
+    /**
+     * Remember exactly the given entries for the request, in place of what was remembered for it before
+     * @since 6.0
+     */
+    void replaceRequest(const KNSCore::Provider::SearchRequest &request, const KNSCore::Entry::List &entries);
+
+    /**
+     * Forget what was remembered for the request, so it is loaded from the providers again when next needed
+     * @since 6.0
+     */
+    void removeRequest(const KNSCore::Provider::SearchRequest &request);
+
+    /**
+     * Forget all remembered requests, so they are loaded from the providers again when next needed
+     * @since 6.0
+     */
+    void clearRequestCache();
+
+    /**
+     * Search the registry and remembered requests for entries whose name, summary, author
+     * or tags are similar to the search term. This needs no network, and copes with typos.
+     * @param term What to look for
+     * @param maxResults The largest number of entries to return
+     * @return The matching entries, best first
+     * @since 6.0
+     */
+    Entry::List search(const QString &term, int maxResults = 50);
+
+    /**
+     * A rough estimate of the memory held by the registry, in bytes, not counting decoded preview images
+     * @since 6.0
+     */
+    qint64 registryMemoryUsage() const;
+
+    /**
+     * A rough estimate of the memory held by remembered requests, in bytes, not counting decoded preview images
+     * @since 6.0
+     */
+    qint64 requestCacheMemoryUsage() const;
+
+    /**
+     * The memory held by the decoded preview images of the entries in the registry and remembered requests, in bytes
+     * @since 6.0
+     */
+    qint64 previewImageMemoryUsage() const;
+
+    /**
+     * Drop the decoded preview images of the entries in the registry and remembered requests.
+     * They are loaded again (usually from the disk cache) when next shown.
+     * @since 6.0
+     */
+    void clearPreviewImages();
+
     /**
      * This will run through all entries in the cache, and remove all entries
      * where all the installed files they refer to no longer exist.
@@ -83,6 +143,14 @@ public:
      */
     Q_SIGNAL void entryChanged(const KNSCore::Entry &entry);
 
+    /**
+     * Emitted when registerChangedEntry() has recorded a change to an entry, for example
+     * because it was installed or uninstalled
+     * @param entry The entry as it is now
+     * @since 6.0
+     */
+    Q_SIGNAL void entryRegistered(const KNSCore::Entry &entry);
+
 public Q_SLOTS:
     void registerChangedEntry(const KNSCore::Entry &entry);
 
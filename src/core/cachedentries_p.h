@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KNEWSTUFF3_CACHEDENTRIES_P_H
+#define KNEWSTUFF3_CACHEDENTRIES_P_H
+
+#include <QHash>
+
+#include "entry.h"
+
+namespace KNSCore
+{
+/**
+ * The entries a provider knows about, in the order it got to know them, which is the order
+ * they are handed out in (installedEntries(), say). Entries are looked up by their key.
+ *
+ * @internal
+ */
+class CachedEntries
+{
+public:
+    void clear()
+    {
+        m_entries.clear();
+        m_rows.clear();
+    }
+
+    /**
+     * Add an entry at the end, or replace the one with the same key where it is
+     */
+    void insert(const KNSCore::Entry &entry)
+    {
+        const auto row = m_rows.constFind(entry.key());
+        if (row != m_rows.constEnd()) {
+            m_entries[*row] = entry;
+        } else {
+            m_rows.insert(entry.key(), m_entries.count());
+            m_entries.append(entry);
+        }
+    }
+
+    bool contains(EntryKey key) const
+    {
+        return m_rows.contains(key);
+    }
+
+    /**
+     * The entry with the given key, or an invalid one if there is none
+     */
+    KNSCore::Entry value(EntryKey key) const
+    {
+        const auto row = m_rows.constFind(key);
+        return row != m_rows.constEnd() ? m_entries.at(*row) : Entry();
+    }
+
+    Entry::List::const_iterator begin() const
+    {
+        return m_entries.cbegin();
+    }
+    Entry::List::const_iterator end() const
+    {
+        return m_entries.cend();
+    }
+
+private:
+    Entry::List m_entries;
+    QHash<EntryKey, int> m_rows;
+};
+
+}
+
+#endif
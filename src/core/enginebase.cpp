@@ -16,20 +16,32 @@
 #include <KFormat>
 #include <KLocalizedString>
 
+#include <QDir>
 #include <QFileInfo>
+#include <QMap>
 #include <QNetworkRequest>
 #include <QProcess>
+#include <QSet>
+#include <QSocketNotifier>
 #include <QStandardPaths>
 #include <QThreadStorage>
 #include <QTimer>
 
+#include <algorithm>
+
 #include "attica/atticaprovider_p.h"
+#include "jobs/connectivity.h"
 #include "opds/opdsprovider_p.h"
 #include "resultsstream.h"
 #include "staticxml/staticxmlprovider_p.h"
 #include "transaction.h"
 #include "xmlloader_p.h"
 
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 using namespace KNSCore;
 
 typedef QHash<QUrl, QPointer<XmlLoader>> EngineProviderLoaderHash;
@@ -42,6 +54,7 @@ EngineBase::EngineBase(QObject *parent)
     connect(d->installation, &Installation::signalInstallationError, this, [this](const QString &message) {
         Q_EMIT signalErrorCode(ErrorCode::InstallationError, i18n("An error occurred during the installation process:\n%1", message), QVariant());
     });
+    connect(Connectivity::instance(), &Connectivity::onlineChanged, this, &EngineBase::onlineChanged);
 }
 
 QStringList EngineBase::availableConfigFiles()
@@ -59,6 +72,7 @@ EngineBase::~EngineBase()
     if (d->cache) {
         d->cache->writeRegistry();
     }
+    setTrimOnMemoryPressure(false);
     delete d->atticaProviderManager;
     delete d->installation;
 }
@@ -96,6 +110,8 @@ bool EngineBase::init(const QString &configfile)
         return false;
     }
 
+    // signalProvidersLoaded() is emitted again once the providers of this configuration are there
+    d->providersLoaded = false;
     d->name = group.readEntry("Name");
     d->categories = group.readEntry("Categories", QStringList());
     qCDebug(KNEWSTUFFCORE) << "Categories: " << d->categories;
@@ -110,9 +126,15 @@ bool EngineBase::init(const QString &configfile)
         // The local providers file is called "appname.providers", to match "appname.knsrc"
         d->providerFileUrl = QUrl::fromLocalFile(QLatin1String("%1.providers").arg(configfile.left(configfile.length() - 6)));
     }
+    const QString mirror = group.readEntry("Mirror");
+    if (!mirror.isEmpty()) {
+        // A mirror built by MirrorBuilder, which serves everything from a local directory
+        d->providerFileUrl = QUrl::fromLocalFile(QDir(mirror).filePath(QStringLiteral("mirror.providers")));
+    }
 
     d->tagFilter = group.readEntry("TagFilter", QStringList(QStringLiteral("ghns_excluded!=1")));
     d->downloadTagFilter = group.readEntry("DownloadTagFilter", QStringList());
+    d->requestDeadline = qMax(0, group.readEntry("RequestDeadline", 30)) * 1000;
 
     // Make sure that config is valid
     QString error;
@@ -251,22 +273,102 @@ void EngineBase::addProvider(QSharedPointer<KNSCore::Provider> provider)
     connect(provider.data(), &Provider::signalErrorCode, this, &EngineBase::signalErrorCode);
     connect(provider.data(), &Provider::signalInformation, this, &EngineBase::signalMessage);
     connect(provider.data(), &Provider::basicsLoaded, this, &EngineBase::providersChanged);
+    connect(provider.data(), &Provider::loadingFinished, this, [this](const KNSCore::Provider::SearchRequest &request, const KNSCore::Entry::List &entries) {
+        if (request.filter != Provider::Installed && request.filter != Provider::Updates) {
+            d->loadedRequests.insert(request.hashForRequest(), request);
+        }
+        // Entries which can be updated are quite likely to be, so make that quick, though only for the
+        // first few of them, as a long list of updates would otherwise turn into a burst of requests
+        static constexpr int maxPrefetchedEntries = 4;
+        int prefetched = 0;
+        for (const Entry &entry : entries) {
+            if (prefetched >= maxPrefetchedEntries) {
+                break;
+            }
+            if (entry.status() == Entry::Updateable) {
+                prefetchPayloadLinks(entry);
+                ++prefetched;
+            }
+        }
+    });
+    connect(provider.data(), &Provider::entryDetailsLoaded, this, [this](const KNSCore::Entry &entry) {
+        const QDateTime now = QDateTime::currentDateTimeUtc();
+        if (d->entryDetails.size() >= EngineBasePrivate::maxEntryDetails && !d->entryDetails.contains(entry.key())) {
+            // Make room, first by dropping what is too old to be used anyway, and failing that the oldest of them
+            d->entryDetails.removeIf([&now](const auto &it) {
+                return it.value().second.secsTo(now) > EngineBasePrivate::detailsLifetime;
+            });
+            if (d->entryDetails.size() >= EngineBasePrivate::maxEntryDetails) {
+                const auto oldest = std::min_element(d->entryDetails.cbegin(), d->entryDetails.cend(), [](const auto &a, const auto &b) {
+                    return a.second < b.second;
+                });
+                d->entryDetails.erase(oldest);
+            }
+        }
+        d->entryDetails.insert(entry.key(), qMakePair(entry, now));
+    });
     Q_EMIT providersChanged();
+
+    if (isOffline()) {
+        // Providers which need the network will not get initialized until it comes back, so go with what
+        // we have locally. Not straight away, as the rest of the providers in the file are still to be added.
+        QTimer::singleShot(0, this, [this]() {
+            if (!d->providersLoaded && isOffline()) {
+                qCDebug(KNEWSTUFFCORE) << "Offline, not waiting for the providers of" << d->name << "to be initialized";
+                d->providersLoaded = true;
+                Q_EMIT signalProvidersLoaded();
+            }
+        });
+    }
 }
 
 void EngineBase::providerInitialized(Provider *p)
 {
     qCDebug(KNEWSTUFFCORE) << "providerInitialized" << p->name();
-    p->setCachedEntries(d->cache->registryForProvider(p->id()));
+    p->setCachedEntries(cachedEntriesForProvider(p->id()));
 
     for (const QSharedPointer<KNSCore::Provider> &p : std::as_const(d->providers)) {
         if (!p->isInitialized()) {
             return;
         }
     }
+    d->providersLoaded = true;
     Q_EMIT signalProvidersLoaded();
 }
 
+Entry::List EngineBase::cachedEntriesForProvider(const QString &providerId) const
+{
+    return d->cache->registryForProvider(providerId);
+}
+
+bool EngineBase::isOffline() const
+{
+    return !Connectivity::instance()->isOnline();
+}
+
+void EngineBase::onlineChanged(bool online)
+{
+    Q_EMIT offlineChanged();
+    if (!online || !d->cache) {
+        return;
+    }
+    bool allInitialized = !d->providers.isEmpty();
+    for (const QSharedPointer<KNSCore::Provider> &p : std::as_const(d->providers)) {
+        allInitialized = allInitialized && p->isInitialized();
+    }
+    if (!allInitialized) {
+        // signalProvidersLoaded() is emitted again once they are all there
+        qCDebug(KNEWSTUFFCORE) << "Back online, loading the providers of" << d->name << "again";
+        d->providersLoaded = false;
+        loadProviders();
+    } else {
+        // What we showed while offline came from the caches, so ask again
+        qCDebug(KNEWSTUFFCORE) << "Back online, refreshing the results of" << d->name;
+        d->removeLoadedRequests();
+        Q_EMIT signalProvidersLoaded();
+    }
+}
+
 void EngineBase::slotProvidersFailed()
 {
     Q_EMIT signalErrorCode(KNSCore::ProviderError, i18n("Loading of providers from file: %1 failed", d->providerFileUrl.toString()), d->providerFileUrl);
@@ -314,6 +416,10 @@ void EngineBase::slotProviderFileLoaded(const QDomDocument &doc)
             provider.reset(new StaticXmlProvider);
         }
 
+        if (d->providerFileUrl.isLocalFile() && n.hasAttribute(QStringLiteral("downloadurl"))) {
+            // Local providers files (such as those of mirrors) may refer to feeds next to them
+            n.setAttribute(QStringLiteral("downloadurl"), d->providerFileUrl.resolved(QUrl(n.attribute(QStringLiteral("downloadurl")))).toString());
+        }
         if (provider->setProviderXML(n)) {
             addProvider(provider);
         } else {
@@ -346,10 +452,14 @@ QSharedPointer<Cache> EngineBase::cache() const
 
 void EngineBase::setTagFilter(const QStringList &filter)
 {
+    if (d->tagFilter == filter) {
+        return;
+    }
     d->tagFilter = filter;
     for (const QSharedPointer<KNSCore::Provider> &p : std::as_const(d->providers)) {
         p->setTagFilter(d->tagFilter);
     }
+    refilterResults();
 }
 
 QStringList EngineBase::tagFilter() const
@@ -359,18 +469,26 @@ QStringList EngineBase::tagFilter() const
 
 void KNSCore::EngineBase::addTagFilter(const QString &filter)
 {
+    if (d->tagFilter.contains(filter)) {
+        return;
+    }
     d->tagFilter << filter;
     for (const QSharedPointer<KNSCore::Provider> &p : std::as_const(d->providers)) {
         p->setTagFilter(d->tagFilter);
     }
+    refilterResults();
 }
 
 void EngineBase::setDownloadTagFilter(const QStringList &filter)
 {
+    if (d->downloadTagFilter == filter) {
+        return;
+    }
     d->downloadTagFilter = filter;
     for (const QSharedPointer<KNSCore::Provider> &p : std::as_const(d->providers)) {
         p->setDownloadTagFilter(d->downloadTagFilter);
     }
+    refilterResults();
 }
 
 QStringList EngineBase::downloadTagFilter() const
@@ -380,10 +498,85 @@ QStringList EngineBase::downloadTagFilter() const
 
 void EngineBase::addDownloadTagFilter(const QString &filter)
 {
+    if (d->downloadTagFilter.contains(filter)) {
+        return;
+    }
     d->downloadTagFilter << filter;
     for (const QSharedPointer<KNSCore::Provider> &p : std::as_const(d->providers)) {
         p->setDownloadTagFilter(d->downloadTagFilter);
     }
+    refilterResults();
+}
+
+void EngineBase::refilterResults()
+{
+    if (!d->cache || d->providers.isEmpty()) {
+        return;
+    }
+
+    // Providers hold on to what they loaded before filtering it, so the new filters can be applied to that.
+    // The results of all providers for a request share one page in the cache.
+    struct Page {
+        Provider::SearchRequest request;
+        // What passes the new filters, by provider (ordered, so that entries new to the page come in a stable order)
+        QMap<QString, Entry::List> accepted;
+    };
+    QHash<QString, Page> pages;
+    for (const QSharedPointer<KNSCore::Provider> &p : std::as_const(d->providers)) {
+        const QList<Provider::SearchRequest> requests = p->retainedRequests();
+        for (const Provider::SearchRequest &request : requests) {
+            if (request.filter == Provider::Installed || request.filter == Provider::Updates) {
+                // These are never remembered
+                continue;
+            }
+            Page &page = pages[request.hashForRequest()];
+            page.request = request;
+            page.accepted.insert(p->id(), p->applyTagFilters(p->retainedResults(request)));
+        }
+    }
+
+    // Only the pages we rebuilt are replaced, the cache being shared with any other engine for this configuration
+    for (const Page &page : std::as_const(pages)) {
+        QHash<EntryKey, Entry> accepted;
+        for (const Entry::List &entries : page.accepted) {
+            for (const Entry &entry : entries) {
+                accepted.insert(entry.key(), entry);
+            }
+        }
+        // In the order the entries came in, with those the old filters turned down after them
+        Entry::List entries;
+        QSet<EntryKey> added;
+        const Entry::List cached = d->cache->requestFromCache(page.request);
+        for (const Entry &entry : cached) {
+            if (page.accepted.contains(entry.providerId())) {
+                const auto it = accepted.constFind(entry.key());
+                if (it != accepted.constEnd()) {
+                    entries << it.value();
+                    added.insert(entry.key());
+                }
+            } else if (const QSharedPointer<Provider> provider = d->providers.value(entry.providerId())) {
+                // Providers which did not hold on to the request can still be narrowed down
+                if (!provider->applyTagFilters({entry}).isEmpty()) {
+                    entries << entry;
+                    added.insert(entry.key());
+                }
+            } else {
+                entries << entry;
+                added.insert(entry.key());
+            }
+        }
+        for (const Entry::List &providerEntries : page.accepted) {
+            for (const Entry &entry : providerEntries) {
+                if (!added.contains(entry.key())) {
+                    entries << entry;
+                    added.insert(entry.key());
+                }
+            }
+        }
+        d->cache->replaceRequest(page.request, entries);
+    }
+    qCDebug(KNEWSTUFFCORE) << "Applied the new tag filters to" << pages.count() << "result pages";
+    Q_EMIT resultsRefiltered();
 }
 
 QList<Attica::Provider *> EngineBase::atticaProviders() const
@@ -450,6 +643,21 @@ void EngineBase::updateStatus()
 {
 }
 
+Entry EngineBase::cachedEntryDetails(const Entry &entry) const
+{
+    const auto it = d->entryDetails.constFind(entry.key());
+    if (it == d->entryDetails.constEnd()) {
+        return Entry();
+    }
+    const Entry &details = it->first;
+    // Details rarely change without the version changing as well, but they do sometimes
+    if (it->second.secsTo(QDateTime::currentDateTimeUtc()) > EngineBasePrivate::detailsLifetime || details.version() != entry.version()
+        || details.releaseDate() != entry.releaseDate() || details.status() != entry.status()) {
+        return Entry();
+    }
+    return details;
+}
+
 Installation *EngineBase::installation() const
 {
     return d->installation;
@@ -457,7 +665,79 @@ Installation *EngineBase::installation() const
 
 ResultsStream *EngineBase::search(const Provider::SearchRequest &request)
 {
-    return new ResultsStream(request, this);
+    Provider::SearchRequest withDeadline = request;
+    if (withDeadline.deadline <= 0) {
+        withDeadline.deadline = d->requestDeadline;
+    }
+    return new ResultsStream(withDeadline, this);
+}
+
+int EngineBase::requestDeadline() const
+{
+    return d->requestDeadline;
+}
+
+void EngineBase::prefetchPayloadLinks(const Entry &entry)
+{
+    // Entries with a lot of download links are usually offering variants of the same thing,
+    // and there is no point in resolving every one of them
+    static constexpr int maxPrefetchedLinks = 4;
+    if (!d->prefetchPayloadLinks) {
+        return;
+    }
+    QSharedPointer<Provider> p = d->providers.value(entry.providerId());
+    if (!p || !p->isInitialized()) {
+        return;
+    }
+    const QList<Entry::DownloadLinkInformation> links = entry.downloadLinkInformationList();
+    for (int i = 0; i < qMin(int(links.count()), maxPrefetchedLinks); ++i) {
+        p->prefetchPayloadLink(entry, links.at(i).id);
+    }
+}
+
+Entry::List EngineBase::searchLocally(const Provider::SearchRequest &request) const
+{
+    // Attica entries know their category by id, where requests name them
+    QSet<QString> categories;
+    for (const QString &category : request.categories) {
+        categories.insert(category);
+        for (const Provider::CategoryMetadata &metadata : std::as_const(d->categoriesMetadata)) {
+            if (metadata.name == category) {
+                categories.insert(metadata.id);
+            }
+        }
+    }
+
+    const Entry::List found = d->cache->search(request.searchTerm);
+    QHash<QString, Entry::List> byProvider;
+    for (const Entry &entry : found) {
+        if (categories.isEmpty() || categories.contains(entry.category())) {
+            byProvider[entry.providerId()] << entry;
+        }
+    }
+    // Entries of providers which are not in use anymore are left out as well
+    QSet<EntryKey> accepted;
+    for (auto it = byProvider.cbegin(); it != byProvider.cend(); ++it) {
+        if (const QSharedPointer<Provider> provider = d->providers.value(it.key())) {
+            const Entry::List entries = provider->applyTagFilters(it.value());
+            for (const Entry &entry : entries) {
+                accepted.insert(entry.key());
+            }
+        }
+    }
+
+    Entry::List entries;
+    for (const Entry &entry : found) {
+        if (accepted.contains(entry.key())) {
+            entries << entry;
+        }
+    }
+    return entries;
+}
+
+void EngineBase::setPrefetchPayloadLinks(bool prefetch)
+{
+    d->prefetchPayloadLinks = prefetch;
 }
 
 QList<QSharedPointer<Provider>> EngineBase::providers() const
@@ -465,4 +745,84 @@ QList<QSharedPointer<Provider>> EngineBase::providers() const
     return d->providers.values();
 }
 
+EngineBase::MemoryUsage EngineBase::memoryUsage() const
+{
+    MemoryUsage usage;
+    if (d->cache) {
+        usage.registry = d->cache->registryMemoryUsage();
+        usage.requestCache = d->cache->requestCacheMemoryUsage();
+        usage.previewImages = d->cache->previewImageMemoryUsage();
+    }
+    for (const auto &details : std::as_const(d->entryDetails)) {
+        usage.entryDetails += details.first.memoryUsage();
+    }
+    for (const QSharedPointer<Provider> &provider : std::as_const(d->providers)) {
+        usage.providers += provider->memoryUsage();
+    }
+    return usage;
+}
+
+void EngineBase::trimMemory(MemoryTrimLevel level)
+{
+    const MemoryUsage before = memoryUsage();
+    if (d->cache) {
+        d->cache->clearPreviewImages();
+    }
+    if (level >= TrimEntryDetails) {
+        d->entryDetails.clear();
+    }
+    if (level >= TrimProviderCaches) {
+        for (const QSharedPointer<Provider> &provider : std::as_const(d->providers)) {
+            provider->trimMemory();
+        }
+    }
+    if (level >= TrimRequestCache && d->cache) {
+        d->removeLoadedRequests();
+    }
+    qCDebug(KNEWSTUFFCORE) << "Trimmed memory of" << d->name << "up to" << level << "from" << before.total() << "to" << memoryUsage().total() << "bytes";
+    Q_EMIT memoryTrimmed(level);
+}
+
+void EngineBase::setTrimOnMemoryPressure(bool enabled)
+{
+    if (enabled == trimOnMemoryPressure()) {
+        return;
+    }
+#ifdef Q_OS_LINUX
+    if (!enabled) {
+        delete d->memoryPressureNotifier;
+        d->memoryPressureNotifier = nullptr;
+        ::close(d->memoryPressureFd);
+        d->memoryPressureFd = -1;
+        return;
+    }
+    // Notify us when tasks were stalled on memory for 150ms or more within a two second window,
+    // which is the shortest window unprivileged processes are allowed
+    static const QByteArray trigger("some 150000 2000000");
+    d->memoryPressureFd = ::open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (d->memoryPressureFd < 0 || ::write(d->memoryPressureFd, trigger.constData(), trigger.size() + 1) < 0) {
+        qCWarning(KNEWSTUFFCORE) << "Could not watch for memory pressure, the kernel may not support pressure stall information";
+        if (d->memoryPressureFd >= 0) {
+            ::close(d->memoryPressureFd);
+            d->memoryPressureFd = -1;
+        }
+        return;
+    }
+    d->memoryPressureNotifier = new QSocketNotifier(d->memoryPressureFd, QSocketNotifier::Exception, this);
+    connect(d->memoryPressureNotifier, &QSocketNotifier::activated, this, [this]() {
+        // Pressure which comes back within a minute of us trimming was not relieved enough by it
+        static constexpr int persistentPressureInterval = 60000;
+        const bool persistent = d->lastMemoryPressure.isValid() && d->lastMemoryPressure.elapsed() < persistentPressureInterval;
+        d->lastMemoryPressure.start();
+        qCDebug(KNEWSTUFFCORE) << "Memory pressure, persistent:" << persistent;
+        trimMemory(persistent ? TrimRequestCache : TrimProviderCaches);
+    });
+#endif
+}
+
+bool EngineBase::trimOnMemoryPressure() const
+{
+    return d->memoryPressureNotifier;
+}
+
 #include "moc_enginebase.cpp"
@@ -70,6 +70,13 @@ class KNEWSTUFFCORE_EXPORT EngineBase : public QObject
      */
     Q_PROPERTY(QStringList providerIDs READ providerIDs NOTIFY providersChanged)
 
+    /**
+     * Whether the network is unavailable, in which case everything shown comes from local
+     * caches and may be out of date
+     * @since 6.0
+     */
+    Q_PROPERTY(bool offline READ isOffline NOTIFY offlineChanged)
+
 public:
     EngineBase(QObject *parent = nullptr);
     ~EngineBase();
@@ -330,11 +337,106 @@ public:
 
     /**
      * Returns a stream object that will fulfill the @p request.
+     * Requests without a deadline are given the one of the engine, see requestDeadline().
      *
      * @since 6.0
      */
     ResultsStream *search(const KNSCore::Provider::SearchRequest &request);
 
+    /**
+     * How long, in milliseconds, requests for entries may go without any data arriving before they are considered stalled,
+     * as set by the RequestDeadline key (in seconds) of the knsrc file. 30 seconds by default,
+     * 0 meaning no deadline.
+     * @see Provider::SearchRequest::deadline
+     * @since 6.0
+     */
+    int requestDeadline() const;
+
+    /**
+     * Resolve the payload links of the given entry ahead of time, so installing it can start
+     * transferring data straight away. This is done automatically for the first few entries
+     * of a page of results which are updateable, and is useful to call when the details of an
+     * entry are shown.
+     *
+     * @see Provider::prefetchPayloadLink
+     * @since 6.0
+     */
+    void prefetchPayloadLinks(const KNSCore::Entry &entry);
+
+    /**
+     * A rough estimate of the memory held by the engine, in bytes, by subsystem.
+     * The cache is shared between engines using the same configuration, so its parts
+     * are counted for each of them. Entries held by several subsystems are counted
+     * for each of those, so the total is an upper bound.
+     * @see memoryUsage()
+     * @since 6.0
+     */
+    struct MemoryUsage {
+        qint64 registry = 0; ///< The installed entries
+        qint64 requestCache = 0; ///< Remembered result pages
+        qint64 previewImages = 0; ///< Decoded preview images of entries in the registry and result pages
+        qint64 entryDetails = 0; ///< Remembered entry details
+        qint64 providers = 0; ///< Whatever the providers keep around, see Provider::memoryUsage()
+        qint64 total() const
+        {
+            return registry + requestCache + previewImages + entryDetails + providers;
+        }
+    };
+
+    /**
+     * How much to shed in trimMemory(). Every level includes the ones before it, which
+     * are cheaper to get back.
+     * @since 6.0
+     */
+    enum MemoryTrimLevel {
+        TrimPreviewImages = 0, ///< Decoded preview images, which are loaded again (usually from the disk cache) when shown
+        TrimEntryDetails, ///< Remembered entry details
+        TrimProviderCaches, ///< Whatever providers keep around to save round-trips, see Provider::trimMemory()
+        TrimRequestCache, ///< Remembered result pages, so searching asks the providers again
+    };
+    Q_ENUM(MemoryTrimLevel)
+
+    /**
+     * @return A rough estimate of the memory held by the engine
+     * @since 6.0
+     */
+    MemoryUsage memoryUsage() const;
+
+    /**
+     * Drop cached data to free up memory, cheapest to get back first.
+     * memoryTrimmed() is emitted afterwards, so frontends can drop what they hold on to as well.
+     * @param level How far to go
+     * @since 6.0
+     */
+    void trimMemory(KNSCore::EngineBase::MemoryTrimLevel level = TrimRequestCache);
+
+    /**
+     * Trim memory automatically when the system runs low on it. On Linux, this uses the
+     * pressure stall information of the kernel: moderate pressure trims everything short of
+     * the remembered result pages, and pressure which persists trims those as well.
+     * Elsewhere, this does nothing. Off by default.
+     * @since 6.0
+     */
+    void setTrimOnMemoryPressure(bool enabled);
+    bool trimOnMemoryPressure() const;
+
+    /**
+     * Whether the network is unavailable. While offline, the engine does not wait for providers
+     * which cannot be reached: signalProvidersLoaded() is emitted as soon as the providers are
+     * known, and everything is served from what is cached locally (the registry, remembered
+     * result pages and the network cache), so it may be out of date. Once the network is back,
+     * providers which did not make it are loaded again, and signalProvidersLoaded() is emitted
+     * once more so that frontends refresh what they show.
+     * @since 6.0
+     */
+    bool isOffline() const;
+
+    /**
+     * Fired when the network goes away or comes back
+     * @since 6.0
+     */
+    Q_SIGNAL void offlineChanged();
+
 Q_SIGNALS:
     /**
      * Indicates a message to be added to the ui's log, or sent to a messagebox
@@ -371,6 +473,23 @@ Q_SIGNALS:
 
     void loadingProvider();
 
+    /**
+     * Fired after trimMemory() dropped cached data
+     * @param level How far the trimming went
+     * @since 6.0
+     */
+    void memoryTrimmed(KNSCore::EngineBase::MemoryTrimLevel level);
+
+    /**
+     * Fired after a change to the tag filters has been applied to the results loaded so far.
+     * The result pages remembered by the cache now follow the new filters, so frontends
+     * should show them again.
+     * @see setTagFilter(QStringList)
+     * @see setDownloadTagFilter(QStringList)
+     * @since 6.0
+     */
+    void resultsRefiltered();
+
 private:
     // the .knsrc file was loaded
     void slotProviderFileLoaded(const QDomDocument &doc);
@@ -381,6 +500,10 @@ private:
 
     // loading the .knsrc file failed
     void slotProvidersFailed();
+    // the network went away or came back
+    void onlineChanged(bool online);
+    // apply changed tag filters to the results loaded so far
+    void refilterResults();
 
     /**
      * load providers from the providersurl in the knsrc file
@@ -395,9 +518,35 @@ protected:
     virtual void addProvider(QSharedPointer<KNSCore::Provider> provider);
     virtual void updateStatus();
 
+    /**
+     * Whether payload links get resolved ahead of time (see prefetchPayloadLinks()), which is
+     * the case by default. Engines nobody is looking at should turn this off, as nobody is
+     * going to press install on anything they turn up.
+     * @since 6.0
+     */
+    void setPrefetchPayloadLinks(bool prefetch);
+
+    /**
+     * The entries a provider is told about once it is initialized, which it checks for updates
+     * and marks as installed. By default this is everything installed from it according to the
+     * registry of this engine's configuration.
+     * @since 6.0
+     */
+    virtual Entry::List cachedEntriesForProvider(const QString &providerId) const;
+
     friend class ResultsStream;
     friend class Transaction;
     Installation *installation() const; // Needed for quick engine
+    /**
+     * The details most recently loaded for the given entry. If there are none, they were loaded
+     * too long ago, or they are for a different version of the entry, an invalid entry is returned.
+     */
+    Entry cachedEntryDetails(const Entry &entry) const; // Needed for quick engine
+    /**
+     * The entries the cache knows of which match the search term of the request, narrowed down to the
+     * categories of the request and the tag filters of their providers, the way the providers would
+     */
+    Entry::List searchLocally(const Provider::SearchRequest &request) const; // Needed for quick engine
     QList<QSharedPointer<Provider>> providers() const;
     std::unique_ptr<EngineBasePrivate> d;
 };
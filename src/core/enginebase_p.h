@@ -13,6 +13,10 @@
 #include "installation_p.h"
 #include <Attica/ProviderManager>
 
+#include <QElapsedTimer>
+
+class QSocketNotifier;
+
 class KNSCore::EngineBasePrivate
 {
 public:
@@ -24,6 +28,9 @@ public:
     QUrl providerFileUrl;
     QStringList tagFilter;
     QStringList downloadTagFilter;
+    int requestDeadline = 30000;
+    // See setPrefetchPayloadLinks()
+    bool prefetchPayloadLinks = true;
     Installation *installation = new Installation();
     Attica::ProviderManager *atticaProviderManager = nullptr;
     QList<Provider::SearchPreset> searchPresets;
@@ -31,6 +38,31 @@ public:
     bool shouldRemoveDeletedEntries = false;
     QList<Provider::CategoryMetadata> categoriesMetadata;
     QHash<QString, QSharedPointer<KNSCore::Provider>> providers;
+    // Whether signalProvidersLoaded() went out for the current set of providers
+    bool providersLoaded = false;
+
+    // Entry details as last loaded, by provider and entry id, along with when they were loaded. They are trusted
+    // for detailsLifetime seconds, and we hold on to no more than maxEntryDetails of them.
+    QHash<EntryKey, QPair<Entry, QDateTime>> entryDetails;
+    static constexpr int detailsLifetime = 30 * 60;
+    static constexpr int maxEntryDetails = 256;
+
+    // The requests our providers answered, which are the pages of the (shared) cache we are responsible for
+    QHash<QString, Provider::SearchRequest> loadedRequests;
+
+    // Forget the pages of the cache we loaded, leaving those other engines for the same configuration loaded alone
+    void removeLoadedRequests()
+    {
+        for (const Provider::SearchRequest &request : std::as_const(loadedRequests)) {
+            cache->removeRequest(request);
+        }
+        loadedRequests.clear();
+    }
+
+    // Linux pressure stall information, see setTrimOnMemoryPressure()
+    int memoryPressureFd = -1;
+    QSocketNotifier *memoryPressureNotifier = nullptr;
+    QElapsedTimer lastMemoryPressure;
 };
 
 #endif
@@ -0,0 +1,176 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include "enginewarmup_p.h"
+
+#include "cache.h"
+#include "enginebase.h"
+#include "jobs/connectivity.h"
+#include "knewstuffcore_debug.h"
+
+#include <QPointer>
+#include <QTimer>
+
+using namespace KNSCore;
+
+// How long warming up may take in all, after which whatever is still going on is left to the real engine
+static const int WARM_UP_BUDGET{10000};
+// How long to wait before trying again when some other warm-up is running
+static const int WARM_UP_RETRY{2000};
+// Only one at a time, as there may be quite a few buttons around and the application has better things to do
+static int s_runningWarmUps = 0;
+
+namespace
+{
+// Gives access to the providers, which is all the warm-up needs beyond a plain engine
+class WarmUpEngine : public EngineBase
+{
+public:
+    explicit WarmUpEngine(QObject *parent = nullptr)
+        : EngineBase(parent)
+    {
+        // Nobody is going to install anything from here
+        setPrefetchPayloadLinks(false);
+    }
+    using EngineBase::providers;
+};
+}
+
+class KNSCore::EngineWarmUpPrivate
+{
+public:
+    QString configFile;
+    QPointer<WarmUpEngine> engine;
+    // Keeps what was warmed up around for the engine which will need it
+    QSharedPointer<Cache> cache;
+    QTimer scheduleTimer;
+    QTimer budgetTimer;
+    bool loading = false;
+    bool done = false;
+    int pendingProviders = 0;
+};
+
+EngineWarmUp::EngineWarmUp(const QString &configFile, QObject *parent)
+    : QObject(parent)
+    , d(new EngineWarmUpPrivate)
+{
+    d->configFile = configFile;
+    d->scheduleTimer.setSingleShot(true);
+    connect(&d->scheduleTimer, &QTimer::timeout, this, &EngineWarmUp::start);
+    d->budgetTimer.setSingleShot(true);
+    d->budgetTimer.setInterval(WARM_UP_BUDGET);
+    connect(&d->budgetTimer, &QTimer::timeout, this, [this]() {
+        qCDebug(KNEWSTUFFCORE) << "Warming up" << d->configFile << "is taking too long, giving up";
+        finish();
+    });
+}
+
+EngineWarmUp::~EngineWarmUp()
+{
+    if (d->engine) {
+        --s_runningWarmUps;
+    }
+}
+
+void EngineWarmUp::schedule(int delay)
+{
+    if (!d->done && !d->engine) {
+        d->scheduleTimer.start(delay);
+    }
+}
+
+void EngineWarmUp::start()
+{
+    d->scheduleTimer.stop();
+    if (d->done || d->engine || d->configFile.isEmpty()) {
+        return;
+    }
+    if (s_runningWarmUps > 0) {
+        d->scheduleTimer.start(WARM_UP_RETRY);
+        return;
+    }
+    if (!Connectivity::instance()->isOnline()) {
+        // There would be nothing to warm up but the registry, which is quick enough to read anyway
+        return;
+    }
+
+    qCDebug(KNEWSTUFFCORE) << "Warming up" << d->configFile;
+    ++s_runningWarmUps;
+    d->budgetTimer.start();
+    d->engine = new WarmUpEngine(this);
+    connect(d->engine, &EngineBase::signalProvidersLoaded, this, &EngineWarmUp::loadFirstPage);
+    connect(d->engine, &EngineBase::signalErrorCode, this, [this](const KNSCore::ErrorCode &error) {
+        if (error == KNSCore::ProviderError || error == KNSCore::ConfigFileError) {
+            finish();
+        }
+    });
+    if (!d->engine->init(d->configFile)) {
+        finish();
+    }
+}
+
+void EngineWarmUp::loadFirstPage()
+{
+    if (!d->engine || d->loading) {
+        return;
+    }
+    d->loading = true;
+    d->cache = d->engine->cache();
+
+    // What a freshly opened dialog asks for
+    Provider::SearchRequest request(Provider::Newest, Provider::None, QString(), d->engine->categories(), 0);
+    request.deadline = d->engine->requestDeadline();
+    if (!d->cache->requestFromCache(request).isEmpty()) {
+        finish();
+        return;
+    }
+    const auto providers = d->engine->providers();
+    for (const QSharedPointer<Provider> &provider : providers) {
+        if (!provider->isInitialized()) {
+            continue;
+        }
+        ++d->pendingProviders;
+        connect(provider.data(), &Provider::loadingFinished, this, [this, request](const KNSCore::Provider::SearchRequest &loaded, const KNSCore::Entry::List &entries) {
+            if (loaded == request) {
+                d->cache->insertRequest(request, entries);
+                if (--d->pendingProviders == 0) {
+                    finish();
+                }
+            }
+        });
+        connect(provider.data(), &Provider::loadingFailed, this, [this, request](const KNSCore::Provider::SearchRequest &failed) {
+            if (failed == request && --d->pendingProviders == 0) {
+                finish();
+            }
+        });
+        provider->loadEntries(request);
+    }
+    if (d->pendingProviders == 0) {
+        finish();
+    }
+}
+
+void EngineWarmUp::finish()
+{
+    if (d->done) {
+        return;
+    }
+    d->done = true;
+    d->budgetTimer.stop();
+    if (d->engine) {
+        qCDebug(KNEWSTUFFCORE) << "Warmed up" << d->configFile;
+        if (!d->cache) {
+            d->cache = d->engine->cache();
+        }
+        --s_runningWarmUps;
+        // Not straight away, as we may well be in the middle of one of its signals
+        d->engine->deleteLater();
+        d->engine = nullptr;
+    }
+    Q_EMIT finished();
+}
+
+#include "moc_enginewarmup_p.cpp"
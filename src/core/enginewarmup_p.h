@@ -0,0 +1,62 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KNEWSTUFF3_ENGINEWARMUP_P_H
+#define KNEWSTUFF3_ENGINEWARMUP_P_H
+
+#include <QObject>
+
+#include "knewstuffcore_export.h"
+
+#include <memory>
+
+namespace KNSCore
+{
+class EngineWarmUpPrivate;
+
+/**
+ * Does the work an engine does before it can show anything, ahead of time: reading the
+ * configuration and registry, loading the providers and the first page of what a dialog
+ * shows when opened. The results end up in the Cache shared by all engines using the
+ * configuration, which is kept alive for as long as this object is around, so an engine
+ * created later on can show them straight away.
+ *
+ * Warming up is speculative, so it is kept cheap: only one runs at a time, nothing happens
+ * while offline or once the first page is cached already, and whatever is not done within
+ * a few seconds is given up on.
+ *
+ * @internal
+ */
+class KNEWSTUFFCORE_EXPORT EngineWarmUp : public QObject
+{
+    Q_OBJECT
+public:
+    explicit EngineWarmUp(const QString &configFile, QObject *parent = nullptr);
+    ~EngineWarmUp() override;
+
+    /**
+     * Warm up once the given time has passed, unless that happened already
+     * @param delay The delay in milliseconds
+     */
+    void schedule(int delay);
+
+    /**
+     * Warm up now, unless that happened already
+     */
+    void start();
+
+    Q_SIGNAL void finished();
+
+private:
+    void loadFirstPage();
+    void finish();
+
+    const std::unique_ptr<EngineWarmUpPrivate> d;
+};
+
+}
+
+#endif
@@ -15,23 +15,50 @@
 #include <QXmlStreamReader>
 #include <knewstuffcore_debug.h>
 
+#include <tuple>
+
 #include "xmlloader_p.h"
 
 using namespace KNSCore;
 
+EntryKey KNSCore::entryKey(const QString &providerId, const QString &uniqueId)
+{
+    // 64 bit FNV-1a, which is cheap and spreads short, similar strings well enough
+    constexpr quint64 offsetBasis = 14695981039346656037ULL;
+    constexpr quint64 prime = 1099511628211ULL;
+    quint64 hash = offsetBasis;
+    const auto addString = [&hash](const QString &string) {
+        for (const QChar character : string) {
+            hash = (hash ^ character.unicode()) * prime;
+        }
+    };
+    addString(providerId);
+    // Keep the separation, so that e.g. ("ab", "c") and ("a", "bc") end up with different keys
+    hash = (hash ^ 0xffff) * prime;
+    addString(uniqueId);
+    return hash;
+}
+
 class KNSCore::EntryPrivate : public QSharedData
 {
 public:
     EntryPrivate()
     {
         qRegisterMetaType<KNSCore::Entry::List>();
+        updateKey();
     }
 
     bool operator==(const EntryPrivate &other) const
     {
-        return mUniqueId == other.mUniqueId && mProviderId == other.mProviderId;
+        return mKey == other.mKey && mUniqueId == other.mUniqueId && mProviderId == other.mProviderId;
     }
 
+    void updateKey()
+    {
+        mKey = entryKey(mProviderId, mUniqueId);
+    }
+
+    EntryKey mKey = 0;
     QString mUniqueId;
     QString mName;
     QUrl mHomepage;
@@ -55,6 +82,8 @@ public:
     QString mShortSummary;
     QString mChangelog;
     QString mPayload;
+    // The download link the payload was installed from, 0 if not known
+    int mInstalledLinkId = 0;
     QStringList mInstalledFiles;
     QString mProviderId;
     QStringList mUnInstalledFiles;
@@ -91,12 +120,13 @@ Entry &Entry::operator=(const Entry &other)
 
 bool Entry::operator<(const KNSCore::Entry &other) const
 {
-    return d->mUniqueId < other.d->mUniqueId;
+    // By id as it always was, the provider only telling apart entries with the same id, consistent with operator==
+    return std::tie(d->mUniqueId, d->mProviderId) < std::tie(other.d->mUniqueId, other.d->mProviderId);
 }
 
 bool Entry::operator==(const KNSCore::Entry &other) const
 {
-    return d->mUniqueId == other.d->mUniqueId && d->mProviderId == other.d->mProviderId;
+    return d == other.d || *d == *other.d;
 }
 
 Entry::~Entry() = default;
@@ -106,6 +136,11 @@ bool Entry::isValid() const
     return !d->mUniqueId.isEmpty();
 }
 
+EntryKey Entry::key() const
+{
+    return d->mKey;
+}
+
 QString Entry::name() const
 {
     return d->mName;
@@ -124,6 +159,7 @@ QString Entry::uniqueId() const
 void Entry::setUniqueId(const QString &id)
 {
     d->mUniqueId = id;
+    d->updateKey();
 }
 
 QString Entry::providerId() const
@@ -134,6 +170,7 @@ QString Entry::providerId() const
 void Entry::setProviderId(const QString &id)
 {
     d->mProviderId = id;
+    d->updateKey();
 }
 
 QStringList KNSCore::Entry::tags() const
@@ -246,6 +283,16 @@ void Entry::setPayload(const QString &url)
     d->mPayload = url;
 }
 
+int Entry::installedLinkId() const
+{
+    return d->mInstalledLinkId;
+}
+
+void Entry::setInstalledLinkId(int linkId)
+{
+    d->mInstalledLinkId = linkId;
+}
+
 QDate Entry::updateReleaseDate() const
 {
     return d->mUpdateReleaseDate;
@@ -286,6 +333,57 @@ void Entry::setPreviewImage(const QImage &image, PreviewType type)
     d->mPreviewImage[type] = image;
 }
 
+static qint64 stringListMemoryUsage(const QStringList &list)
+{
+    qint64 size = list.capacity() * sizeof(QString);
+    for (const QString &string : list) {
+        size += string.capacity() * sizeof(QChar);
+    }
+    return size;
+}
+
+qint64 Entry::memoryUsage() const
+{
+    qint64 size = sizeof(EntryPrivate);
+    for (const QString *string : {&d->mUniqueId,
+                                  &d->mName,
+                                  &d->mCategory,
+                                  &d->mLicense,
+                                  &d->mVersion,
+                                  &d->mUpdateVersion,
+                                  &d->mKnowledgebaseLink,
+                                  &d->mSummary,
+                                  &d->mShortSummary,
+                                  &d->mChangelog,
+                                  &d->mPayload,
+                                  &d->mProviderId,
+                                  &d->mDonationLink,
+                                  &d->mChecksum,
+                                  &d->mSignature}) {
+        size += string->capacity() * sizeof(QChar);
+    }
+    for (const QString &previewUrl : d->mPreviewUrl) {
+        size += previewUrl.capacity() * sizeof(QChar);
+    }
+    size += d->mHomepage.toString().size() * sizeof(QChar);
+    for (const QString &string : {d->mAuthor.id(),
+                                  d->mAuthor.name(),
+                                  d->mAuthor.email(),
+                                  d->mAuthor.jabber(),
+                                  d->mAuthor.homepage(),
+                                  d->mAuthor.profilepage(),
+                                  d->mAuthor.description()}) {
+        size += string.size() * sizeof(QChar);
+    }
+    size += stringListMemoryUsage(d->mInstalledFiles) + stringListMemoryUsage(d->mUnInstalledFiles) + stringListMemoryUsage(d->mTags);
+    size += d->mDownloadLinkInformationList.capacity() * sizeof(DownloadLinkInformation);
+    for (const DownloadLinkInformation &link : std::as_const(d->mDownloadLinkInformationList)) {
+        size += (link.name.size() + link.priceAmount.size() + link.distributionType.size() + link.descriptionLink.size()) * sizeof(QChar);
+        size += stringListMemoryUsage(link.tags);
+    }
+    return size;
+}
+
 int Entry::rating() const
 {
     return d->mRating;
@@ -419,6 +517,19 @@ void Entry::clearDownloadLinkInformation()
     d->mDownloadLinkInformationList.clear();
 }
 
+// The elements holding the previews, in the order of Entry::PreviewType
+static const char *const previewElementNames[] = {"preview", "preview2", "preview3", "previewBig", "previewBig2", "previewBig3"};
+
+static int previewTypeForElement(QStringView name)
+{
+    for (int type = Entry::PreviewSmall1; type <= Entry::PreviewBig3; ++type) {
+        if (name == QLatin1String(previewElementNames[type])) {
+            return type;
+        }
+    }
+    return -1;
+}
+
 static QXmlStreamReader::TokenType readNextSkipComments(QXmlStreamReader *xml)
 {
     do {
@@ -504,13 +615,23 @@ bool KNSCore::Entry::setEntryXML(QXmlStreamReader &reader)
             d->mVersion = readStringTrimmed(&reader);
         } else if (reader.name() == QLatin1String("releasedate")) {
             d->mReleaseDate = QDate::fromString(readStringTrimmed(&reader), Qt::ISODate);
-        } else if (reader.name() == QLatin1String("preview")) {
-            // TODO support for all 6 image links
-            d->mPreviewUrl[PreviewSmall1] = readStringTrimmed(&reader);
-        } else if (reader.name() == QLatin1String("previewBig")) {
-            d->mPreviewUrl[PreviewBig1] = readStringTrimmed(&reader);
+        } else if (const int previewType = previewTypeForElement(reader.name()); previewType >= 0) {
+            d->mPreviewUrl[previewType] = readStringTrimmed(&reader);
         } else if (reader.name() == QLatin1String("payload")) {
+            d->mInstalledLinkId = reader.attributes().value(QLatin1String("linkid")).toInt();
             d->mPayload = readStringTrimmed(&reader);
+        } else if (reader.name() == QLatin1String("downloadlink")) {
+            const QXmlStreamAttributes attributes = reader.attributes();
+            DownloadLinkInformation link;
+            link.id = attributes.value(QLatin1String("id")).toInt();
+            link.name = attributes.value(QLatin1String("name")).toString();
+            link.size = attributes.value(QLatin1String("size")).toULongLong();
+            link.distributionType = attributes.value(QLatin1String("distributiontype")).toString();
+            link.isDownloadtypeLink = attributes.value(QLatin1String("type")) == QLatin1String("link");
+            const QString tags = attributes.value(QLatin1String("tags")).toString();
+            link.tags = tags.isEmpty() ? QStringList() : tags.split(QLatin1Char(','));
+            link.descriptionLink = readStringTrimmed(&reader);
+            d->mDownloadLinkInformationList.append(link);
         } else if (reader.name() == QLatin1String("rating")) {
             d->mRating = readInt(&reader);
         } else if (reader.name() == QLatin1String("downloads")) {
@@ -544,6 +665,8 @@ bool KNSCore::Entry::setEntryXML(QXmlStreamReader &reader)
                    QStringLiteral("token name was %1 and the type was %2").arg(reader.name().toString(), reader.tokenString()).toLocal8Bit().data());
     }
 
+    d->updateKey();
+
     // Validation
     if (d->mName.isEmpty()) {
         qWarning() << "Entry: no name given";
@@ -556,6 +679,7 @@ bool KNSCore::Entry::setEntryXML(QXmlStreamReader &reader)
         } else {
             d->mUniqueId = d->mName;
         }
+        d->updateKey();
     }
 
     if (d->mPayload.isEmpty()) {
@@ -602,13 +726,22 @@ bool KNSCore::Entry::setEntryXML(const QDomElement &xmldata)
             d->mVersion = e.text().trimmed();
         } else if (e.tagName() == QLatin1String("releasedate")) {
             d->mReleaseDate = QDate::fromString(e.text().trimmed(), Qt::ISODate);
-        } else if (e.tagName() == QLatin1String("preview")) {
-            // TODO support for all 6 image links
-            d->mPreviewUrl[PreviewSmall1] = e.text().trimmed();
-        } else if (e.tagName() == QLatin1String("previewBig")) {
-            d->mPreviewUrl[PreviewBig1] = e.text().trimmed();
+        } else if (const int previewType = previewTypeForElement(e.tagName()); previewType >= 0) {
+            d->mPreviewUrl[previewType] = e.text().trimmed();
         } else if (e.tagName() == QLatin1String("payload")) {
+            d->mInstalledLinkId = e.attribute(QStringLiteral("linkid")).toInt();
             d->mPayload = e.text().trimmed();
+        } else if (e.tagName() == QLatin1String("downloadlink")) {
+            DownloadLinkInformation link;
+            link.id = e.attribute(QStringLiteral("id")).toInt();
+            link.name = e.attribute(QStringLiteral("name"));
+            link.size = e.attribute(QStringLiteral("size")).toULongLong();
+            link.distributionType = e.attribute(QStringLiteral("distributiontype"));
+            link.isDownloadtypeLink = e.attribute(QStringLiteral("type")) == QLatin1String("link");
+            const QString tags = e.attribute(QStringLiteral("tags"));
+            link.tags = tags.isEmpty() ? QStringList() : tags.split(QLatin1Char(','));
+            link.descriptionLink = e.text().trimmed();
+            d->mDownloadLinkInformationList.append(link);
         } else if (e.tagName() == QLatin1String("rating")) {
             d->mRating = e.text().toInt();
         } else if (e.tagName() == QLatin1String("downloads")) {
@@ -638,6 +771,8 @@ bool KNSCore::Entry::setEntryXML(const QDomElement &xmldata)
         }
     }
 
+    d->updateKey();
+
     // Validation
     if (d->mName.isEmpty()) {
         qWarning() << "Entry: no name given";
@@ -650,6 +785,7 @@ bool KNSCore::Entry::setEntryXML(const QDomElement &xmldata)
         } else {
             d->mUniqueId = d->mName;
         }
+        d->updateKey();
     }
 
     if (d->mPayload.isEmpty()) {
@@ -716,7 +852,35 @@ QDomElement KNSCore::Entry::entryXML() const
     e = addElement(doc, el, QStringLiteral("changelog"), d->mChangelog);
     e = addElement(doc, el, QStringLiteral("preview"), d->mPreviewUrl[PreviewSmall1]);
     e = addElement(doc, el, QStringLiteral("previewBig"), d->mPreviewUrl[PreviewBig1]);
+    // The second and third previews are rare enough to only be written when there are any
+    for (int type = PreviewSmall2; type <= PreviewBig3; ++type) {
+        if (type != PreviewBig1 && !d->mPreviewUrl[type].isEmpty()) {
+            (void)addElement(doc, el, QLatin1String(previewElementNames[type]), d->mPreviewUrl[type]);
+        }
+    }
     e = addElement(doc, el, QStringLiteral("payload"), d->mPayload);
+    if (d->mInstalledLinkId > 0) {
+        e.setAttribute(QStringLiteral("linkid"), d->mInstalledLinkId);
+    }
+    for (const DownloadLinkInformation &link : std::as_const(d->mDownloadLinkInformationList)) {
+        e = addElement(doc, el, QStringLiteral("downloadlink"), link.descriptionLink);
+        e.setAttribute(QStringLiteral("id"), link.id);
+        if (!link.name.isEmpty()) {
+            e.setAttribute(QStringLiteral("name"), link.name);
+        }
+        if (link.size > 0) {
+            e.setAttribute(QStringLiteral("size"), link.size);
+        }
+        if (!link.distributionType.isEmpty()) {
+            e.setAttribute(QStringLiteral("distributiontype"), link.distributionType);
+        }
+        if (link.isDownloadtypeLink) {
+            e.setAttribute(QStringLiteral("type"), QStringLiteral("link"));
+        }
+        if (!link.tags.isEmpty()) {
+            e.setAttribute(QStringLiteral("tags"), link.tags.join(QLatin1Char(',')));
+        }
+    }
     e = addElement(doc, el, QStringLiteral("tags"), d->mTags.join(QLatin1Char(',')));
 
     if (d->mStatus == KNSCore::Entry::Installed) {
@@ -36,6 +36,20 @@ class EntryPrivate;
  */
 KNEWSTUFFCORE_EXPORT QString replaceBBCode(const QString &unformattedText);
 
+/**
+ * A compact identifier for an entry, derived from the ID of its provider and its unique ID.
+ * Use this to look up entries in containers, rather than hashing and comparing strings.
+ * @see Entry::key()
+ * @since 6.0
+ */
+typedef quint64 EntryKey;
+
+/**
+ * The key for the entry with the given unique ID on the given provider
+ * @since 6.0
+ */
+KNEWSTUFFCORE_EXPORT EntryKey entryKey(const QString &providerId, const QString &uniqueId);
+
 /**
  * @short KNewStuff data entry container.
  *
@@ -139,6 +153,14 @@ public:
 
     bool isValid() const;
 
+    /**
+     * The key identifying this entry, which is kept up to date as the provider ID
+     * and unique ID of the entry change.
+     * @see KNSCore::entryKey()
+     * @since 6.0
+     */
+    EntryKey key() const;
+
     /**
      * Sets the name for this data object.
      */
@@ -310,6 +332,20 @@ public:
      */
     QString payload() const;
 
+    /**
+     * Sets the id of the download link the payload was installed from
+     * @see DownloadLinkInformation::id
+     * @since 6.0
+     */
+    void setInstalledLinkId(int linkId);
+
+    /**
+     * The id of the download link the payload was installed from, or 0 if that is not
+     * known (such as for entries installed by earlier versions of KNewStuff)
+     * @since 6.0
+     */
+    int installedLinkId() const;
+
     /**
      * Sets the object's preview file, if available. This should be a
      * picture file.
@@ -329,6 +365,13 @@ public:
     QImage previewImage(PreviewType type = PreviewSmall1) const;
     void setPreviewImage(const QImage &image, PreviewType type = PreviewSmall1);
 
+    /**
+     * A rough estimate of the memory held by the entry, in bytes, not counting
+     * the decoded preview images (see previewImage()).
+     * @since 6.0
+     */
+    qint64 memoryUsage() const;
+
     /**
      * Set the files that have been installed by the install command.
      * @param files local file names
@@ -544,9 +587,9 @@ private:
     QExplicitlySharedDataPointer<EntryPrivate> d;
 };
 
-inline uint qHash(const KNSCore::Entry &entry)
+inline size_t qHash(const KNSCore::Entry &entry, size_t seed = 0)
 {
-    return qHash(entry.uniqueId());
+    return qHash(entry.key(), seed);
 }
 
 KNEWSTUFFCORE_EXPORT QDebug operator<<(QDebug debug, const KNSCore::Entry &entry);
@@ -0,0 +1,252 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include "facetsmodel.h"
+
+#include "cache.h"
+#include "enginebase.h"
+
+#include <QMetaEnum>
+#include <QPointer>
+
+namespace KNSCore
+{
+typedef QPair<int, QString> FacetId;
+
+class FacetsModelPrivate
+{
+public:
+    FacetsModelPrivate(FacetsModel *qq)
+        : q(qq)
+    {
+    }
+    FacetsModel *const q;
+    QPointer<EngineBase> engine;
+    QPointer<Cache> cache;
+    QSet<QString> connectedProviders;
+    QList<QMetaObject::Connection> connections;
+
+    struct Facet {
+        FacetsModel::FacetKind kind;
+        QString value;
+        int count;
+    };
+    QList<Facet> facets;
+    QHash<FacetId, int> rows;
+    // What each entry is counted under, so that can be taken back when the entry changes
+    QHash<EntryKey, QList<FacetId>> contributions;
+
+    static QList<FacetId> facetsOf(const Entry &entry)
+    {
+        QList<FacetId> facets;
+        if (entry.status() == Entry::Invalid || entry.status() == Entry::Deleted) {
+            return facets;
+        }
+        static const QMetaEnum statusEnum = QMetaEnum::fromType<Entry::Status>();
+        facets << FacetId(FacetsModel::StatusFacet, QString::fromLatin1(statusEnum.valueToKey(entry.status())));
+        if (!entry.category().isEmpty()) {
+            facets << FacetId(FacetsModel::CategoryFacet, entry.category());
+        }
+        if (!entry.license().isEmpty()) {
+            facets << FacetId(FacetsModel::LicenseFacet, entry.license());
+        }
+        const QStringList tags = entry.tags();
+        for (const QString &tag : tags) {
+            facets << FacetId(FacetsModel::TagFacet, tag);
+        }
+        return facets;
+    }
+
+    void changeCount(const FacetId &facet, int delta)
+    {
+        const auto row = rows.constFind(facet);
+        if (row == rows.constEnd()) {
+            if (delta > 0) {
+                q->beginInsertRows(QModelIndex(), facets.count(), facets.count());
+                rows.insert(facet, facets.count());
+                facets << Facet{FacetsModel::FacetKind(facet.first), facet.second, delta};
+                q->endInsertRows();
+            }
+            return;
+        }
+        const int i = *row;
+        facets[i].count += delta;
+        if (facets[i].count > 0) {
+            const QModelIndex index = q->index(i);
+            Q_EMIT q->dataChanged(index, index, {FacetsModel::CountRole, Qt::DisplayRole});
+            return;
+        }
+        q->beginRemoveRows(QModelIndex(), i, i);
+        facets.removeAt(i);
+        rows.remove(facet);
+        for (auto it = rows.begin(); it != rows.end(); ++it) {
+            if (it.value() > i) {
+                --it.value();
+            }
+        }
+        q->endRemoveRows();
+    }
+
+    void countEntries(const Entry::List &entries)
+    {
+        for (const Entry &entry : entries) {
+            const QList<FacetId> now = facetsOf(entry);
+            const QList<FacetId> before = contributions.value(entry.key());
+            if (now == before) {
+                // By far the most common case, the same entry coming by again
+                continue;
+            }
+            for (const FacetId &facet : before) {
+                if (!now.contains(facet)) {
+                    changeCount(facet, -1);
+                }
+            }
+            for (const FacetId &facet : now) {
+                if (!before.contains(facet)) {
+                    changeCount(facet, 1);
+                }
+            }
+            if (now.isEmpty()) {
+                contributions.remove(entry.key());
+            } else {
+                contributions.insert(entry.key(), now);
+            }
+        }
+    }
+
+    // Hook up whatever the engine has gained since we last looked
+    void attach()
+    {
+        if (!engine) {
+            return;
+        }
+        if (!cache && engine->cache()) {
+            cache = engine->cache().data();
+            connections << QObject::connect(cache, &Cache::entryRegistered, q, [this](const KNSCore::Entry &entry) {
+                countEntries({entry});
+            });
+            connections << QObject::connect(cache, &Cache::entryChanged, q, [this](const KNSCore::Entry &entry) {
+                countEntries({entry});
+            });
+            countEntries(cache->registry());
+        }
+        const QStringList providerIds = engine->providerIDs();
+        for (const QString &id : providerIds) {
+            const QSharedPointer<Provider> provider = engine->provider(id);
+            if (!provider || connectedProviders.contains(id)) {
+                continue;
+            }
+            connectedProviders.insert(id);
+            connections << QObject::connect(provider.data(),
+                                            &Provider::loadingFinished,
+                                            q,
+                                            [this](const KNSCore::Provider::SearchRequest &, const KNSCore::Entry::List &entries) {
+                                                countEntries(entries);
+                                            });
+            connections << QObject::connect(provider.data(), &Provider::entryDetailsLoaded, q, [this](const KNSCore::Entry &entry) {
+                countEntries({entry});
+            });
+        }
+    }
+
+    void detach()
+    {
+        for (const QMetaObject::Connection &connection : std::as_const(connections)) {
+            QObject::disconnect(connection);
+        }
+        connections.clear();
+        connectedProviders.clear();
+        cache = nullptr;
+        facets.clear();
+        rows.clear();
+        contributions.clear();
+    }
+};
+
+FacetsModel::FacetsModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , d(new FacetsModelPrivate(this))
+{
+}
+
+FacetsModel::~FacetsModel() = default;
+
+QHash<int, QByteArray> KNSCore::FacetsModel::roleNames() const
+{
+    static const QHash<int, QByteArray> roles{
+        {Qt::DisplayRole, "display"},
+        {KindRole, "kind"},
+        {ValueRole, "value"},
+        {CountRole, "count"},
+    };
+    return roles;
+}
+
+int KNSCore::FacetsModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return d->facets.count();
+}
+
+QVariant KNSCore::FacetsModel::data(const QModelIndex &index, int role) const
+{
+    if (checkIndex(index)) {
+        const FacetsModelPrivate::Facet &facet = d->facets.at(index.row());
+        switch (role) {
+        case Qt::DisplayRole:
+            return QStringLiteral("%1 (%2)").arg(facet.value).arg(facet.count);
+        case KindRole:
+            return facet.kind;
+        case ValueRole:
+            return facet.value;
+        case CountRole:
+            return facet.count;
+        }
+    }
+    return QVariant();
+}
+
+int KNSCore::FacetsModel::count(KNSCore::FacetsModel::FacetKind kind, const QString &value) const
+{
+    const auto row = d->rows.constFind(FacetId(kind, value));
+    return row == d->rows.constEnd() ? 0 : d->facets.at(*row).count;
+}
+
+QObject *KNSCore::FacetsModel::engine() const
+{
+    return d->engine;
+}
+
+void KNSCore::FacetsModel::setEngine(QObject *engine)
+{
+    if (d->engine != engine) {
+        beginResetModel();
+        if (d->engine) {
+            d->engine->disconnect(this);
+        }
+        d->detach();
+        d->engine = qobject_cast<EngineBase *>(engine);
+        if (d->engine) {
+            // The cache only exists once the engine is initialized, and providers come and go
+            connect(d->engine, &EngineBase::providersChanged, this, [this]() {
+                d->attach();
+            });
+            connect(d->engine, &EngineBase::signalProvidersLoaded, this, [this]() {
+                d->attach();
+            });
+        }
+        endResetModel();
+        // Rows are inserted as facets turn up, so this has to happen outside of the reset
+        d->attach();
+        Q_EMIT engineChanged();
+    }
+}
+
+}
+
+#include "moc_facetsmodel.cpp"
@@ -0,0 +1,74 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KNSCORE_FACETSMODEL_H
+#define KNSCORE_FACETSMODEL_H
+
+#include <QAbstractListModel>
+
+#include "knewstuffcore_export.h"
+
+#include <memory>
+
+namespace KNSCore
+{
+class FacetsModelPrivate;
+/**
+ * @brief A model which counts the entries known to an Engine by category, license, tag and status
+ *
+ * The counts cover every entry the engine has come across: those in the registry, and those
+ * returned by the providers for any search. They are kept up to date as results arrive and
+ * as entries change, so showing them (say, as "Updates (12)" or "Icons (340)") costs nothing.
+ *
+ * Facets are listed in the order they were first seen, and disappear once no entry has them.
+ *
+ * @since 6.0
+ */
+class KNEWSTUFFCORE_EXPORT FacetsModel : public QAbstractListModel
+{
+    Q_OBJECT
+    /**
+     * The Engine whose entries are counted
+     */
+    Q_PROPERTY(QObject *engine READ engine WRITE setEngine NOTIFY engineChanged)
+public:
+    explicit FacetsModel(QObject *parent = nullptr);
+    ~FacetsModel() override;
+
+    enum FacetKind {
+        CategoryFacet,
+        LicenseFacet,
+        TagFacet,
+        StatusFacet, ///< The value is the name of the Entry::Status, such as "Updateable"
+    };
+    Q_ENUM(FacetKind)
+
+    enum Roles {
+        KindRole = Qt::UserRole + 1,
+        ValueRole,
+        CountRole,
+    };
+    Q_ENUM(Roles)
+
+    QHash<int, QByteArray> roleNames() const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    /**
+     * How many of the known entries have the given facet
+     */
+    Q_INVOKABLE int count(KNSCore::FacetsModel::FacetKind kind, const QString &value) const;
+
+    QObject *engine() const;
+    void setEngine(QObject *engine);
+    Q_SIGNAL void engineChanged();
+
+private:
+    std::unique_ptr<FacetsModelPrivate> d;
+};
+}
+
+#endif // KNSCORE_FACETSMODEL_H
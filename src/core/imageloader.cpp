@@ -7,8 +7,38 @@
 
 #include "imageloader_p.h"
 
+#include <QCoreApplication>
+#include <QPointer>
+#include <QThreadPool>
+
 using namespace KNSCore;
 
+static bool isSmallPreview(Entry::PreviewType type)
+{
+    return type == Entry::PreviewSmall1 || type == Entry::PreviewSmall2 || type == Entry::PreviewSmall3;
+}
+
+// Decoding (and scaling) large images takes long enough to make the UI stutter, so it runs in the thread pool
+static QImage decodePreview(const QByteArray &data, Entry::PreviewType type)
+{
+    QImage image;
+    image.loadFromData(data);
+
+    if (isSmallPreview(type)) {
+        if (image.width() > PreviewWidth || image.height() > PreviewHeight) {
+            // if the preview is really big, first scale fast to a smaller size, then smooth to desired size
+            if (image.width() > 4 * PreviewWidth || image.height() > 4 * PreviewHeight) {
+                image = image.scaled(2 * PreviewWidth, 2 * PreviewHeight, Qt::KeepAspectRatio, Qt::FastTransformation);
+            }
+            image = image.scaled(PreviewWidth, PreviewHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        } else if (image.width() <= PreviewWidth / 2 && image.height() <= PreviewHeight / 2) {
+            // upscale tiny previews to double size
+            image = image.scaled(2 * image.width(), 2 * image.height());
+        }
+    }
+    return image;
+}
+
 ImageLoader::ImageLoader(const Entry &entry, Entry::PreviewType type, QObject *parent)
     : QObject(parent)
     , m_entry(entry)
@@ -16,11 +46,17 @@ ImageLoader::ImageLoader(const Entry &entry, Entry::PreviewType type, QObject *p
 {
 }
 
+void ImageLoader::setMirrors(const QList<QUrl> &mirrors)
+{
+    m_mirrors = mirrors;
+}
+
 void ImageLoader::start()
 {
     QUrl url(m_entry.previewUrl(m_previewType));
     if (!url.isEmpty()) {
         m_job = HTTPJob::get(url, NoReload, JobFlag::HideProgressInfo, this);
+        m_job->setMirrors(m_mirrors);
         connect(m_job, &KJob::result, this, &ImageLoader::slotDownload);
         connect(m_job, &HTTPJob::data, this, &ImageLoader::slotData);
     } else {
@@ -47,22 +83,22 @@ void ImageLoader::slotDownload(KJob *job)
         deleteLater();
         return;
     }
-    QImage image;
-    image.loadFromData(std::move(m_buffer));
-
-    if (m_previewType == Entry::PreviewSmall1 || m_previewType == Entry::PreviewSmall2 || m_previewType == Entry::PreviewSmall3) {
-        if (image.width() > PreviewWidth || image.height() > PreviewHeight) {
-            // if the preview is really big, first scale fast to a smaller size, then smooth to desired size
-            if (image.width() > 4 * PreviewWidth || image.height() > 4 * PreviewHeight) {
-                image = image.scaled(2 * PreviewWidth, 2 * PreviewHeight, Qt::KeepAspectRatio, Qt::FastTransformation);
-            }
-            image = image.scaled(PreviewWidth, PreviewHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        } else if (image.width() <= PreviewWidth / 2 && image.height() <= PreviewHeight / 2) {
-            // upscale tiny previews to double size
-            image = image.scaled(2 * image.width(), 2 * image.height());
-        }
-    }
+    QPointer<ImageLoader> self(this);
+    QThreadPool::globalInstance()->start([self, data = std::move(m_buffer), type = m_previewType]() {
+        const QImage image = decodePreview(data, type);
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [self, image]() {
+                if (self) {
+                    self->previewDecoded(image);
+                }
+            },
+            Qt::QueuedConnection);
+    });
+}
 
+void ImageLoader::previewDecoded(const QImage &image)
+{
     m_entry.setPreviewImage(image, m_previewType);
     Q_EMIT signalPreviewLoaded(m_entry, m_previewType);
     deleteLater();
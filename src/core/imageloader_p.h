@@ -35,6 +35,11 @@ class KNEWSTUFFCORE_EXPORT ImageLoader : public QObject
     Q_OBJECT
 public:
     explicit ImageLoader(const Entry &entry, Entry::PreviewType type, QObject *parent);
+    /**
+     * Other locations the preview can be loaded from, see Provider::mirrorsFor()
+     * This must be set before the loader is started.
+     */
+    void setMirrors(const QList<QUrl> &mirrors);
     void start();
     /**
      * Get the job doing the image loading in the background (to have progress information available)
@@ -51,9 +56,12 @@ private Q_SLOTS:
     void slotData(KJob *job, const QByteArray &buf);
 
 private:
+    void previewDecoded(const QImage &image);
+
     Entry m_entry;
     const Entry::PreviewType m_previewType;
     QByteArray m_buffer;
+    QList<QUrl> m_mirrors;
     HTTPJob *m_job = nullptr;
 };
 }
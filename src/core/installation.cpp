@@ -13,6 +13,7 @@
 #include <QFile>
 #include <QProcess>
 #include <QTemporaryFile>
+#include <QTimer>
 #include <QUrlQuery>
 
 #include "karchive.h"
@@ -30,7 +31,9 @@
 #include <knewstuffcore_debug.h>
 #include <qstandardpaths.h>
 
+#include "jobs/downloadjob.h"
 #include "jobs/filecopyjob.h"
+#include "payloadstore_p.h"
 #include "question.h"
 #ifdef Q_OS_WIN
 #include <shlobj.h>
@@ -39,6 +42,20 @@
 
 using namespace KNSCore;
 
+// Download links tend to change from one request to the next, so stored payloads are known by entry and file name
+static QString payloadSource(const Entry &entry)
+{
+    return entry.providerId() + QLatin1Char('/') + entry.uniqueId() + QLatin1Char('/') + QUrl(entry.payload()).fileName();
+}
+
+// The version being installed, which for updates is the new one
+static QString payloadVersion(const Entry &entry)
+{
+    const QString version = entry.updateVersion().isEmpty() ? entry.version() : entry.updateVersion();
+    const QDate releaseDate = entry.updateReleaseDate().isValid() ? entry.updateReleaseDate() : entry.releaseDate();
+    return version + QLatin1Char('/') + releaseDate.toString(Qt::ISODate);
+}
+
 Installation::Installation(QObject *parent)
     : QObject(parent)
 {
@@ -82,6 +99,9 @@ bool Installation::readConfig(const KConfigGroup &group, QString &errorMessage)
     installPath = group.readEntry("InstallPath");
     absoluteInstallPath = group.readEntry("AbsoluteInstallPath");
 
+    // KPackage keeps track of what it installed itself, so the payload store would never learn when those go away
+    deduplicatePayloads = group.readEntry("DeduplicatePayloads", false) && uncompressSetting != UseKPackageUncompression;
+
     if (standardResourceDirectory.isEmpty() && targetDirectory.isEmpty() && xdgTargetDirectory.isEmpty() && installPath.isEmpty()
         && absoluteInstallPath.isEmpty()) {
         qCCritical(KNEWSTUFFCORE) << "No installation target set";
@@ -90,12 +110,12 @@ bool Installation::readConfig(const KConfigGroup &group, QString &errorMessage)
     return true;
 }
 
-void Installation::install(const Entry &entry)
+void Installation::install(const Entry &entry, const QList<QUrl> &mirrors)
 {
-    downloadPayload(entry);
+    downloadPayload(entry, mirrors);
 }
 
-void Installation::downloadPayload(const KNSCore::Entry &entry)
+void Installation::downloadPayload(const KNSCore::Entry &entry, const QList<QUrl> &mirrors)
 {
     if (!entry.isValid()) {
         Q_EMIT signalInstallationFailed(i18n("Invalid item."), entry);
@@ -109,6 +129,23 @@ void Installation::downloadPayload(const KNSCore::Entry &entry)
         return;
     }
 
+    if (deduplicatePayloads) {
+        // Another configuration, or an earlier installation, may well have downloaded this already
+        const PayloadStore store;
+        const QString hash = store.find(payloadSource(entry), payloadVersion(entry));
+        const QString payloadFile = hash.isEmpty() ? QString() : store.checkout(hash, source.fileName());
+        if (!payloadFile.isEmpty()) {
+            qCDebug(KNEWSTUFFCORE) << "Installing" << entry.name() << "from the payload store";
+            storedPayloads.insert(payloadFile, hash);
+            // Not straight away, as callers expect to hear back once they have returned
+            QTimer::singleShot(0, this, [this, entry, payloadFile]() {
+                Q_EMIT signalPayloadLoaded(QUrl::fromLocalFile(payloadFile));
+                install(entry, payloadFile);
+            });
+            return;
+        }
+    }
+
     QString fileName(source.fileName());
     QTemporaryFile tempFile(QDir::tempPath() + QStringLiteral("/XXXXXX-") + fileName);
     tempFile.setAutoRemove(false);
@@ -122,7 +159,15 @@ void Installation::downloadPayload(const KNSCore::Entry &entry)
 #endif
 
     // FIXME: check for validity
-    FileCopyJob *job = FileCopyJob::file_copy(source, destination, -1, JobFlag::Overwrite | JobFlag::HideProgressInfo);
+    FileCopyJob *job = nullptr;
+    if (!mirrors.isEmpty() && !source.isLocalFile()) {
+        DownloadJob *downloadJob = new DownloadJob(source, destination, -1, JobFlag::Overwrite | JobFlag::HideProgressInfo);
+        downloadJob->setMirrors(mirrors);
+        downloadJob->start();
+        job = downloadJob;
+    } else {
+        job = FileCopyJob::file_copy(source, destination, -1, JobFlag::Overwrite | JobFlag::HideProgressInfo);
+    }
     connect(job, &KJob::result, this, &Installation::slotPayloadResult);
 
     entry_jobs[job] = entry;
@@ -154,8 +199,22 @@ void Installation::slotPayloadResult(KJob *job)
                 return;
             }
 
-            Q_EMIT signalPayloadLoaded(fcjob->destUrl());
-            install(entry, fcjob->destUrl().toLocalFile());
+            QString payloadFile = fcjob->destUrl().toLocalFile();
+            if (deduplicatePayloads) {
+                PayloadStore store;
+                const QString hash = store.add(payloadFile, payloadSource(entry), payloadVersion(entry));
+                if (!hash.isEmpty()) {
+                    // The downloaded file is in the store now, so install a copy of it (which usually shares its data)
+                    payloadFile = store.checkout(hash, QUrl(entry.payload()).fileName());
+                    if (payloadFile.isEmpty()) {
+                        Q_EMIT signalInstallationFailed(i18n("Could not install \"%1\": the downloaded file could not be read back.", entry.name()), entry);
+                        return;
+                    }
+                    storedPayloads.insert(payloadFile, hash);
+                }
+            }
+            Q_EMIT signalPayloadLoaded(QUrl::fromLocalFile(payloadFile));
+            install(entry, payloadFile);
         }
     }
 }
@@ -174,6 +233,7 @@ void KNSCore::Installation::install(KNSCore::Entry entry, const QString &downloa
 
     QString targetPath = targetInstallationPath();
     QStringList installedFiles = installDownloadedFileAndUncompress(entry, downloadedFile, targetPath);
+    const QString storedPayload = storedPayloads.take(downloadedFile);
 
     if (uncompressionSetting() != UseKPackageUncompression) {
         if (installedFiles.isEmpty()) {
@@ -187,6 +247,20 @@ void KNSCore::Installation::install(KNSCore::Entry entry, const QString &downloa
             return;
         }
 
+        if (deduplicatePayloads) {
+            // Updates replace what the previous version installed, so keep the payload store in step
+            PayloadStore store;
+            QStringList replacedFiles = entry.installedFiles();
+            if (!storedPayload.isEmpty()) {
+                replacedFiles.removeIf([&installedFiles](const QString &file) {
+                    return installedFiles.contains(file);
+                });
+                store.addReferences(storedPayload, installedFiles);
+            } else {
+                replacedFiles << installedFiles;
+            }
+            store.release(replacedFiles);
+        }
         entry.setInstalledFiles(installedFiles);
 
         auto installationFinished = [this, entry]() {
@@ -576,6 +650,9 @@ void Installation::uninstall(Entry entry)
         }
         Entry newEntry = entry;
         if (deletionSuccessful) {
+            if (deduplicatePayloads) {
+                PayloadStore().release(lst);
+            }
             newEntry.setEntryDeleted();
         } else {
             newEntry.setStatus(KNSCore::Entry::Installed);
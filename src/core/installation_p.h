@@ -9,6 +9,7 @@
 #ifndef KNEWSTUFF3_INSTALLATION_P_H
 #define KNEWSTUFF3_INSTALLATION_P_H
 
+#include <QHash>
 #include <QObject>
 #include <QString>
 
@@ -63,11 +64,12 @@ public Q_SLOTS:
      * be called.
      *
      * @param entry Entry to download payload file for
+     * @param mirrors Other locations the payload can be downloaded from, see Provider::mirrorsFor()
      *
      * @see signalPayloadLoaded
      * @see signalPayloadFailed
      */
-    void downloadPayload(const KNSCore::Entry &entry);
+    void downloadPayload(const KNSCore::Entry &entry, const QList<QUrl> &mirrors = {});
 
     /**
      * Installs an entry's payload file. This includes verification, if
@@ -80,11 +82,12 @@ public Q_SLOTS:
      * will its status)
      *
      * @param entry Entry to be installed
+     * @param mirrors Other locations the payload can be downloaded from, see Provider::mirrorsFor()
      *
      * @see signalInstallationFinished
      * @see signalInstallationFailed
      */
-    void install(const KNSCore::Entry &entry);
+    void install(const KNSCore::Entry &entry, const QList<QUrl> &mirrors = {});
 
     /**
      * Uninstalls an entry. It reverses the steps which were performed
@@ -160,6 +163,10 @@ private:
     QString kpackageStructure;
     UncompressionOptions uncompressSetting = UncompressionOptions::NeverUncompress;
 
+    // whether payloads go through the PayloadStore, and the stored payloads which downloaded files were checked out of
+    bool deduplicatePayloads = false;
+    QHash<QString, QString> storedPayloads;
+
     Q_DISABLE_COPY(Installation)
 };
 
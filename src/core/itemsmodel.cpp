@@ -8,6 +8,7 @@
 #include "itemsmodel.h"
 
 #include <KLocalizedString>
+#include <QSet>
 #include <knewstuffcore_debug.h>
 
 #include "enginebase.h"
@@ -25,6 +26,8 @@ public:
     EngineBase *const engine;
     // the list of entries
     QList<Entry> entries;
+    // the row of each entry in the list
+    QHash<EntryKey, int> rows;
     bool hasPreviewImages = false;
 };
 ItemsModel::ItemsModel(EngineBase *engine, QObject *parent)
@@ -51,54 +54,92 @@ QVariant ItemsModel::data(const QModelIndex &index, int role) const
 
 int ItemsModel::row(const Entry &entry) const
 {
-    return d->entries.indexOf(entry);
+    return d->rows.value(entry.key(), -1);
 }
 
 void ItemsModel::slotEntriesLoaded(const KNSCore::Entry::List &entries)
 {
-    for (const KNSCore::Entry &entry : entries) {
-        addEntry(entry);
+    // Find out which entries are new first, so they can all go in as one block of rows. This
+    // might be expensive, but it avoids duplicates, which is not awesome for the user
+    QSet<EntryKey> newKeys;
+    newKeys.reserve(entries.count());
+    for (const Entry &entry : entries) {
+        if (!d->rows.contains(entry.key())) {
+            newKeys.insert(entry.key());
+        }
+    }
+    if (newKeys.isEmpty()) {
+        return;
     }
-}
 
-void ItemsModel::addEntry(const Entry &entry)
-{
-    // This might be expensive, but it avoids duplicates, which is not awesome for the user
-    if (!d->entries.contains(entry)) {
-        QString preview = entry.previewUrl(Entry::PreviewSmall1);
-        if (!d->hasPreviewImages && !preview.isEmpty()) {
-            d->hasPreviewImages = true;
-            if (rowCount() > 0) {
-                Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+    // If the whole page is new, share it rather than copying it entry by entry
+    Entry::List added;
+    if (newKeys.count() == entries.count()) {
+        added = entries;
+    } else {
+        added.reserve(newKeys.count());
+        for (const Entry &entry : entries) {
+            if (newKeys.remove(entry.key())) {
+                added.append(entry);
             }
         }
+    }
 
-        qCDebug(KNEWSTUFFCORE) << "adding entry " << entry.name() << " to the model";
-        beginInsertRows(QModelIndex(), d->entries.count(), d->entries.count());
-        d->entries.append(entry);
-        endInsertRows();
+    if (!d->hasPreviewImages) {
+        for (const Entry &entry : std::as_const(added)) {
+            if (!entry.previewUrl(Entry::PreviewSmall1).isEmpty()) {
+                d->hasPreviewImages = true;
+                if (rowCount() > 0) {
+                    Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+                }
+                break;
+            }
+        }
+    }
 
-        if (!preview.isEmpty() && entry.previewImage(Entry::PreviewSmall1).isNull()) {
+    qCDebug(KNEWSTUFFCORE) << "adding" << added.count() << "entries to the model";
+    const int firstRow = d->entries.count();
+    beginInsertRows(QModelIndex(), firstRow, firstRow + added.count() - 1);
+    if (d->entries.isEmpty()) {
+        d->entries = added;
+    } else {
+        d->entries.append(added);
+    }
+    for (int i = 0; i < added.count(); ++i) {
+        d->rows.insert(added.at(i).key(), firstRow + i);
+    }
+    endInsertRows();
+
+    for (const Entry &entry : std::as_const(added)) {
+        if (!entry.previewUrl(Entry::PreviewSmall1).isEmpty() && entry.previewImage(Entry::PreviewSmall1).isNull()) {
             Q_EMIT loadPreview(entry, Entry::PreviewSmall1);
         }
     }
 }
 
+void ItemsModel::addEntry(const Entry &entry)
+{
+    slotEntriesLoaded(Entry::List{entry});
+}
+
 void ItemsModel::removeEntry(const Entry &entry)
 {
     qCDebug(KNEWSTUFFCORE) << "removing entry " << entry.name() << " from the model";
-    int index = d->entries.indexOf(entry);
+    int index = row(entry);
     if (index > -1) {
         beginRemoveRows(QModelIndex(), index, index);
         d->entries.removeAt(index);
+        d->rows.remove(entry.key());
+        for (int i = index; i < d->entries.count(); ++i) {
+            d->rows[d->entries.at(i).key()] = i;
+        }
         endRemoveRows();
     }
 }
 
 void ItemsModel::slotEntryChanged(const Entry &entry)
 {
-    int i = d->entries.indexOf(entry);
-    QModelIndex entryIndex = index(i, 0);
+    QModelIndex entryIndex = index(row(entry), 0);
     Q_EMIT dataChanged(entryIndex, entryIndex);
 }
 
@@ -106,6 +147,7 @@ void ItemsModel::clearEntries()
 {
     beginResetModel();
     d->entries.clear();
+    d->rows.clear();
     endResetModel();
 }
 
@@ -0,0 +1,76 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include "connectivity.h"
+
+#include "knewstuffcore_debug.h"
+
+#include <QCoreApplication>
+#include <QNetworkInformation>
+
+#include <atomic>
+
+using namespace KNSCore;
+
+class KNSCore::ConnectivityPrivate
+{
+public:
+    // Read from whichever thread the workers run on
+    std::atomic<bool> online = true;
+};
+
+class KNSCore::ConnectivityHelper
+{
+public:
+    // Created the first time anybody asks, which may well be from one of the worker threads
+    const std::unique_ptr<Connectivity> q{new Connectivity};
+};
+Q_GLOBAL_STATIC(ConnectivityHelper, s_connectivity)
+
+Connectivity *Connectivity::instance()
+{
+    return s_connectivity()->q.get();
+}
+
+Connectivity::Connectivity()
+    : QObject(nullptr)
+    , d(new ConnectivityPrivate)
+{
+    if (QCoreApplication::instance()) {
+        moveToThread(QCoreApplication::instance()->thread());
+    }
+
+    if (qEnvironmentVariableIntValue("KNEWSTUFF_OFFLINE") == 1) {
+        qCDebug(KNEWSTUFFCORE) << "KNEWSTUFF_OFFLINE is set, behaving as if there was no network";
+        d->online = false;
+        return;
+    }
+
+    if (!QNetworkInformation::loadBackendByFeatures(QNetworkInformation::Feature::Reachability)) {
+        qCDebug(KNEWSTUFFCORE) << "No network information backend available, assuming we are online";
+        return;
+    }
+    QNetworkInformation *information = QNetworkInformation::instance();
+    const auto update = [this](QNetworkInformation::Reachability reachability) {
+        // Not knowing is no reason to give up on the network
+        const bool online = reachability != QNetworkInformation::Reachability::Disconnected;
+        if (d->online.exchange(online) != online) {
+            qCDebug(KNEWSTUFFCORE) << "Network is now" << (online ? "reachable" : "unreachable");
+            Q_EMIT onlineChanged(online);
+        }
+    };
+    d->online = information->reachability() != QNetworkInformation::Reachability::Disconnected;
+    connect(information, &QNetworkInformation::reachabilityChanged, this, update);
+}
+
+Connectivity::~Connectivity() = default;
+
+bool Connectivity::isOnline() const
+{
+    return d->online;
+}
+
+#include "moc_connectivity.cpp"
@@ -0,0 +1,44 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <QObject>
+
+#include <memory>
+
+namespace KNSCore
+{
+class ConnectivityPrivate;
+class ConnectivityHelper;
+/**
+ * Whether we can expect to reach the network. This uses QNetworkInformation where a backend
+ * supporting reachability is available, and otherwise assumes we are online.
+ *
+ * Setting KNEWSTUFF_OFFLINE=1 in the environment stands in for the real thing, and makes
+ * everything behave as if there were no network (useful for testing offline behaviour).
+ */
+class Connectivity : public QObject
+{
+    Q_OBJECT
+public:
+    static Connectivity *instance();
+    ~Connectivity() override;
+
+    bool isOnline() const;
+
+    Q_SIGNAL void onlineChanged(bool online);
+
+private:
+    friend class ConnectivityHelper;
+    Connectivity();
+    const std::unique_ptr<ConnectivityPrivate> d;
+};
+
+}
+
+#endif // CONNECTIVITY_H
@@ -18,6 +18,7 @@ public:
     DownloadJobPrivate() = default;
     QUrl source;
     QUrl destination;
+    QList<QUrl> mirrors;
 };
 
 DownloadJob::DownloadJob(const QUrl &source, const QUrl &destination, int permissions, JobFlags flags, QObject *parent)
@@ -42,9 +43,15 @@ void DownloadJob::start()
     HTTPWorker *worker = new HTTPWorker(d->source, d->destination, HTTPWorker::DownloadJob, this);
     connect(worker, &HTTPWorker::completed, this, &DownloadJob::handleWorkerCompleted);
     connect(worker, &HTTPWorker::error, this, &DownloadJob::handleWorkerError);
+    worker->setMirrors(d->mirrors);
     worker->startRequest();
 }
 
+void DownloadJob::setMirrors(const QList<QUrl> &mirrors)
+{
+    d->mirrors = mirrors;
+}
+
 void DownloadJob::handleWorkerCompleted()
 {
     emitResult();
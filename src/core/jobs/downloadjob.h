@@ -24,6 +24,12 @@ public:
 
     Q_SCRIPTABLE void start() override;
 
+    /**
+     * Other urls serving the same content as the source, see HTTPJob::setMirrors().
+     * This must be set before the job is started.
+     */
+    void setMirrors(const QList<QUrl> &mirrors);
+
 protected Q_SLOTS:
     void handleWorkerCompleted();
     void handleWorkerError(const QString &error);
@@ -19,6 +19,13 @@ public:
     QUrl source;
     LoadType loadType = Reload;
     JobFlags flags = DefaultFlags;
+    int transferTimeout = 0;
+    bool hedgingEnabled = false;
+    QUrl hedgeUrl;
+    QList<QUrl> mirrors;
+    QList<QNetworkReply::RawHeaderPair> requestHeaders;
+    int statusCode = 0;
+    QList<QNetworkReply::RawHeaderPair> responseHeaders;
 };
 
 HTTPJob::HTTPJob(const QUrl &source, LoadType loadType, JobFlags flags, QObject *parent)
@@ -45,9 +52,54 @@ void HTTPJob::start()
     connect(worker, &HTTPWorker::completed, this, &HTTPJob::handleWorkerCompleted);
     connect(worker, &HTTPWorker::error, this, &HTTPJob::handleWorkerError);
     connect(worker, &HTTPWorker::httpError, this, &HTTPJob::httpError);
+    connect(worker, &HTTPWorker::responseReceived, this, [this](int status, const QList<QNetworkReply::RawHeaderPair> &rawHeaders) {
+        d->statusCode = status;
+        d->responseHeaders = rawHeaders;
+    });
+    worker->setRequestHeaders(d->requestHeaders);
+    worker->setLoadType(d->loadType);
+    worker->setTransferTimeout(d->transferTimeout);
+    worker->setHedgingEnabled(d->hedgingEnabled, d->hedgeUrl);
+    worker->setMirrors(d->mirrors);
     worker->startRequest();
 }
 
+void HTTPJob::setTransferTimeout(int msecs)
+{
+    d->transferTimeout = msecs;
+}
+
+void HTTPJob::setHedgingEnabled(bool enabled, const QUrl &hedgeUrl)
+{
+    d->hedgingEnabled = enabled;
+    d->hedgeUrl = hedgeUrl;
+}
+
+void HTTPJob::setMirrors(const QList<QUrl> &mirrors)
+{
+    d->mirrors = mirrors;
+}
+
+void HTTPJob::setRequestHeader(const QByteArray &name, const QByteArray &value)
+{
+    d->requestHeaders << QNetworkReply::RawHeaderPair(name, value);
+}
+
+int HTTPJob::statusCode() const
+{
+    return d->statusCode;
+}
+
+QByteArray HTTPJob::responseHeader(const QByteArray &name) const
+{
+    for (const QNetworkReply::RawHeaderPair &header : std::as_const(d->responseHeaders)) {
+        if (header.first.compare(name, Qt::CaseInsensitive) == 0) {
+            return header.second;
+        }
+    }
+    return QByteArray();
+}
+
 void HTTPJob::handleWorkerData(const QByteArray &data)
 {
     Q_EMIT HTTPJob::data(this, data);
@@ -29,6 +29,57 @@ public:
 
     static HTTPJob *get(const QUrl &source, LoadType loadType = Reload, JobFlags flags = DefaultFlags, QObject *parent = nullptr);
 
+    /**
+     * Fail the job if no data has been transferred for the given amount of time.
+     * This must be set before the job is started (for jobs created using get(), that
+     * means before returning to the event loop).
+     * @param msecs The timeout in milliseconds, 0 (the default) meaning no timeout
+     * @since 6.0
+     */
+    void setTransferTimeout(int msecs);
+
+    /**
+     * Whether to hedge the request: if the first byte of the response does not arrive
+     * within the latency budget for the host (the 95th percentile of what has been observed
+     * so far), a duplicate request is sent and the slower of the two is cancelled.
+     * Only enable this for idempotent requests, such as fetching metadata.
+     * @param enabled Whether to hedge the request (off by default)
+     * @param hedgeUrl An optional mirror the duplicate request is sent to, rather than the source url
+     * @since 6.0
+     */
+    void setHedgingEnabled(bool enabled, const QUrl &hedgeUrl = QUrl());
+
+    /**
+     * Other urls serving the same content as the source, which the request may be sent to
+     * instead, or carry on from if the source fails or slows down.
+     * This must be set before the job is started.
+     * @see Provider::mirrorsFor()
+     * @since 6.0
+     */
+    void setMirrors(const QList<QUrl> &mirrors);
+
+    /**
+     * Add a raw header to the request. Setting either If-None-Match or If-Modified-Since
+     * makes the request conditional, and it will bypass the local cache, so check
+     * statusCode() for 304 (Not Modified) once the job has finished.
+     * This must be set before the job is started.
+     * @since 6.0
+     */
+    void setRequestHeader(const QByteArray &name, const QByteArray &value);
+
+    /**
+     * The HTTP status code of the final response, or 0 if none has been received (yet)
+     * @since 6.0
+     */
+    int statusCode() const;
+
+    /**
+     * The value of the given header in the final response, or an empty byte array if
+     * the response did not contain it. The header name is matched case insensitively.
+     * @since 6.0
+     */
+    QByteArray responseHeader(const QByteArray &name) const;
+
 Q_SIGNALS:
     /**
      * Data from the worker has arrived.
@@ -6,11 +6,20 @@
 
 #include "httpworker.h"
 
+#include "connectivity.h"
 #include "knewstuff_version.h"
 #include "knewstuffcore_debug.h"
 
 #include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QNetworkAccessManager>
@@ -19,6 +28,11 @@
 #include <QStandardPaths>
 #include <QStorageInfo>
 #include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
 
 class HTTPWorkerNAM
 {
@@ -46,6 +60,248 @@ public:
 
 Q_GLOBAL_STATIC(HTTPWorkerNAM, s_httpWorkerNAM)
 
+// Time to first byte and throughput, per host, for the most recent requests, and whether the host
+// has been failing us. The latencies decide how long we wait before hedging a request which has not seen
+// any response yet, and all of it together decides which of several mirrors we go to.
+class HostStatistics
+{
+public:
+    void recordLatency(const QString &host, qint64 msecs)
+    {
+        QMutexLocker locker(&mutex);
+        QList<qint64> &hostSamples = hosts[host].latencies;
+        hostSamples << msecs;
+        if (hostSamples.count() > maxSamples) {
+            hostSamples.removeFirst();
+        }
+    }
+
+    // Transfers which are too short say more about latency than they do about throughput
+    void recordTransfer(const QString &host, qint64 bytes, qint64 msecs)
+    {
+        if (bytes < minThroughputSample || msecs <= 0) {
+            return;
+        }
+        QMutexLocker locker(&mutex);
+        Host &statistics = hosts[host];
+        const double throughput = double(bytes) / msecs;
+        statistics.throughput = statistics.throughput > 0 ? statistics.throughput * 0.7 + throughput * 0.3 : throughput;
+        statistics.failures = 0;
+    }
+
+    void recordFailure(const QString &host)
+    {
+        QMutexLocker locker(&mutex);
+        Host &statistics = hosts[host];
+        ++statistics.failures;
+        statistics.lastFailure = QDateTime::currentMSecsSinceEpoch();
+    }
+
+    int budget(const QString &host)
+    {
+        QMutexLocker locker(&mutex);
+        QList<qint64> hostSamples = hosts.value(host).latencies;
+        if (hostSamples.count() < minSamples) {
+            return defaultBudget;
+        }
+        std::sort(hostSamples.begin(), hostSamples.end());
+        const qint64 p95 = hostSamples.at((hostSamples.count() * 95) / 100);
+        return int(std::clamp<qint64>(p95, minBudget, maxBudget));
+    }
+
+    // Bytes per millisecond, or 0 if we do not know
+    double throughput(const QString &host)
+    {
+        QMutexLocker locker(&mutex);
+        return hosts.value(host).throughput;
+    }
+
+    // How long we expect a typical download from the host to take, in milliseconds. Hosts which
+    // failed recently are left alone for a while, for longer the more often they failed.
+    qint64 expectedCost(const QString &host)
+    {
+        QMutexLocker locker(&mutex);
+        const Host statistics = hosts.value(host);
+        if (statistics.failures > 0) {
+            const qint64 backoff = std::min<qint64>(maxBackoff, qint64(baseBackoff) << std::min(statistics.failures - 1, 10));
+            if (QDateTime::currentMSecsSinceEpoch() - statistics.lastFailure < backoff) {
+                return std::numeric_limits<qint64>::max() / 2 + statistics.failures;
+            }
+        }
+        QList<qint64> latencies = statistics.latencies;
+        qint64 latency = defaultBudget;
+        if (!latencies.isEmpty()) {
+            std::sort(latencies.begin(), latencies.end());
+            latency = latencies.at(latencies.count() / 2);
+        }
+        const double throughput = statistics.throughput > 0 ? statistics.throughput : defaultThroughput;
+        return latency + qint64(typicalTransfer / throughput);
+    }
+
+    static constexpr int maxSamples = 32;
+    static constexpr int minSamples = 8;
+    static constexpr int defaultBudget = 1500;
+    static constexpr int minBudget = 250;
+    static constexpr int maxBudget = 10000;
+    static constexpr qint64 minThroughputSample = 64 * 1024;
+    static constexpr double typicalTransfer = 1024 * 1024;
+    static constexpr double defaultThroughput = 1024; // bytes per millisecond, so 1MiB/s
+    static constexpr int baseBackoff = 30000;
+    static constexpr int maxBackoff = 10 * 60000;
+
+    struct Host {
+        QList<qint64> latencies;
+        double throughput = 0;
+        int failures = 0;
+        qint64 lastFailure = 0;
+    };
+    QMutex mutex;
+    QHash<QString, Host> hosts;
+};
+
+Q_GLOBAL_STATIC(HostStatistics, s_hostStatistics)
+
+// How often a transfer which has mirrors to fall back on is looked at, and what makes us switch to another mirror:
+// no data for a while, or data coming in a lot slower than another mirror managed lately
+static constexpr int TRANSFER_CHECK_INTERVAL{2000};
+static constexpr qint64 STALL_TIMEOUT{10000};
+static constexpr qint64 MIN_THROUGHPUT_MEASUREMENT{5000};
+static constexpr double DEGRADED_THROUGHPUT_FACTOR{4};
+
+// Recording and replaying of network sessions, so a (slow) session can be reproduced offline, and used as a benchmark.
+// With KNEWSTUFF_NETWORK_RECORD set to a directory, every response is stored in that directory along with its timing.
+// With KNEWSTUFF_NETWORK_REPLAY set to such a directory, responses are served from there rather than the network,
+// with the recorded timing scaled by KNEWSTUFF_NETWORK_REPLAY_SPEED (1 by default, 0 meaning as fast as possible).
+class SessionArchive
+{
+public:
+    struct Exchange {
+        QUrl url;
+        int status = 0;
+        QList<QNetworkReply::RawHeaderPair> headers;
+        qint64 firstByte = 0;
+        qint64 total = 0;
+        QString error;
+        QString bodyFile;
+    };
+
+    SessionArchive()
+        : recordDirectory(qEnvironmentVariable("KNEWSTUFF_NETWORK_RECORD"))
+        , replayDirectory(qEnvironmentVariable("KNEWSTUFF_NETWORK_REPLAY"))
+    {
+        bool ok = false;
+        speed = qEnvironmentVariable("KNEWSTUFF_NETWORK_REPLAY_SPEED").toDouble(&ok);
+        if (!ok || speed < 0) {
+            speed = 1.0;
+        }
+        if (!replayDirectory.isEmpty()) {
+            load();
+        } else if (!recordDirectory.isEmpty()) {
+            QDir().mkpath(recordDirectory);
+            qCDebug(KNEWSTUFFCORE) << "Recording network session to" << recordDirectory;
+        }
+    }
+
+    bool isReplaying() const
+    {
+        return !replayDirectory.isEmpty();
+    }
+
+    bool isRecording() const
+    {
+        return replayDirectory.isEmpty() && !recordDirectory.isEmpty();
+    }
+
+    qint64 scaled(qint64 msecs) const
+    {
+        return qint64(msecs * speed);
+    }
+
+    // Responses for the same url are handed out in the order they were recorded, with the last one repeating
+    std::optional<Exchange> take(const QUrl &url)
+    {
+        QMutexLocker locker(&mutex);
+        QList<Exchange> &urlExchanges = exchanges[url];
+        if (urlExchanges.isEmpty()) {
+            return std::nullopt;
+        }
+        return urlExchanges.count() > 1 ? urlExchanges.takeFirst() : urlExchanges.first();
+    }
+
+    QByteArray body(const Exchange &exchange) const
+    {
+        QFile file(QDir(replayDirectory).filePath(exchange.bodyFile));
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    }
+
+    QString nextBodyFile()
+    {
+        QMutexLocker locker(&mutex);
+        return QDir(recordDirectory).filePath(QStringLiteral("%1.body").arg(++bodyCounter));
+    }
+
+    void record(const Exchange &exchange)
+    {
+        QJsonArray headers;
+        for (const QNetworkReply::RawHeaderPair &header : exchange.headers) {
+            headers.append(QJsonArray{QString::fromLatin1(header.first), QString::fromLatin1(header.second)});
+        }
+        const QJsonObject object{
+            {QStringLiteral("url"), exchange.url.toString()},
+            {QStringLiteral("status"), exchange.status},
+            {QStringLiteral("headers"), headers},
+            {QStringLiteral("firstByte"), exchange.firstByte},
+            {QStringLiteral("total"), exchange.total},
+            {QStringLiteral("error"), exchange.error},
+            {QStringLiteral("body"), QFileInfo(exchange.bodyFile).fileName()},
+        };
+        QMutexLocker locker(&mutex);
+        QFile index(QDir(recordDirectory).filePath(QStringLiteral("index.jsonl")));
+        if (index.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            index.write(QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n');
+        }
+    }
+
+private:
+    void load()
+    {
+        QFile index(QDir(replayDirectory).filePath(QStringLiteral("index.jsonl")));
+        if (!index.open(QIODevice::ReadOnly)) {
+            qCWarning(KNEWSTUFFCORE) << "Could not open the network session to replay from" << replayDirectory;
+            return;
+        }
+        while (!index.atEnd()) {
+            const QJsonObject object = QJsonDocument::fromJson(index.readLine()).object();
+            if (object.isEmpty()) {
+                continue;
+            }
+            Exchange exchange;
+            exchange.url = QUrl(object.value(QStringLiteral("url")).toString());
+            exchange.status = object.value(QStringLiteral("status")).toInt();
+            const QJsonArray headers = object.value(QStringLiteral("headers")).toArray();
+            for (const QJsonValue &header : headers) {
+                const QJsonArray pair = header.toArray();
+                exchange.headers << QNetworkReply::RawHeaderPair(pair.at(0).toString().toLatin1(), pair.at(1).toString().toLatin1());
+            }
+            exchange.firstByte = object.value(QStringLiteral("firstByte")).toInteger();
+            exchange.total = object.value(QStringLiteral("total")).toInteger();
+            exchange.error = object.value(QStringLiteral("error")).toString();
+            exchange.bodyFile = object.value(QStringLiteral("body")).toString();
+            exchanges[exchange.url] << exchange;
+        }
+        qCDebug(KNEWSTUFFCORE) << "Replaying network session from" << replayDirectory << "with" << exchanges.count() << "urls, at speed" << speed;
+    }
+
+    QMutex mutex;
+    const QString recordDirectory;
+    const QString replayDirectory;
+    double speed = 1.0;
+    QHash<QUrl, QList<Exchange>> exchanges;
+    int bodyCounter = 0;
+};
+
+Q_GLOBAL_STATIC(SessionArchive, s_sessionArchive)
+
 using namespace KNSCore;
 
 class KNSCore::HTTPWorkerPrivate
@@ -63,6 +319,34 @@ public:
     QUrl redirectUrl;
 
     QFile dataFile;
+
+    QList<QNetworkReply::RawHeaderPair> requestHeaders;
+    LoadType loadType = Reload;
+    int transferTimeout = 0;
+    bool hedgingEnabled = false;
+    QUrl hedgeUrl;
+    QNetworkReply *hedgeReply = nullptr;
+    QTimer hedgeTimer;
+    QElapsedTimer requestTimer;
+    bool firstByteReceived = false;
+
+    // The urls the content can be fetched from, best first, and which one we are using
+    QList<QUrl> mirrors;
+    QList<QUrl> candidates;
+    int candidate = 0;
+    QTimer transferCheckTimer;
+    // How much the data() signal has handed out, so another mirror can carry on where the last one left off
+    qint64 bytesDelivered = 0;
+    qint64 skipBytes = 0;
+    bool rangeChecked = false;
+    // How the current reply is doing, relative to requestTimer
+    qint64 replyBytes = 0;
+    qint64 firstByteAt = 0;
+    qint64 lastDataAt = 0;
+
+    // Only used while recording a session
+    SessionArchive::Exchange recording;
+    QFile recordingBody;
 };
 
 HTTPWorker::HTTPWorker(const QUrl &url, JobType jobType, QObject *parent)
@@ -71,6 +355,10 @@ HTTPWorker::HTTPWorker(const QUrl &url, JobType jobType, QObject *parent)
 {
     d->jobType = jobType;
     d->source = url;
+    d->hedgeTimer.setSingleShot(true);
+    connect(&d->hedgeTimer, &QTimer::timeout, this, &HTTPWorker::startHedgeRequest);
+    d->transferCheckTimer.setInterval(TRANSFER_CHECK_INTERVAL);
+    connect(&d->transferCheckTimer, &QTimer::timeout, this, &HTTPWorker::checkTransfer);
 }
 
 HTTPWorker::HTTPWorker(const QUrl &source, const QUrl &destination, KNSCore::HTTPWorker::JobType jobType, QObject *parent)
@@ -80,6 +368,10 @@ HTTPWorker::HTTPWorker(const QUrl &source, const QUrl &destination, KNSCore::HTT
     d->jobType = jobType;
     d->source = source;
     d->destination = destination;
+    d->hedgeTimer.setSingleShot(true);
+    connect(&d->hedgeTimer, &QTimer::timeout, this, &HTTPWorker::startHedgeRequest);
+    d->transferCheckTimer.setInterval(TRANSFER_CHECK_INTERVAL);
+    connect(&d->transferCheckTimer, &QTimer::timeout, this, &HTTPWorker::checkTransfer);
 }
 
 HTTPWorker::~HTTPWorker() = default;
@@ -89,6 +381,32 @@ void HTTPWorker::setUrl(const QUrl &url)
     d->source = url;
 }
 
+void HTTPWorker::setTransferTimeout(int msecs)
+{
+    d->transferTimeout = msecs;
+}
+
+void HTTPWorker::setHedgingEnabled(bool enabled, const QUrl &hedgeUrl)
+{
+    d->hedgingEnabled = enabled;
+    d->hedgeUrl = hedgeUrl;
+}
+
+void HTTPWorker::setRequestHeaders(const QList<QNetworkReply::RawHeaderPair> &headers)
+{
+    d->requestHeaders = headers;
+}
+
+void HTTPWorker::setLoadType(LoadType loadType)
+{
+    d->loadType = loadType;
+}
+
+void HTTPWorker::setMirrors(const QList<QUrl> &mirrors)
+{
+    d->mirrors = mirrors;
+}
+
 static void addUserAgent(QNetworkRequest &request)
 {
     QString agentHeader = QStringLiteral("KNewStuff/%1").arg(QLatin1String(KNEWSTUFF_VERSION_STRING));
@@ -98,7 +416,11 @@ static void addUserAgent(QNetworkRequest &request)
     request.setHeader(QNetworkRequest::UserAgentHeader, agentHeader);
     // If the remote supports HTTP/2, then we should definitely be using that
     request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+}
 
+// The cache heuristic used when the caller did not ask for anything in particular
+static void applyDefaultCachePolicy(QNetworkRequest &request)
+{
     // Assume that no cache expiration time will be longer than a week, but otherwise prefer the cache
     // This is mildly hacky, but if we don't do this, we end up with infinite cache expirations in some
     // cases, which of course isn't really acceptable... See ed62ee20 for a situation where that happened.
@@ -111,6 +433,41 @@ static void addUserAgent(QNetworkRequest &request)
     }
 }
 
+// Applies the per-worker settings to a request about to be sent
+static void prepareRequest(QNetworkRequest &request, HTTPWorkerPrivate *d)
+{
+    addUserAgent(request);
+    switch (d->loadType) {
+    case Reload:
+        applyDefaultCachePolicy(request);
+        break;
+    case NoReload:
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
+        break;
+    case AlwaysNetwork:
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        break;
+    case CacheOnly:
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysCache);
+        break;
+    case Revalidate:
+        // This is what HTTP caching semantics call for: stale copies are revalidated using their validators
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
+        break;
+    }
+    if (d->transferTimeout > 0) {
+        request.setTransferTimeout(d->transferTimeout);
+    }
+    for (const QNetworkReply::RawHeaderPair &header : std::as_const(d->requestHeaders)) {
+        request.setRawHeader(header.first, header.second);
+        if (d->loadType != CacheOnly
+            && (header.first.compare("If-None-Match", Qt::CaseInsensitive) == 0 || header.first.compare("If-Modified-Since", Qt::CaseInsensitive) == 0)) {
+            // The server is the one being asked whether things changed, not the cache
+            request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        }
+    }
+}
+
 void HTTPWorker::startRequest()
 {
     if (d->reply) {
@@ -118,30 +475,259 @@ void HTTPWorker::startRequest()
         return;
     }
 
-    QNetworkRequest request(d->source);
-    addUserAgent(request);
+    if (s_sessionArchive->isReplaying()) {
+        replayRequest();
+        return;
+    }
+
+    if (d->loadType != CacheOnly && !Connectivity::instance()->isOnline()) {
+        // Rather than waiting for the request to time out, give back whatever the disk cache has
+        qCDebug(KNEWSTUFFCORE) << "Offline, only looking in the cache for" << d->source.toDisplayString();
+        d->loadType = CacheOnly;
+    }
+
+    d->candidates = {d->source};
+    const QList<QUrl> mirrors = d->loadType == CacheOnly ? QList<QUrl>() : d->mirrors;
+    for (const QUrl &mirror : mirrors) {
+        if (mirror.isValid() && !d->candidates.contains(mirror)) {
+            d->candidates << mirror;
+        }
+    }
+    if (d->candidates.count() > 1) {
+        QHash<QString, qint64> costs;
+        for (const QUrl &candidate : std::as_const(d->candidates)) {
+            costs.insert(candidate.host(), s_hostStatistics->expectedCost(candidate.host()));
+        }
+        std::stable_sort(d->candidates.begin(), d->candidates.end(), [&costs](const QUrl &a, const QUrl &b) {
+            return costs.value(a.host()) < costs.value(b.host());
+        });
+        qCDebug(KNEWSTUFFCORE) << "Fetching" << d->source.toDisplayString() << "from the best of" << d->candidates;
+        d->transferCheckTimer.start();
+    }
+    d->candidate = 0;
+    d->bytesDelivered = 0;
+    sendRequest(d->candidates.first());
+
+    if (s_sessionArchive->isRecording()) {
+        d->recording = SessionArchive::Exchange();
+        d->recording.url = d->source;
+        d->recording.bodyFile = s_sessionArchive->nextBodyFile();
+        d->recordingBody.setFileName(d->recording.bodyFile);
+        if (!d->recordingBody.open(QIODevice::WriteOnly)) {
+            qCWarning(KNEWSTUFFCORE) << "Could not record the response for" << d->source << "to" << d->recording.bodyFile;
+        }
+    }
+    if (d->jobType == DownloadJob) {
+        d->dataFile.setFileName(d->destination.toLocalFile());
+        connect(this, &HTTPWorker::data, this, &HTTPWorker::handleData);
+    } else if (d->hedgingEnabled && d->loadType != CacheOnly) {
+        d->hedgeTimer.start(s_hostStatistics->budget(d->candidates.first().host()));
+    }
+}
+
+void HTTPWorker::sendRequest(const QUrl &url)
+{
+    QNetworkRequest request(url);
+    prepareRequest(request, d.get());
+    if (d->bytesDelivered > 0) {
+        // Carry on where the previous mirror left off. Partial responses are of no use to the cache.
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(d->bytesDelivered) + '-');
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+    }
     d->reply = s_httpWorkerNAM->get(request);
-    connect(d->reply, &QNetworkReply::readyRead, this, &HTTPWorker::handleReadyRead);
-    connect(d->reply, &QNetworkReply::finished, this, &HTTPWorker::handleFinished);
+    connectReply(d->reply);
+    d->requestTimer.start();
+    d->firstByteReceived = false;
+    d->rangeChecked = false;
+    d->skipBytes = 0;
+    d->replyBytes = 0;
+    d->firstByteAt = 0;
+    d->lastDataAt = 0;
+}
+
+bool HTTPWorker::failOver(const QString &reason)
+{
+    if (d->hedgeReply || d->candidate + 1 >= d->candidates.count()) {
+        return false;
+    }
+    const QUrl failed = d->candidates.at(d->candidate);
+    const QUrl next = d->candidates.at(++d->candidate);
+    qCWarning(KNEWSTUFFCORE) << "Switching from" << failed.toDisplayString() << "to" << next.toDisplayString() << "after" << d->bytesDelivered
+                             << "bytes:" << reason;
+    s_hostStatistics->recordFailure(failed.host());
+    disconnect(d->reply, nullptr, this, nullptr);
+    d->reply->abort();
+    d->reply->deleteLater();
+    d->redirectUrl.clear();
+    sendRequest(next);
+    return true;
+}
+
+void HTTPWorker::checkTransfer()
+{
+    if (!d->reply || d->reply->isFinished() || d->hedgeReply || d->candidate + 1 >= d->candidates.count()) {
+        return;
+    }
+    const qint64 now = d->requestTimer.elapsed();
+    if (now - d->lastDataAt > STALL_TIMEOUT) {
+        failOver(QStringLiteral("no data for %1 ms").arg(now - d->lastDataAt));
+        return;
+    }
+    if (!d->firstByteReceived || now - d->firstByteAt < MIN_THROUGHPUT_MEASUREMENT) {
+        return;
+    }
+    // Only give up on a mirror which is doing a lot worse than another one has been doing lately
+    const double throughput = double(d->replyBytes) / (now - d->firstByteAt);
+    double alternative = 0;
+    for (int i = d->candidate + 1; i < d->candidates.count(); ++i) {
+        const QString host = d->candidates.at(i).host();
+        if (s_hostStatistics->expectedCost(host) < std::numeric_limits<qint64>::max() / 2) {
+            alternative = std::max(alternative, s_hostStatistics->throughput(host));
+        }
+    }
+    if (alternative > throughput * DEGRADED_THROUGHPUT_FACTOR) {
+        failOver(QStringLiteral("%1 bytes/ms, where another mirror does %2").arg(throughput).arg(alternative));
+    }
+}
+
+void HTTPWorker::replayRequest()
+{
+    const std::optional<SessionArchive::Exchange> exchange = s_sessionArchive->take(d->source);
+    if (!exchange) {
+        QTimer::singleShot(0, this, [this]() {
+            qCWarning(KNEWSTUFFCORE) << "No recorded response for" << d->source;
+            Q_EMIT error(QStringLiteral("No recorded response for %1").arg(d->source.toDisplayString()));
+            Q_EMIT completed();
+        });
+        return;
+    }
     if (d->jobType == DownloadJob) {
         d->dataFile.setFileName(d->destination.toLocalFile());
         connect(this, &HTTPWorker::data, this, &HTTPWorker::handleData);
     }
+    QTimer::singleShot(s_sessionArchive->scaled(exchange->firstByte), this, [this, exchange]() {
+        const QByteArray body = s_sessionArchive->body(*exchange);
+        for (qsizetype position = 0; position < body.size(); position += 32768) {
+            Q_EMIT data(body.mid(position, 32768));
+        }
+        QTimer::singleShot(s_sessionArchive->scaled(qMax<qint64>(0, exchange->total - exchange->firstByte)), this, [this, exchange]() {
+            if (!exchange->error.isEmpty()) {
+                if (exchange->status > 100) {
+                    Q_EMIT httpError(exchange->status, exchange->headers);
+                }
+                Q_EMIT error(exchange->error);
+            }
+            if (d->dataFile.isOpen()) {
+                d->dataFile.close();
+            }
+            Q_EMIT responseReceived(exchange->status, exchange->headers);
+            Q_EMIT completed();
+        });
+    });
+}
+
+void HTTPWorker::connectReply(QNetworkReply *reply)
+{
+    connect(reply, &QNetworkReply::readyRead, this, &HTTPWorker::handleReadyRead);
+    connect(reply, &QNetworkReply::finished, this, &HTTPWorker::handleFinished);
+}
+
+void HTTPWorker::startHedgeRequest()
+{
+    if (d->firstByteReceived || d->hedgeReply || !d->reply || d->reply->isFinished()) {
+        return;
+    }
+    const QUrl url = d->hedgeUrl.isValid() ? d->hedgeUrl : d->reply->url();
+    qCDebug(KNEWSTUFFCORE) << "No response from" << d->reply->url().toDisplayString() << "after" << d->requestTimer.elapsed()
+                           << "ms, sending a hedged request to" << url.toDisplayString();
+    QNetworkRequest request(url);
+    prepareRequest(request, d.get());
+    d->hedgeReply = s_httpWorkerNAM->get(request);
+    connectReply(d->hedgeReply);
+}
+
+// Keeps the given reply, and cancels the other one of a pair of hedged requests
+static void settleHedge(HTTPWorker *worker, HTTPWorkerPrivate *d, QNetworkReply *winner)
+{
+    QNetworkReply *loser = winner == d->hedgeReply ? d->reply : d->hedgeReply;
+    d->hedgeReply = nullptr;
+    d->reply = winner;
+    QObject::disconnect(loser, nullptr, worker, nullptr);
+    loser->abort();
+    loser->deleteLater();
 }
 
 void HTTPWorker::handleReadyRead()
 {
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply) {
+        reply = d->reply;
+    }
+    if (!d->firstByteReceived) {
+        d->firstByteReceived = true;
+        d->hedgeTimer.stop();
+        d->recording.firstByte = d->requestTimer.elapsed();
+        d->firstByteAt = d->requestTimer.elapsed();
+        s_hostStatistics->recordLatency(reply->url().host(), d->requestTimer.elapsed());
+        if (d->hedgeReply) {
+            settleHedge(this, d.get(), reply);
+        }
+    }
+    if (reply != d->reply) {
+        return;
+    }
     QMutexLocker locker(&s_httpWorkerNAM->mutex);
     if (d->reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isNull()) {
+        if (!d->rangeChecked) {
+            d->rangeChecked = true;
+            if (d->bytesDelivered > 0 && d->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+                // The mirror sends everything, rather than the part we asked for
+                d->skipBytes = d->bytesDelivered;
+            }
+        }
         do {
-            Q_EMIT data(d->reply->read(32768));
+            QByteArray chunk = d->reply->read(32768);
+            d->replyBytes += chunk.size();
+            d->lastDataAt = d->requestTimer.elapsed();
+            if (d->skipBytes > 0) {
+                const qint64 skipped = std::min<qint64>(d->skipBytes, chunk.size());
+                chunk.remove(0, skipped);
+                d->skipBytes -= skipped;
+                if (chunk.isEmpty()) {
+                    continue;
+                }
+            }
+            if (d->recordingBody.isOpen()) {
+                d->recordingBody.write(chunk);
+            }
+            d->bytesDelivered += chunk.size();
+            Q_EMIT data(chunk);
         } while (!d->reply->atEnd());
     }
 }
 
 void HTTPWorker::handleFinished()
 {
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (d->hedgeReply && reply) {
+        if (reply->error() != QNetworkReply::NoError) {
+            // One of the two racing requests failed, so just let the other one carry on
+            qCDebug(KNEWSTUFFCORE) << "Hedged request for" << reply->url().toDisplayString() << "failed:" << reply->errorString();
+            QNetworkReply *other = reply == d->hedgeReply ? d->reply : d->hedgeReply;
+            disconnect(reply, nullptr, this, nullptr);
+            reply->deleteLater();
+            d->hedgeReply = nullptr;
+            d->reply = other;
+            return;
+        }
+        settleHedge(this, d.get(), reply);
+    }
+    d->hedgeTimer.stop();
     qCDebug(KNEWSTUFFCORE) << Q_FUNC_INFO << d->reply->url();
+    if (d->reply->error() != QNetworkReply::NoError && failOver(d->reply->errorString())) {
+        return;
+    }
     if (d->reply->error() != QNetworkReply::NoError) {
         qCWarning(KNEWSTUFFCORE) << d->reply->errorString();
         if (d->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() > 100) {
@@ -163,10 +749,10 @@ void HTTPWorker::handleFinished()
                                    << d->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
             d->reply->deleteLater();
             QNetworkRequest request(d->redirectUrl);
-            addUserAgent(request);
+            prepareRequest(request, d.get());
             d->reply = s_httpWorkerNAM->get(request);
-            connect(d->reply, &QNetworkReply::readyRead, this, &HTTPWorker::handleReadyRead);
-            connect(d->reply, &QNetworkReply::finished, this, &HTTPWorker::handleFinished);
+            connectReply(d->reply);
+            d->rangeChecked = false;
             return;
         } else {
             qCWarning(KNEWSTUFFCORE) << "Redirection to" << d->redirectUrl.toDisplayString() << "forbidden.";
@@ -179,6 +765,27 @@ void HTTPWorker::handleFinished()
         d->dataFile.close();
     }
 
+    d->transferCheckTimer.stop();
+    if (d->reply->error() == QNetworkReply::NoError) {
+        if (!d->reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool()) {
+            s_hostStatistics->recordTransfer(d->reply->url().host(), d->replyBytes, d->requestTimer.elapsed() - d->firstByteAt);
+        }
+    } else if (d->reply->error() != QNetworkReply::OperationCanceledError) {
+        s_hostStatistics->recordFailure(d->reply->url().host());
+    }
+
+    if (d->recordingBody.isOpen()) {
+        d->recordingBody.close();
+        d->recording.status = d->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        d->recording.headers = d->reply->rawHeaderPairs();
+        d->recording.total = d->requestTimer.elapsed();
+        if (d->reply->error() != QNetworkReply::NoError) {
+            d->recording.error = d->reply->errorString();
+        }
+        s_sessionArchive->record(d->recording);
+    }
+
+    Q_EMIT responseReceived(d->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), d->reply->rawHeaderPairs());
     d->redirectUrl.clear();
     Q_EMIT completed();
 }
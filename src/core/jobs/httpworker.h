@@ -10,6 +10,8 @@
 #include <QNetworkReply>
 #include <QUrl>
 
+#include "jobbase.h"
+
 class QNetworkReply;
 namespace KNSCore
 {
@@ -30,6 +32,40 @@ public:
 
     void setUrl(const QUrl &url);
 
+    /**
+     * Abort the request if no data has been transferred for this long
+     * @param msecs The transfer timeout in milliseconds, 0 (the default) meaning no timeout
+     */
+    void setTransferTimeout(int msecs);
+
+    /**
+     * Issue a duplicate request if the first byte of the response does not arrive within
+     * the latency budget for the host (its observed 95th percentile), and keep whichever
+     * reply responds first. Only use this for idempotent requests (GetJob).
+     * @param enabled Whether hedging is enabled (off by default)
+     * @param hedgeUrl Where the duplicate request should go. If invalid, the original url is requested again
+     */
+    void setHedgingEnabled(bool enabled, const QUrl &hedgeUrl = QUrl());
+
+    /**
+     * Headers to add to the request. If these make the request conditional (If-None-Match or
+     * If-Modified-Since), the request is always sent to the server, rather than being answered
+     * from the cache.
+     */
+    void setRequestHeaders(const QList<QNetworkReply::RawHeaderPair> &headers);
+
+    /**
+     * How the request makes use of the local cache (Reload by default). With CacheOnly, hedging
+     * and mirrors are not used, as there is only the one cached copy.
+     */
+    void setLoadType(LoadType loadType);
+
+    /**
+     * Other urls serving the same content. Whichever of the url and its mirrors has been fastest lately
+     * is used, and if it fails or slows down a lot, the request carries on from another one.
+     */
+    void setMirrors(const QList<QUrl> &mirrors);
+
     Q_SIGNAL void error(QString error);
     Q_SIGNAL void progress(qlonglong current, qlonglong total);
     Q_SIGNAL void completed();
@@ -43,11 +79,24 @@ public:
      */
     Q_SIGNAL void httpError(int status, QList<QNetworkReply::RawHeaderPair> rawHeaders);
 
+    /**
+     * Fired when the final (that is, not redirected) response has been received, before completed()
+     * @param status The HTTP status code of the response (0 for non-HTTP requests)
+     * @param rawHeaders The raw HTTP headers of the response
+     */
+    Q_SIGNAL void responseReceived(int status, QList<QNetworkReply::RawHeaderPair> rawHeaders);
+
     Q_SLOT void handleReadyRead();
     Q_SLOT void handleFinished();
     Q_SLOT void handleData(const QByteArray &data);
 
 private:
+    void startHedgeRequest();
+    void replayRequest();
+    void sendRequest(const QUrl &url);
+    bool failOver(const QString &reason);
+    void checkTransfer();
+    void connectReply(QNetworkReply *reply);
     const std::unique_ptr<HTTPWorkerPrivate> d;
 };
 
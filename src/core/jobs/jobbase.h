@@ -21,7 +21,16 @@ enum JobFlag {
 Q_DECLARE_FLAGS(JobFlags, JobFlag)
 Q_DECLARE_OPERATORS_FOR_FLAGS(JobFlags)
 
-enum LoadType { Reload, NoReload };
+/**
+ * How a request makes use of the local cache
+ */
+enum LoadType {
+    Reload, ///< Use cached copies which expire within a week, and go to the network for anything else
+    NoReload, ///< Use any cached copy, however stale, and only go to the network if there is none
+    AlwaysNetwork, ///< Never use the cache, though the response is still stored in it
+    CacheOnly, ///< Only use the cache, failing if there is no cached copy, and never touch the network
+    Revalidate, ///< Use cached copies while they are fresh, and ask the server whether stale ones are still current
+};
 
 }
 
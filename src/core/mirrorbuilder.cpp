@@ -0,0 +1,421 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include "mirrorbuilder.h"
+
+#include "jobs/filecopyjob.h"
+#include "knewstuffcore_debug.h"
+
+#include <KLocalizedString>
+
+#include <QDir>
+#include <QDomDocument>
+#include <QMap>
+#include <QSaveFile>
+#include <QSet>
+#include <QTimer>
+
+#include <algorithm>
+
+using namespace KNSCore;
+
+// Static providers only have one page, but others are paged through until they run out, which might be never
+static const int MAX_PAGES{1000};
+static const int PAGE_SIZE{100};
+// How long to wait for a provider to come back with a payload link before giving up on the link
+static const int PAYLOAD_LINK_TIMEOUT{60000};
+// How many entries are mirrored at the same time
+static const int MAX_PARALLEL_ENTRIES{4};
+
+class KNSCore::MirrorBuilderPrivate
+{
+public:
+    QDir directory;
+    bool providersLoaded = false;
+    bool buildRequested = false;
+    bool building = false;
+
+    QList<QSharedPointer<Provider>> pendingProviders;
+    QSharedPointer<Provider> currentProvider;
+    QList<QMetaObject::Connection> providerConnections;
+    Provider::SearchRequest currentRequest;
+    QSet<EntryKey> seenEntries;
+    Entry::List pendingEntries;
+    int listedEntries = 0;
+    // Whether the provider is done listing its entries (and we are not done with it yet)
+    bool listed = false;
+
+    // The entries being mirrored right now. Providers do not say which link they came back with, so the
+    // links of an entry are asked for one after the other (with different entries going on at the same time).
+    struct ActiveEntry {
+        Entry entry;
+        int index = 0; // where the entry was listed, which is where it goes in the feed
+        QList<int> pendingLinks; // the first one is the one we are waiting for
+        QList<QPair<int, QUrl>> payloads; // the links we have so far
+        int lateReplies = 0; // replies still to come for the links we gave up on, which arrive before that of the current one
+        QTimer *timer = nullptr;
+    };
+    QHash<EntryKey, ActiveEntry> activeEntries;
+    // The mirrored entries of the current provider, by index
+    QMap<int, QDomElement> mirrored;
+
+    QDomDocument feed;
+    QDomDocument providersDocument;
+    int fileNumber = 0;
+    int feedNumber = 0;
+    int mirroredEntries = 0;
+    int failedEntries = 0;
+
+    // A name for a file inside the mirror, unique for this mirror and keeping the original name recognisable
+    QString fileName(const QString &subdirectory, const QUrl &source, const QString &fallbackName)
+    {
+        const QString name = source.fileName().isEmpty() ? fallbackName : source.fileName();
+        return QStringLiteral("%1/%2-%3").arg(subdirectory).arg(++fileNumber).arg(name);
+    }
+
+    void disconnectProvider()
+    {
+        for (const QMetaObject::Connection &connection : std::as_const(providerConnections)) {
+            QObject::disconnect(connection);
+        }
+        providerConnections.clear();
+    }
+};
+
+MirrorBuilder::MirrorBuilder(QObject *parent)
+    : EngineBase(parent)
+    , d(new MirrorBuilderPrivate)
+{
+    // Every payload link gets resolved anyway
+    setPrefetchPayloadLinks(false);
+    connect(this, &EngineBase::signalProvidersLoaded, this, [this]() {
+        d->providersLoaded = true;
+        if (d->buildRequested && !d->building) {
+            start();
+        }
+    });
+    connect(this, &EngineBase::signalErrorCode, this, [this](const KNSCore::ErrorCode &error) {
+        if ((error == KNSCore::ProviderError || error == KNSCore::ConfigFileError) && d->buildRequested && !d->building) {
+            // Without providers, there is nothing to build a mirror of
+            finish(false);
+        }
+    });
+}
+
+MirrorBuilder::~MirrorBuilder() = default;
+
+void MirrorBuilder::build(const QString &directory)
+{
+    d->directory = QDir(directory);
+    d->buildRequested = true;
+    if (d->providersLoaded) {
+        start();
+    }
+}
+
+int MirrorBuilder::mirroredEntries() const
+{
+    return d->mirroredEntries;
+}
+
+int MirrorBuilder::failedEntries() const
+{
+    return d->failedEntries;
+}
+
+void MirrorBuilder::start()
+{
+    d->building = true;
+    if (!d->directory.mkpath(QStringLiteral("previews")) || !d->directory.mkpath(QStringLiteral("payloads"))) {
+        qCWarning(KNEWSTUFFCORE) << "Could not create the mirror directory" << d->directory.absolutePath();
+        finish(false);
+        return;
+    }
+    d->providersDocument = QDomDocument();
+    d->providersDocument.appendChild(d->providersDocument.createElement(QStringLiteral("knewstuffproviders")));
+    d->pendingProviders = providers();
+    mirrorNextProvider();
+}
+
+void MirrorBuilder::mirrorNextProvider()
+{
+    d->disconnectProvider();
+    if (d->pendingProviders.isEmpty()) {
+        QSaveFile file(d->directory.filePath(QStringLiteral("mirror.providers")));
+        if (!file.open(QIODevice::WriteOnly) || file.write(d->providersDocument.toByteArray(2)) < 0 || !file.commit()) {
+            qCWarning(KNEWSTUFFCORE) << "Could not write the providers file of the mirror:" << file.errorString();
+            finish(false);
+            return;
+        }
+        finish(true);
+        return;
+    }
+
+    d->currentProvider = d->pendingProviders.takeFirst();
+    Q_EMIT signalMessage(i18n("Mirroring %1", d->currentProvider->name()));
+    d->feed = QDomDocument();
+    d->feed.appendChild(d->feed.createElement(QStringLiteral("knewstuff")));
+    d->seenEntries.clear();
+    d->pendingEntries.clear();
+    d->listedEntries = 0;
+    d->listed = false;
+    d->mirrored.clear();
+    d->currentRequest = Provider::SearchRequest(Provider::Newest, Provider::None, QString(), categories(), 0, PAGE_SIZE);
+    d->currentRequest.deadline = requestDeadline();
+
+    const Provider *provider = d->currentProvider.data();
+    d->providerConnections << connect(provider,
+                                      &Provider::loadingFinished,
+                                      this,
+                                      [this](const KNSCore::Provider::SearchRequest &request, const KNSCore::Entry::List &entries) {
+                                          if (!(request == d->currentRequest)) {
+                                              return;
+                                          }
+                                          bool foundNew = false;
+                                          for (const Entry &entry : entries) {
+                                              if (!d->seenEntries.contains(entry.key())) {
+                                                  d->seenEntries.insert(entry.key());
+                                                  d->pendingEntries << entry;
+                                                  foundNew = true;
+                                              }
+                                          }
+                                          // A provider which keeps handing us the same entries has nothing more to give
+                                          if (foundNew && d->currentRequest.page + 1 < MAX_PAGES) {
+                                              ++d->currentRequest.page;
+                                              QTimer::singleShot(0, this, &MirrorBuilder::loadPage);
+                                          } else {
+                                              d->listed = true;
+                                              QTimer::singleShot(0, this, &MirrorBuilder::mirrorMoreEntries);
+                                          }
+                                      });
+    d->providerConnections << connect(provider, &Provider::loadingFailed, this, [this](const KNSCore::Provider::SearchRequest &request) {
+        if (request == d->currentRequest) {
+            qCWarning(KNEWSTUFFCORE) << "Loading page" << request.page << "of" << d->currentProvider->id() << "failed, mirroring what we have";
+            d->listed = true;
+            QTimer::singleShot(0, this, &MirrorBuilder::mirrorMoreEntries);
+        }
+    });
+    d->providerConnections << connect(provider, &Provider::payloadLinkLoaded, this, [this](const KNSCore::Entry &entry) {
+        const auto it = d->activeEntries.find(entry.key());
+        if (it == d->activeEntries.end() || it->pendingLinks.isEmpty()) {
+            return;
+        }
+        if (it->lateReplies > 0) {
+            // The answer to a link which timed out, and which is not part of the mirror any more
+            --it->lateReplies;
+            return;
+        }
+        it->timer->stop();
+        const int linkId = it->pendingLinks.takeFirst();
+        if (!entry.payload().isEmpty()) {
+            it->payloads << qMakePair(linkId, QUrl(entry.payload()));
+        }
+        loadNextPayloadLink(entry.key());
+    });
+    loadPage();
+}
+
+void MirrorBuilder::loadPage()
+{
+    d->currentProvider->loadEntries(d->currentRequest);
+}
+
+void MirrorBuilder::mirrorMoreEntries()
+{
+    if (!d->listed) {
+        return;
+    }
+    while (d->activeEntries.count() < MAX_PARALLEL_ENTRIES && !d->pendingEntries.isEmpty()) {
+        MirrorBuilderPrivate::ActiveEntry active;
+        active.entry = d->pendingEntries.takeFirst();
+        active.index = d->listedEntries++;
+        const QList<Entry::DownloadLinkInformation> links = active.entry.downloadLinkInformationList();
+        for (const Entry::DownloadLinkInformation &link : links) {
+            active.pendingLinks << link.id;
+        }
+        if (active.pendingLinks.isEmpty()) {
+            // Just the one payload
+            active.pendingLinks << 1;
+        }
+        active.timer = new QTimer(this);
+        active.timer->setSingleShot(true);
+        active.timer->setInterval(PAYLOAD_LINK_TIMEOUT);
+        const EntryKey key = active.entry.key();
+        connect(active.timer, &QTimer::timeout, this, [this, key]() {
+            MirrorBuilderPrivate::ActiveEntry &active = d->activeEntries[key];
+            qCWarning(KNEWSTUFFCORE) << "No payload link" << active.pendingLinks.constFirst() << "for" << active.entry.name()
+                                     << ", leaving it out of the mirror";
+            active.pendingLinks.removeFirst();
+            ++active.lateReplies;
+            loadNextPayloadLink(key);
+        });
+        d->activeEntries.insert(key, active);
+        loadNextPayloadLink(key);
+    }
+    if (d->activeEntries.isEmpty() && d->pendingEntries.isEmpty()) {
+        finishProvider();
+    }
+}
+
+void MirrorBuilder::loadNextPayloadLink(EntryKey key)
+{
+    MirrorBuilderPrivate::ActiveEntry &active = d->activeEntries[key];
+    if (active.pendingLinks.isEmpty()) {
+        mirrorEntry(key);
+        return;
+    }
+    active.timer->start();
+    d->currentProvider->loadPayloadLink(active.entry, active.pendingLinks.constFirst());
+}
+
+void MirrorBuilder::mirrorEntry(EntryKey key)
+{
+    const MirrorBuilderPrivate::ActiveEntry active = d->activeEntries.value(key);
+    const Entry &entry = active.entry;
+    if (active.payloads.isEmpty()) {
+        qCWarning(KNEWSTUFFCORE) << "No payload for" << entry.name() << ", leaving it out of the mirror";
+        entryDone(key, QDomElement());
+        return;
+    }
+
+    // A detached copy, as the entry itself is shared with the provider
+    Entry mirrored;
+    mirrored.setEntryXML(entry.entryXML());
+    mirrored.setStatus(Entry::Downloadable);
+    mirrored.setInstalledFiles(QStringList());
+    mirrored.clearDownloadLinkInformation();
+
+    // Files which are used more than once (the same image for the small and big preview, say) are only mirrored once
+    QHash<QUrl, QString> targets;
+    QSet<QString> payloadTargets;
+    const auto target = [this, &targets](const QUrl &source, const QString &subdirectory, const QString &fallbackName) {
+        auto it = targets.constFind(source);
+        if (it == targets.constEnd()) {
+            it = targets.insert(source, d->fileName(subdirectory, source, fallbackName));
+        }
+        return *it;
+    };
+
+    // Every link is listed, the first one also being the payload, so the static provider serves whichever is asked for
+    const QList<Entry::DownloadLinkInformation> links = entry.downloadLinkInformationList();
+    for (const QPair<int, QUrl> &payload : active.payloads) {
+        const int linkId = payload.first;
+        const QString file = target(payload.second, QStringLiteral("payloads"), QStringLiteral("payload"));
+        payloadTargets.insert(file);
+        Entry::DownloadLinkInformation link;
+        link.id = linkId;
+        link.isDownloadtypeLink = false;
+        const auto original = std::find_if(links.cbegin(), links.cend(), [linkId](const Entry::DownloadLinkInformation &link) {
+            return link.id == linkId;
+        });
+        if (original != links.cend()) {
+            link = *original;
+        }
+        link.descriptionLink = file;
+        mirrored.appendDownloadLinkInformation(link);
+    }
+    mirrored.setPayload(mirrored.downloadLinkInformationList().constFirst().descriptionLink);
+
+    for (int type = Entry::PreviewSmall1; type <= Entry::PreviewBig3; ++type) {
+        const QUrl preview(entry.previewUrl(Entry::PreviewType(type)));
+        if (!preview.isEmpty()) {
+            mirrored.setPreviewUrl(target(preview, QStringLiteral("previews"), QStringLiteral("preview")), Entry::PreviewType(type));
+        }
+    }
+
+    // Wait for all the files to arrive before adding the entry to the feed. Without any of its payloads there is no
+    // point in having the entry, but if only some of them or the previews are missing, we can still offer it.
+    auto pending = QSharedPointer<int>::create(targets.count());
+    for (auto it = targets.cbegin(); it != targets.cend(); ++it) {
+        const QString file = it.value();
+        const bool isPayload = payloadTargets.contains(file);
+        FileCopyJob *job =
+            FileCopyJob::file_copy(it.key(), QUrl::fromLocalFile(d->directory.filePath(file)), -1, JobFlag::Overwrite | JobFlag::HideProgressInfo);
+        connect(job, &KJob::result, this, [this, job, key, file, mirrored, pending, isPayload]() mutable {
+            if (job->error()) {
+                qCWarning(KNEWSTUFFCORE) << "Could not mirror" << job->srcUrl() << ":" << job->errorString();
+                if (isPayload) {
+                    QList<Entry::DownloadLinkInformation> links = mirrored.downloadLinkInformationList();
+                    links.removeIf([&file](const Entry::DownloadLinkInformation &link) {
+                        return link.descriptionLink == file;
+                    });
+                    mirrored.clearDownloadLinkInformation();
+                    for (const Entry::DownloadLinkInformation &link : std::as_const(links)) {
+                        mirrored.appendDownloadLinkInformation(link);
+                    }
+                    mirrored.setPayload(links.isEmpty() ? QString() : links.constFirst().descriptionLink);
+                } else {
+                    for (int type = Entry::PreviewSmall1; type <= Entry::PreviewBig3; ++type) {
+                        if (mirrored.previewUrl(Entry::PreviewType(type)) == file) {
+                            mirrored.setPreviewUrl(QString(), Entry::PreviewType(type));
+                        }
+                    }
+                }
+            }
+            if (--*pending > 0) {
+                return;
+            }
+            entryDone(key, mirrored.payload().isEmpty() ? QDomElement() : mirrored.entryXML());
+        });
+    }
+}
+
+void MirrorBuilder::entryDone(EntryKey key, const QDomElement &mirrored)
+{
+    const MirrorBuilderPrivate::ActiveEntry active = d->activeEntries.take(key);
+    // We may well be in the middle of its timeout
+    active.timer->deleteLater();
+    if (mirrored.isNull()) {
+        ++d->failedEntries;
+    } else {
+        d->mirrored.insert(active.index, mirrored);
+        ++d->mirroredEntries;
+    }
+    // Not straight away, as we may well be in the middle of one of the provider's signals
+    QTimer::singleShot(0, this, &MirrorBuilder::mirrorMoreEntries);
+}
+
+void MirrorBuilder::finishProvider()
+{
+    d->listed = false;
+    // In the order the provider listed them, whichever order they were done in
+    for (const QDomElement &entry : std::as_const(d->mirrored)) {
+        d->feed.documentElement().appendChild(d->feed.importNode(entry, true));
+    }
+    d->mirrored.clear();
+    const QString feedName = QStringLiteral("feed-%1.xml").arg(++d->feedNumber);
+    QSaveFile file(d->directory.filePath(feedName));
+    if (!file.open(QIODevice::WriteOnly) || file.write(d->feed.toByteArray(2)) < 0 || !file.commit()) {
+        qCWarning(KNEWSTUFFCORE) << "Could not write the feed for" << d->currentProvider->id() << ":" << file.errorString();
+        finish(false);
+        return;
+    }
+
+    // The mirror is read by a static provider, which keeps the id of the original one
+    QDomElement provider = d->providersDocument.createElement(QStringLiteral("provider"));
+    provider.setAttribute(QStringLiteral("id"), d->currentProvider->id());
+    provider.setAttribute(QStringLiteral("downloadurl"), feedName);
+    const QUrl website = d->currentProvider->website();
+    provider.setAttribute(QStringLiteral("nouploadurl"), website.isValid() ? website.toString() : d->currentProvider->id());
+    QDomElement title = d->providersDocument.createElement(QStringLiteral("title"));
+    title.appendChild(d->providersDocument.createTextNode(d->currentProvider->name()));
+    provider.appendChild(title);
+    d->providersDocument.documentElement().appendChild(provider);
+
+    mirrorNextProvider();
+}
+
+void MirrorBuilder::finish(bool success)
+{
+    d->disconnectProvider();
+    d->building = false;
+    d->buildRequested = false;
+    qCDebug(KNEWSTUFFCORE) << "Mirror in" << d->directory.absolutePath() << "finished, success:" << success << "mirrored:" << d->mirroredEntries
+                           << "failed:" << d->failedEntries;
+    Q_EMIT finished(success);
+}
+
+#include "moc_mirrorbuilder.cpp"
@@ -0,0 +1,88 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KNEWSTUFF3_MIRRORBUILDER_H
+#define KNEWSTUFF3_MIRRORBUILDER_H
+
+#include "enginebase.h"
+
+#include "knewstuffcore_export.h"
+
+#include <memory>
+
+class QDomElement;
+
+namespace KNSCore
+{
+class MirrorBuilderPrivate;
+
+/**
+ * Builds a local mirror of everything offered by the providers of a knsrc configuration.
+ *
+ * Initialise the builder with the configuration to mirror using init(), and call build()
+ * with the directory the mirror should be written to. Once finished, that directory contains:
+ * - mirror.providers, a providers file listing one static provider for each mirrored provider
+ * - a feed for each provider, listing all of its entries
+ * - previews/ and payloads/, holding all the preview images of those entries, along with the
+ *   payloads behind every one of their download links
+ *
+ * All links inside the mirror are relative, so the directory can be moved elsewhere (for example
+ * onto machines without network access). To use it, set the Mirror key in the knsrc file to the
+ * path of the directory, and searching, previews and installation are all served from it. Entries
+ * keep the provider id of the provider they were mirrored from, so things installed from the
+ * original provider are recognised as such.
+ *
+ * @since 6.0
+ */
+class KNEWSTUFFCORE_EXPORT MirrorBuilder : public EngineBase
+{
+    Q_OBJECT
+public:
+    explicit MirrorBuilder(QObject *parent = nullptr);
+    ~MirrorBuilder() override;
+
+    /**
+     * Start writing the mirror into the given directory, which is created if it does not exist.
+     * If the providers are not yet loaded, this happens once they are.
+     * Progress is reported through signalMessage(), and finished() is emitted when done.
+     * @param directory The directory to write the mirror to
+     */
+    void build(const QString &directory);
+
+    /**
+     * The number of entries which were mirrored, valid once finished() has been emitted
+     */
+    int mirroredEntries() const;
+
+    /**
+     * The number of entries which could not be mirrored (for example because their payload
+     * could not be downloaded), and which are left out of the mirror
+     */
+    int failedEntries() const;
+
+    /**
+     * Emitted when building the mirror is done
+     * @param success Whether the mirror was written, even if some entries failed to make it in
+     */
+    Q_SIGNAL void finished(bool success);
+
+private:
+    void start();
+    void mirrorNextProvider();
+    void loadPage();
+    void mirrorMoreEntries();
+    void loadNextPayloadLink(KNSCore::EntryKey key);
+    void mirrorEntry(KNSCore::EntryKey key);
+    void entryDone(KNSCore::EntryKey key, const QDomElement &mirrored);
+    void finishProvider();
+    void finish(bool success);
+
+    const std::unique_ptr<MirrorBuilderPrivate> d;
+};
+
+}
+
+#endif
@@ -0,0 +1,355 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include "payloadstore_p.h"
+
+#include "knewstuffcore_debug.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUuid>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+using namespace KNSCore;
+
+// Payloads nothing refers to are kept around this long, as an installation may still be about to refer to them
+static const qint64 UNREFERENCED_GRACE_SECS{24 * 60 * 60};
+
+namespace
+{
+// Taken while changing the index, as other processes may be using the store as well
+class IndexLocker
+{
+public:
+    explicit IndexLocker(const QString &root)
+        : m_lock(root + QLatin1String("/index.lock"))
+    {
+        m_lock.setStaleLockTime(30000);
+        m_locked = QDir().mkpath(root) && m_lock.lock();
+        if (!m_locked) {
+            qCWarning(KNEWSTUFFCORE) << "Could not lock the payload store in" << root << m_lock.error();
+        }
+    }
+    bool isLocked() const
+    {
+        return m_locked;
+    }
+
+private:
+    QLockFile m_lock;
+    bool m_locked = false;
+};
+}
+
+static QDomElement payloadElement(const QDomDocument &index, const QString &hash)
+{
+    for (QDomElement e = index.documentElement().firstChildElement(QStringLiteral("payload")); !e.isNull();
+         e = e.nextSiblingElement(QStringLiteral("payload"))) {
+        if (e.attribute(QStringLiteral("hash")) == hash) {
+            return e;
+        }
+    }
+    return QDomElement();
+}
+
+PayloadStore::PayloadStore()
+    : PayloadStore(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QLatin1String("/knewstuff3/store"))
+{
+}
+
+PayloadStore::PayloadStore(const QString &root)
+    : m_root(root)
+{
+}
+
+QString PayloadStore::root() const
+{
+    return m_root;
+}
+
+QString PayloadStore::objectPath(const QString &hash) const
+{
+    return QStringLiteral("%1/objects/%2/%3").arg(m_root, hash.left(2), hash);
+}
+
+bool PayloadStore::readIndex(QDomDocument &index) const
+{
+    QFile file(m_root + QLatin1String("/index.xml"));
+    if (!file.exists()) {
+        index.appendChild(index.createElement(QStringLiteral("payloadstore")));
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly) || !index.setContent(&file) || index.documentElement().tagName() != QLatin1String("payloadstore")) {
+        qCWarning(KNEWSTUFFCORE) << "The index of the payload store" << file.fileName() << "could not be read";
+        index = QDomDocument();
+        index.appendChild(index.createElement(QStringLiteral("payloadstore")));
+        return false;
+    }
+    return true;
+}
+
+bool PayloadStore::writeIndex(const QDomDocument &index) const
+{
+    QSaveFile file(m_root + QLatin1String("/index.xml"));
+    if (!file.open(QIODevice::WriteOnly) || file.write(index.toByteArray(1)) < 0 || !file.commit()) {
+        qCWarning(KNEWSTUFFCORE) << "Could not write the index of the payload store:" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QString PayloadStore::find(const QString &source, const QString &version) const
+{
+    if (!QFileInfo::exists(m_root + QLatin1String("/index.xml"))) {
+        return QString();
+    }
+    QDomDocument index;
+    readIndex(index);
+    for (QDomElement payload = index.documentElement().firstChildElement(QStringLiteral("payload")); !payload.isNull();
+         payload = payload.nextSiblingElement(QStringLiteral("payload"))) {
+        for (QDomElement e = payload.firstChildElement(QStringLiteral("source")); !e.isNull(); e = e.nextSiblingElement(QStringLiteral("source"))) {
+            if (e.attribute(QStringLiteral("id")) == source && e.attribute(QStringLiteral("version")) == version) {
+                const QString hash = payload.attribute(QStringLiteral("hash"));
+                return QFileInfo::exists(objectPath(hash)) ? hash : QString();
+            }
+        }
+    }
+    return QString();
+}
+
+QString PayloadStore::add(const QString &file, const QString &source, const QString &version)
+{
+    QFile payload(file);
+    QCryptographicHash hasher(QCryptographicHash::Sha256);
+    if (!payload.open(QIODevice::ReadOnly) || !hasher.addData(&payload)) {
+        qCWarning(KNEWSTUFFCORE) << "Could not read" << file << "to add it to the payload store";
+        return QString();
+    }
+    payload.close();
+    const QString hash = QString::fromLatin1(hasher.result().toHex());
+
+    const IndexLocker locker(m_root);
+    if (!locker.isLocked()) {
+        return QString();
+    }
+    QDomDocument index;
+    readIndex(index);
+
+    const QString object = objectPath(hash);
+    if (QFileInfo::exists(object)) {
+        qCDebug(KNEWSTUFFCORE) << "The payload store has" << file << "already";
+        QFile::remove(file);
+    } else if (!QDir().mkpath(QFileInfo(object).path()) || !payload.rename(object)) {
+        qCWarning(KNEWSTUFFCORE) << "Could not move" << file << "into the payload store:" << payload.errorString();
+        return QString();
+    }
+    QFile::setPermissions(object, QFileDevice::ReadOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther);
+
+    QDomElement element = payloadElement(index, hash);
+    if (element.isNull()) {
+        element = index.createElement(QStringLiteral("payload"));
+        element.setAttribute(QStringLiteral("hash"), hash);
+        index.documentElement().appendChild(element);
+    }
+    element.setAttribute(QStringLiteral("added"), QString::number(QDateTime::currentSecsSinceEpoch()));
+    bool knownSource = false;
+    for (QDomElement e = element.firstChildElement(QStringLiteral("source")); !e.isNull(); e = e.nextSiblingElement(QStringLiteral("source"))) {
+        knownSource = knownSource || (e.attribute(QStringLiteral("id")) == source && e.attribute(QStringLiteral("version")) == version);
+    }
+    if (!knownSource) {
+        QDomElement sourceElement = index.createElement(QStringLiteral("source"));
+        sourceElement.setAttribute(QStringLiteral("id"), source);
+        sourceElement.setAttribute(QStringLiteral("version"), version);
+        element.appendChild(sourceElement);
+    }
+
+    removeUnreferenced(index, hash);
+    writeIndex(index);
+    return hash;
+}
+
+QString PayloadStore::checkout(const QString &hash, const QString &fileName) const
+{
+    const QString directory = m_root + QLatin1String("/tmp");
+    if (!QDir().mkpath(directory)) {
+        return QString();
+    }
+    const QString target = QStringLiteral("%1/%2-%3").arg(directory, QUuid::createUuid().toString(QUuid::Id128), fileName);
+    if (!materialize(objectPath(hash), target)) {
+        qCWarning(KNEWSTUFFCORE) << "Could not check out" << hash << "from the payload store";
+        return QString();
+    }
+    return target;
+}
+
+void PayloadStore::addReferences(const QString &hash, const QStringList &files)
+{
+    const IndexLocker locker(m_root);
+    if (!locker.isLocked()) {
+        return;
+    }
+    QDomDocument index;
+    readIndex(index);
+    QDomElement element = payloadElement(index, hash);
+    if (element.isNull()) {
+        qCWarning(KNEWSTUFFCORE) << "The payload store does not know about" << hash;
+        return;
+    }
+
+    QList<QDomElement> orphaned;
+    for (QDomElement payload = index.documentElement().firstChildElement(QStringLiteral("payload")); !payload.isNull();
+         payload = payload.nextSiblingElement(QStringLiteral("payload"))) {
+        bool moved = false;
+        QDomElement e = payload.firstChildElement(QStringLiteral("file"));
+        while (!e.isNull()) {
+            const QDomElement next = e.nextSiblingElement(QStringLiteral("file"));
+            if (files.contains(e.attribute(QStringLiteral("path")))) {
+                payload.removeChild(e);
+                moved = true;
+            }
+            e = next;
+        }
+        if (moved && payload != element && payload.firstChildElement(QStringLiteral("file")).isNull()) {
+            orphaned << payload;
+        }
+    }
+    for (const QString &file : files) {
+        QDomElement fileElement = index.createElement(QStringLiteral("file"));
+        fileElement.setAttribute(QStringLiteral("path"), file);
+        element.appendChild(fileElement);
+    }
+    // The files were the last ones installed from those, as happens when updating
+    for (const QDomElement &payload : std::as_const(orphaned)) {
+        QFile::remove(objectPath(payload.attribute(QStringLiteral("hash"))));
+        index.documentElement().removeChild(payload);
+    }
+    writeIndex(index);
+}
+
+void PayloadStore::release(const QStringList &files)
+{
+    if (files.isEmpty() || !QFileInfo::exists(m_root + QLatin1String("/index.xml"))) {
+        return;
+    }
+    const IndexLocker locker(m_root);
+    if (!locker.isLocked()) {
+        return;
+    }
+    QDomDocument index;
+    readIndex(index);
+    bool changed = false;
+    QDomElement payload = index.documentElement().firstChildElement(QStringLiteral("payload"));
+    while (!payload.isNull()) {
+        const QDomElement nextPayload = payload.nextSiblingElement(QStringLiteral("payload"));
+        bool released = false;
+        QDomElement e = payload.firstChildElement(QStringLiteral("file"));
+        while (!e.isNull()) {
+            const QDomElement next = e.nextSiblingElement(QStringLiteral("file"));
+            if (files.contains(e.attribute(QStringLiteral("path")))) {
+                payload.removeChild(e);
+                released = true;
+            }
+            e = next;
+        }
+        if (released && payload.firstChildElement(QStringLiteral("file")).isNull()) {
+            const QString hash = payload.attribute(QStringLiteral("hash"));
+            qCDebug(KNEWSTUFFCORE) << "Nothing refers to" << hash << "any longer, removing it from the payload store";
+            QFile::remove(objectPath(hash));
+            index.documentElement().removeChild(payload);
+        }
+        changed = changed || released;
+        payload = nextPayload;
+    }
+    if (changed) {
+        writeIndex(index);
+    }
+}
+
+int PayloadStore::referenceCount(const QString &hash) const
+{
+    QDomDocument index;
+    readIndex(index);
+    int count = 0;
+    const QDomElement payload = payloadElement(index, hash);
+    for (QDomElement e = payload.firstChildElement(QStringLiteral("file")); !e.isNull(); e = e.nextSiblingElement(QStringLiteral("file"))) {
+        ++count;
+    }
+    return count;
+}
+
+void PayloadStore::removeUnreferenced(QDomDocument &index, const QString &keep) const
+{
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QDomElement payload = index.documentElement().firstChildElement(QStringLiteral("payload"));
+    while (!payload.isNull()) {
+        const QDomElement next = payload.nextSiblingElement(QStringLiteral("payload"));
+        const QString hash = payload.attribute(QStringLiteral("hash"));
+        const bool unreferenced = payload.firstChildElement(QStringLiteral("file")).isNull()
+            && now - payload.attribute(QStringLiteral("added")).toLongLong() > UNREFERENCED_GRACE_SECS;
+        if (hash != keep && (unreferenced || !QFileInfo::exists(objectPath(hash)))) {
+            QFile::remove(objectPath(hash));
+            index.documentElement().removeChild(payload);
+        }
+        payload = next;
+    }
+
+    // Left behind by installations which did not get to use what they checked out
+    const QFileInfoList leftovers = QDir(m_root + QLatin1String("/tmp")).entryInfoList(QDir::Files);
+    for (const QFileInfo &leftover : leftovers) {
+        if (leftover.lastModified().secsTo(QDateTime::currentDateTime()) > UNREFERENCED_GRACE_SECS) {
+            QFile::remove(leftover.filePath());
+        }
+    }
+}
+
+bool PayloadStore::materialize(const QString &source, const QString &target)
+{
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    // A reflink shares the data until either side changes it, which is as good as a copy
+    const int in = ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+    if (in >= 0) {
+        const int out = ::open(QFile::encodeName(target).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        bool cloned = false;
+        if (out >= 0) {
+            cloned = ::ioctl(out, FICLONE, in) == 0;
+            ::close(out);
+            if (!cloned) {
+                ::unlink(QFile::encodeName(target).constData());
+            }
+        }
+        ::close(in);
+        if (cloned) {
+            return true;
+        }
+    }
+#endif
+#ifdef Q_OS_UNIX
+    // A hard link is the same file, which is why stored payloads are read-only
+    if (::link(QFile::encodeName(source).constData(), QFile::encodeName(target).constData()) == 0) {
+        return true;
+    }
+#endif
+    if (!QFile::copy(source, target)) {
+        return false;
+    }
+    QFile::setPermissions(target, QFile::permissions(target) | QFileDevice::WriteOwner);
+    return true;
+}
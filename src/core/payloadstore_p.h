@@ -0,0 +1,99 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KNEWSTUFF3_PAYLOADSTORE_P_H
+#define KNEWSTUFF3_PAYLOADSTORE_P_H
+
+#include <QStringList>
+
+#include "knewstuffcore_export.h"
+
+class QDomDocument;
+
+namespace KNSCore
+{
+/**
+ * A store of downloaded payloads, addressed by their content and shared by all configurations
+ * which have it enabled (see the DeduplicatePayloads knsrc key). A payload which is in the store
+ * already does not need downloading again, and files installed from it are made reflinks of,
+ * or hard links to, the copy in the store where the file system allows, so they take up no
+ * extra space.
+ *
+ * The store remembers which installed files came from which payload. Once none of them are
+ * left, the payload is removed from the store. Stored payloads are read-only, so that editing
+ * a hard linked file in place does not change it for everybody.
+ *
+ * Lives in knewstuff3/store in the user's data directory, and may be used by several
+ * processes at the same time.
+ *
+ * @internal
+ */
+class KNEWSTUFFCORE_EXPORT PayloadStore
+{
+public:
+    PayloadStore();
+    explicit PayloadStore(const QString &root);
+
+    QString root() const;
+
+    /**
+     * The payload downloaded from the source for the given version of an entry
+     * @param source Identifies where the payload came from. Download links tend to change
+     * from one request to the next, so this is better made of the entry and file name.
+     * @return The hash of the payload, or an empty string if it is not in the store
+     */
+    QString find(const QString &source, const QString &version) const;
+
+    /**
+     * Move a downloaded file into the store. If the store holds the same content already,
+     * the file is removed instead.
+     * @return The hash of the payload, or an empty string if the file could not be stored
+     */
+    QString add(const QString &file, const QString &source, const QString &version);
+
+    /**
+     * A new file with the content of the payload, which the caller is free to move or remove.
+     * It does not count as a reference to the payload.
+     * @param fileName The name to give the file, so its type can still be told from it
+     * @return The path of the file, or an empty string if that did not work out
+     */
+    QString checkout(const QString &hash, const QString &fileName) const;
+
+    /**
+     * Remember that the files were installed from the payload. Files which were installed
+     * from another payload before (as happens when updating) now refer to this one instead.
+     */
+    void addReferences(const QString &hash, const QStringList &files);
+
+    /**
+     * Forget about the installed files. Payloads which no installed file refers to any longer
+     * are removed from the store.
+     */
+    void release(const QStringList &files);
+
+    /**
+     * How many installed files refer to the payload
+     */
+    int referenceCount(const QString &hash) const;
+
+    /**
+     * Create a file with the content of another one, sharing the data if the file system allows.
+     * Tries a reflink, then a hard link, and then copies the file.
+     */
+    static bool materialize(const QString &source, const QString &target);
+
+private:
+    QString objectPath(const QString &hash) const;
+    bool readIndex(QDomDocument &index) const;
+    bool writeIndex(const QDomDocument &index) const;
+    void removeUnreferenced(QDomDocument &index, const QString &keep) const;
+
+    QString m_root;
+};
+
+}
+
+#endif
@@ -10,6 +10,8 @@
 
 #include "provider.h"
 
+#include "knewstuffcore_debug.h"
+#include "tagsfilterchecker.h"
 #include "xmlloader_p.h"
 
 #include <KLocalizedString>
@@ -18,6 +20,10 @@
 
 namespace KNSCore
 {
+// How many requests to hold the unfiltered results of. Entries are shared with the results handed out,
+// so this mostly costs the entries the filters turned down.
+static const int MAX_RETAINED_REQUESTS{64};
+
 class ProviderPrivate
 {
 public:
@@ -39,6 +45,13 @@ public:
     bool supportsSsl{false};
     bool basicsGot{false};
 
+    // Unfiltered results by request hash, and those hashes from oldest to newest
+    QHash<QString, QPair<Provider::SearchRequest, Entry::List>> retained;
+    QStringList retainedOrder;
+
+    // Prefixes of urls this provider serves, and where else to find what is below them
+    QList<QPair<QString, QString>> mirrors;
+
     void updateOnFirstBasicsGet()
     {
         if (!basicsGot) {
@@ -101,6 +114,93 @@ QStringList Provider::downloadTagFilter() const
     return d->downloadTagFilter;
 }
 
+Entry::List Provider::applyTagFilters(const KNSCore::Entry::List &entries) const
+{
+    const TagsFilterChecker checker(d->tagFilter);
+    const TagsFilterChecker downloadsChecker(d->downloadTagFilter);
+    Entry::List accepted;
+    accepted.reserve(entries.size());
+    for (const Entry &entry : entries) {
+        if (!checker.filterAccepts(entry.tags())) {
+            qCDebug(KNEWSTUFFCORE) << "Filter has excluded" << entry.name() << "on entry filter" << d->tagFilter;
+            continue;
+        }
+        bool filterAcceptsDownloads = true;
+        if (entry.downloadCount() > 0) {
+            filterAcceptsDownloads = false;
+            const auto downloadInfoList = entry.downloadLinkInformationList();
+            for (const Entry::DownloadLinkInformation &dli : downloadInfoList) {
+                if (downloadsChecker.filterAccepts(dli.tags)) {
+                    filterAcceptsDownloads = true;
+                    break;
+                }
+            }
+        }
+        if (filterAcceptsDownloads) {
+            accepted << entry;
+        } else {
+            qCDebug(KNEWSTUFFCORE) << "Filter has excluded" << entry.name() << "on download filter" << d->downloadTagFilter;
+        }
+    }
+    return accepted;
+}
+
+void Provider::retainResults(const KNSCore::Provider::SearchRequest &request, const KNSCore::Entry::List &unfiltered)
+{
+    const QString hash = request.hashForRequest();
+    if (d->retained.contains(hash)) {
+        d->retainedOrder.removeOne(hash);
+    } else if (d->retainedOrder.size() >= MAX_RETAINED_REQUESTS) {
+        d->retained.remove(d->retainedOrder.takeFirst());
+    }
+    d->retained.insert(hash, qMakePair(request, unfiltered));
+    d->retainedOrder << hash;
+}
+
+QList<Provider::SearchRequest> Provider::retainedRequests() const
+{
+    QList<SearchRequest> requests;
+    requests.reserve(d->retainedOrder.size());
+    for (const QString &hash : std::as_const(d->retainedOrder)) {
+        requests << d->retained.value(hash).first;
+    }
+    return requests;
+}
+
+Entry::List Provider::retainedResults(const KNSCore::Provider::SearchRequest &request) const
+{
+    return d->retained.value(request.hashForRequest()).second;
+}
+
+static QString withTrailingSlash(const QUrl &url)
+{
+    QString string = url.toString();
+    if (!string.endsWith(QLatin1Char('/'))) {
+        string += QLatin1Char('/');
+    }
+    return string;
+}
+
+void Provider::addMirror(const QUrl &prefix, const QUrl &mirror)
+{
+    const QPair<QString, QString> pair(withTrailingSlash(prefix), withTrailingSlash(mirror));
+    if (!d->mirrors.contains(pair)) {
+        d->mirrors << pair;
+    }
+}
+
+QList<QUrl> Provider::mirrorsFor(const QUrl &url) const
+{
+    QList<QUrl> urls;
+    const QString urlString = url.toString();
+    for (const auto &[prefix, mirror] : std::as_const(d->mirrors)) {
+        if (urlString.startsWith(prefix)) {
+            urls << QUrl(mirror + urlString.mid(prefix.size()));
+        }
+    }
+    return urls;
+}
+
 QDebug operator<<(QDebug dbg, const Provider::SearchRequest &search)
 {
     QDebugStateSaver saver(dbg);
@@ -110,7 +210,8 @@ QDebug operator<<(QDebug dbg, const Provider::SearchRequest &search)
     dbg << "categories: " << search.categories << ',';
     dbg << "filter: " << search.filter << ',';
     dbg << "page: " << search.page << ',';
-    dbg << "pageSize: " << search.pageSize;
+    dbg << "pageSize: " << search.pageSize << ',';
+    dbg << "deadline: " << search.deadline;
     dbg << ')';
     return dbg;
 }
@@ -75,6 +75,16 @@ public:
         QStringList categories;
         int page;
         int pageSize;
+        /**
+         * How long, in milliseconds, the request may go without any data arriving before it is
+         * considered stalled. Network transfers made on behalf of this request are aborted once
+         * they have not received anything for this long, and ResultsStream gives up on the providers
+         * which have not responded once none of the providers has for this long.
+         * 0 means no deadline, and EngineBase::search() then uses the
+         * deadline of the engine instead, see EngineBase::requestDeadline().
+         * @since 6.0
+         */
+        int deadline = 0;
 
         SearchRequest(SortMode sortMode_ = Newest,
                       Filter filter_ = None,
@@ -193,6 +203,52 @@ public:
     {
     }
     virtual void loadPayloadLink(const Entry &entry, int linkId) = 0;
+    /**
+     * Resolve the payload link for the given entry ahead of time, for example when its details
+     * are shown. Unlike loadPayloadLink() this does not emit payloadLinkLoaded(), and it must not
+     * ask the user anything. Providers which need a round-trip to resolve payload links should hold
+     * on to the result, so a later call to loadPayloadLink() for the same link can be answered
+     * without one.
+     *
+     * The default implementation does nothing.
+     * @since 6.0
+     */
+    virtual void prefetchPayloadLink(const Entry &, int)
+    {
+    }
+    /**
+     * A rough estimate of the memory held by whatever the provider keeps around to save
+     * round-trips, in bytes. The default implementation returns 0.
+     * @see trimMemory()
+     * @since 6.0
+     */
+    virtual qint64 memoryUsage() const
+    {
+        return 0;
+    }
+    /**
+     * Drop whatever the provider keeps around only to save round-trips, for example when
+     * memory is running low. Anything needed to keep track of the state of entries must be kept.
+     *
+     * The default implementation does nothing.
+     * @since 6.0
+     */
+    virtual void trimMemory()
+    {
+    }
+    /**
+     * Whether the entries returned for a request are all there is for it, regardless of
+     * the sort mode and page asked for, so that re-sorting them locally gives the same
+     * result as asking again. This is true of static feeds, but not of services which
+     * page through their results.
+     *
+     * The default implementation returns false.
+     * @since 6.0
+     */
+    virtual bool providesCompleteResults() const
+    {
+        return false;
+    }
     /**
      * Request a loading of comments from this provider. The engine listens to the
      * commentsLoaded() signal for the result
@@ -335,6 +391,36 @@ public:
      */
     QStringList downloadTagFilter() const;
 
+    /**
+     * Apply the tag filter and download tag filter to the entries. Entries with downloads
+     * are only accepted if the download tag filter accepts at least one of their download links.
+     * @return The entries which pass both filters, in the same order
+     * @since 6.0
+     */
+    Entry::List applyTagFilters(const KNSCore::Entry::List &entries) const;
+
+    /**
+     * The requests this provider still holds the unfiltered results of, see retainResults()
+     * @since 6.0
+     */
+    QList<KNSCore::Provider::SearchRequest> retainedRequests() const;
+
+    /**
+     * The results of the request from before the tag filters were applied to them,
+     * or an empty list if they are not held any longer
+     * @since 6.0
+     */
+    Entry::List retainedResults(const KNSCore::Provider::SearchRequest &request) const;
+
+    /**
+     * Other locations serving the same content as the url, as declared by this provider.
+     * Only use these for requests made on behalf of this provider, such as for its own
+     * feeds, and the previews and payloads of its entries.
+     * @see addMirror()
+     * @since 6.0
+     */
+    QList<QUrl> mirrorsFor(const QUrl &url) const;
+
 Q_SIGNALS:
     void providerInitialized(KNSCore::Provider *);
 
@@ -377,6 +463,21 @@ Q_SIGNALS:
 protected:
     void setName(const QString &name);
     void setIcon(const QUrl &icon);
+    /**
+     * Hold on to the results of a request from before the tag filters were applied to them,
+     * so that changes to the filters can be applied without asking for them again.
+     * Only the results of the most recent requests are held.
+     * @since 6.0
+     */
+    void retainResults(const KNSCore::Provider::SearchRequest &request, const KNSCore::Entry::List &unfiltered);
+    /**
+     * Make everything below @p prefix available from @p mirror as well, for requests made on
+     * behalf of this provider. Subclasses are responsible for only accepting prefixes they
+     * are in charge of.
+     * @see mirrorsFor()
+     * @since 6.0
+     */
+    void addMirror(const QUrl &prefix, const QUrl &mirror);
 
 private:
     const std::unique_ptr<ProviderPrivate> d;
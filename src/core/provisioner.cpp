@@ -0,0 +1,328 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include "provisioner.h"
+
+#include "cache.h"
+#include "enginebase.h"
+#include "knewstuffcore_debug.h"
+#include "transaction.h"
+
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QTimer>
+
+using namespace KNSCore;
+
+class KNSCore::ProvisionerPrivate
+{
+public:
+    ProvisionerPrivate(EngineBase *engine)
+        : engine(engine)
+    {
+    }
+    EngineBase *const engine;
+    int maxParallel = 4;
+    QList<Provisioner::ManifestEntry> pending;
+    int active = 0;
+    Provisioner::Statistics statistics;
+    QElapsedTimer timer;
+
+    // Everything which providers with complete results (see Provider::providesCompleteResults()) have, by provider and id
+    QHash<QString, QHash<QString, Entry>> catalogues;
+    // The manifest entries waiting on the catalogue of their provider to load, by provider
+    QHash<QString, QList<Provisioner::ManifestEntry>> waitingForCatalogue;
+};
+
+Provisioner::Provisioner(EngineBase *engine, QObject *parent)
+    : QObject(parent)
+    , d(new ProvisionerPrivate(engine))
+{
+}
+
+Provisioner::~Provisioner() = default;
+
+QByteArray Provisioner::exportManifest(const Entry::List &entries)
+{
+    QDomDocument doc;
+    QDomElement root = doc.createElement(QStringLiteral("provisioning"));
+    doc.appendChild(root);
+    for (const Entry &entry : entries) {
+        if (entry.status() != Entry::Installed && entry.status() != Entry::Updateable) {
+            continue;
+        }
+        QDomElement element = doc.createElement(QStringLiteral("entry"));
+        element.setAttribute(QStringLiteral("provider"), entry.providerId());
+        element.setAttribute(QStringLiteral("id"), entry.uniqueId());
+        element.setAttribute(QStringLiteral("version"), entry.version());
+        // Entries installed before the link was recorded most likely came from the first one
+        element.setAttribute(QStringLiteral("linkid"), entry.installedLinkId() > 0 ? entry.installedLinkId() : 1);
+        root.appendChild(element);
+    }
+    return doc.toByteArray(2);
+}
+
+QList<Provisioner::ManifestEntry> Provisioner::parseManifest(const QByteArray &manifest, bool *ok)
+{
+    QList<ManifestEntry> entries;
+    QDomDocument doc;
+    const bool valid = doc.setContent(manifest) && doc.documentElement().tagName() == QLatin1String("provisioning");
+    if (ok) {
+        *ok = valid;
+    }
+    if (!valid) {
+        return entries;
+    }
+    const QDomElement root = doc.documentElement();
+    for (QDomElement element = root.firstChildElement(QStringLiteral("entry")); !element.isNull();
+         element = element.nextSiblingElement(QStringLiteral("entry"))) {
+        ManifestEntry entry;
+        entry.providerId = element.attribute(QStringLiteral("provider"));
+        entry.uniqueId = element.attribute(QStringLiteral("id"));
+        entry.version = element.attribute(QStringLiteral("version"));
+        entry.linkId = element.attribute(QStringLiteral("linkid"), QStringLiteral("1")).toInt();
+        if (entry.uniqueId.isEmpty()) {
+            qCWarning(KNEWSTUFFCORE) << "Skipping manifest entry without an id";
+            continue;
+        }
+        entries << entry;
+    }
+    return entries;
+}
+
+void Provisioner::setMaxParallel(int maxParallel)
+{
+    d->maxParallel = qMax(1, maxParallel);
+}
+
+int Provisioner::maxParallel() const
+{
+    return d->maxParallel;
+}
+
+Provisioner::Statistics Provisioner::statistics() const
+{
+    Statistics statistics = d->statistics;
+    if (d->timer.isValid() && (d->active > 0 || !d->pending.isEmpty())) {
+        statistics.elapsed = d->timer.elapsed();
+    }
+    return statistics;
+}
+
+void Provisioner::install(const QList<KNSCore::Provisioner::ManifestEntry> &entries)
+{
+    d->pending << entries;
+    if (d->active == 0) {
+        d->statistics = Statistics();
+        d->timer.start();
+    }
+    startNext();
+}
+
+void Provisioner::startNext()
+{
+    // Looking entries up and installing them overlap, so keep a few going at the same time
+    while (d->active < d->maxParallel && !d->pending.isEmpty()) {
+        ++d->active;
+        resolve(d->pending.takeFirst());
+    }
+    if (d->active == 0 && d->pending.isEmpty()) {
+        d->statistics.elapsed = d->timer.elapsed();
+        const qint64 seconds = qMax<qint64>(1, d->statistics.elapsed / 1000);
+        qCDebug(KNEWSTUFFCORE) << "Provisioning done in" << d->statistics.elapsed << "ms:" << d->statistics.installed << "installed," << d->statistics.skipped
+                               << "skipped," << d->statistics.failed << "failed," << d->statistics.downloadSize / seconds << "KiB/s";
+        Q_EMIT finished();
+    }
+}
+
+void Provisioner::resolve(const KNSCore::Provisioner::ManifestEntry &manifestEntry)
+{
+    const QSharedPointer<Cache> cache = d->engine->cache();
+    if (cache) {
+        const Entry::List installed = cache->registryForProvider(manifestEntry.providerId);
+        const EntryKey key = entryKey(manifestEntry.providerId, manifestEntry.uniqueId);
+        for (const Entry &entry : installed) {
+            if (entry.key() == key && entry.status() == Entry::Installed && (manifestEntry.version.isEmpty() || entry.version() == manifestEntry.version)) {
+                ++d->statistics.skipped;
+                // Not straight away, as we are still in the middle of startNext()
+                QTimer::singleShot(0, this, [this, manifestEntry]() {
+                    entryDone(manifestEntry, true);
+                });
+                return;
+            }
+        }
+    }
+
+    QSharedPointer<Provider> provider = d->engine->provider(manifestEntry.providerId);
+    if (!provider && manifestEntry.providerId.isEmpty()) {
+        // Manifests written by hand may leave the provider out, which is fine as long as there is no doubt about it
+        const QStringList providerIds = d->engine->providerIDs();
+        if (providerIds.count() == 1) {
+            provider = d->engine->provider(providerIds.constFirst());
+        }
+    }
+    if (!provider) {
+        qCWarning(KNEWSTUFFCORE) << "Could not find the provider" << manifestEntry.providerId << "of" << manifestEntry.uniqueId;
+        notFound(manifestEntry);
+        return;
+    }
+
+    if (!provider->providesCompleteResults()) {
+        loadEntryDetails(provider, manifestEntry);
+        return;
+    }
+    // Everything the provider has comes in one go, so that is asked for once and the ids are looked up in there
+    const auto catalogue = d->catalogues.constFind(provider->id());
+    if (catalogue != d->catalogues.constEnd()) {
+        found(manifestEntry, catalogue->value(manifestEntry.uniqueId));
+        return;
+    }
+    QList<ManifestEntry> &waiting = d->waitingForCatalogue[provider->id()];
+    waiting << manifestEntry;
+    if (waiting.count() == 1) {
+        loadCatalogue(provider);
+    }
+}
+
+void Provisioner::loadCatalogue(const QSharedPointer<KNSCore::Provider> &provider)
+{
+    Provider::SearchRequest request(Provider::Alphabetical, Provider::None, QString(), {}, 0);
+    request.deadline = d->engine->requestDeadline();
+    const QString providerId = provider->id();
+    auto connections = QSharedPointer<QList<QMetaObject::Connection>>::create();
+    const auto loaded = [this, providerId, connections](const KNSCore::Entry::List &entries, bool success) {
+        for (const QMetaObject::Connection &connection : std::as_const(*connections)) {
+            disconnect(connection);
+        }
+        const QList<ManifestEntry> waiting = d->waitingForCatalogue.take(providerId);
+        if (!success) {
+            // Not remembered, so the entries of the provider still to come ask for it again
+            qCWarning(KNEWSTUFFCORE) << "Could not load the entries of" << providerId;
+            for (const ManifestEntry &manifestEntry : waiting) {
+                notFound(manifestEntry);
+            }
+            return;
+        }
+        QHash<QString, Entry> &catalogue = d->catalogues[providerId];
+        for (const Entry &entry : entries) {
+            catalogue.insert(entry.uniqueId(), entry);
+        }
+        for (const ManifestEntry &manifestEntry : waiting) {
+            found(manifestEntry, catalogue.value(manifestEntry.uniqueId));
+        }
+    };
+    *connections << connect(provider.data(),
+                            &Provider::loadingFinished,
+                            this,
+                            [request, loaded](const KNSCore::Provider::SearchRequest &finishedRequest, const KNSCore::Entry::List &entries) {
+                                if (finishedRequest == request) {
+                                    loaded(entries, true);
+                                }
+                            });
+    *connections << connect(provider.data(), &Provider::loadingFailed, this, [request, loaded](const KNSCore::Provider::SearchRequest &failedRequest) {
+        if (failedRequest == request) {
+            loaded({}, false);
+        }
+    });
+    provider->loadEntries(request);
+}
+
+void Provisioner::loadEntryDetails(const QSharedPointer<KNSCore::Provider> &provider, const KNSCore::Provisioner::ManifestEntry &manifestEntry)
+{
+    // Providers which page through what they have are asked about just this one entry
+    Entry entry;
+    entry.setProviderId(provider->id());
+    entry.setUniqueId(manifestEntry.uniqueId);
+    auto done = QSharedPointer<bool>::create(false);
+    auto connection = QSharedPointer<QMetaObject::Connection>::create();
+    const EntryKey key = entry.key();
+    *connection = connect(provider.data(), &Provider::entryDetailsLoaded, this, [this, manifestEntry, key, done, connection](const KNSCore::Entry &details) {
+        if (!*done && details.key() == key) {
+            *done = true;
+            disconnect(*connection);
+            found(manifestEntry, details);
+        }
+    });
+    // Failing to load the details is not reported back as such, so only wait for so long
+    const int deadline = d->engine->requestDeadline();
+    if (deadline > 0) {
+        QTimer::singleShot(deadline, this, [this, manifestEntry, done, connection]() {
+            if (!*done) {
+                *done = true;
+                disconnect(*connection);
+                found(manifestEntry, Entry());
+            }
+        });
+    }
+    provider->loadEntryDetails(entry);
+}
+
+void Provisioner::found(const KNSCore::Provisioner::ManifestEntry &manifestEntry, const KNSCore::Entry &entry)
+{
+    if (entry.uniqueId().isEmpty()) {
+        qCWarning(KNEWSTUFFCORE) << "Could not find" << manifestEntry.uniqueId << "on" << manifestEntry.providerId;
+        notFound(manifestEntry);
+    } else {
+        installEntry(manifestEntry, entry);
+    }
+}
+
+void Provisioner::notFound(const KNSCore::Provisioner::ManifestEntry &manifestEntry)
+{
+    ++d->statistics.failed;
+    // Not straight away, as we may still be in the middle of startNext()
+    QTimer::singleShot(0, this, [this, manifestEntry]() {
+        entryDone(manifestEntry, false);
+    });
+}
+
+void Provisioner::installEntry(const KNSCore::Provisioner::ManifestEntry &manifestEntry, const KNSCore::Entry &entry)
+{
+    if (!manifestEntry.version.isEmpty() && entry.version() != manifestEntry.version) {
+        qCDebug(KNEWSTUFFCORE) << "Manifest asks for version" << manifestEntry.version << "of" << entry.uniqueId() << ", installing" << entry.version();
+    }
+    quint64 size = 0;
+    const auto links = entry.downloadLinkInformationList();
+    for (const Entry::DownloadLinkInformation &link : links) {
+        if (link.id == manifestEntry.linkId) {
+            size = link.size;
+        }
+    }
+
+    Transaction *transaction = Transaction::install(d->engine, entry, manifestEntry.linkId);
+    auto failed = QSharedPointer<bool>::create(false);
+    auto installed = QSharedPointer<bool>::create(false);
+    connect(transaction, &Transaction::signalErrorCode, this, [failed](KNSCore::ErrorCode, const QString &message) {
+        qCWarning(KNEWSTUFFCORE) << "Provisioning failed:" << message;
+        *failed = true;
+    });
+    // The transaction tells about all the entries which change while it is underway, not just its own
+    const EntryKey key = entry.key();
+    connect(transaction, &Transaction::signalEntryEvent, this, [installed, key](const KNSCore::Entry &changedEntry, KNSCore::Entry::EntryEvent event) {
+        if (event == Entry::StatusChangedEvent && changedEntry.key() == key) {
+            *installed = changedEntry.status() == Entry::Installed;
+        }
+    });
+    connect(transaction, &Transaction::finished, this, [this, manifestEntry, failed, installed, size]() {
+        const bool success = !*failed && *installed;
+        if (success) {
+            ++d->statistics.installed;
+            d->statistics.downloadSize += size;
+        } else {
+            ++d->statistics.failed;
+        }
+        entryDone(manifestEntry, success);
+    });
+}
+
+void Provisioner::entryDone(const KNSCore::Provisioner::ManifestEntry &manifestEntry, bool success)
+{
+    --d->active;
+    Q_EMIT entryFinished(manifestEntry, success);
+    startNext();
+}
+
+#include "moc_provisioner.cpp"
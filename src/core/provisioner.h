@@ -0,0 +1,125 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KNEWSTUFF3_PROVISIONER_H
+#define KNEWSTUFF3_PROVISIONER_H
+
+#include <QObject>
+
+#include "entry.h"
+#include "provider.h"
+
+#include "knewstuffcore_export.h"
+
+#include <memory>
+
+namespace KNSCore
+{
+class EngineBase;
+class ProvisionerPrivate;
+
+/**
+ * Installs a whole set of entries in one go, as described by a manifest.
+ *
+ * A manifest lists entries by provider, id, version and download link, and is usually
+ * exported from a machine which already has everything installed:
+ *
+ * @code
+ * const QByteArray manifest = KNSCore::Provisioner::exportManifest(engine->cache()->registry());
+ * @endcode
+ *
+ * On the machines to provision, the manifest is handed to a Provisioner, which looks up
+ * the entries and installs them, several at a time. Providers which list everything they
+ * have in one go are asked for that just once, others are asked about each entry in turn. Entries which are already installed
+ * in the version listed are skipped. Providers only offer the current version of an entry,
+ * so if that is newer than the one in the manifest, the newer one is installed.
+ *
+ * The payloads come from the providers of the engine, so to provision many machines from
+ * a shared source, point the knsrc file at a mirror (see MirrorBuilder).
+ *
+ * @since 6.0
+ */
+class KNEWSTUFFCORE_EXPORT Provisioner : public QObject
+{
+    Q_OBJECT
+public:
+    struct ManifestEntry {
+        QString providerId;
+        QString uniqueId;
+        QString version;
+        int linkId = 1;
+    };
+
+    struct Statistics {
+        int installed = 0;
+        int skipped = 0; ///< Entries which were already installed
+        int failed = 0;
+        qint64 elapsed = 0; ///< Time taken in milliseconds
+        quint64 downloadSize = 0; ///< Size of the downloaded payloads in kilobytes, where the provider tells us
+    };
+
+    explicit Provisioner(EngineBase *engine, QObject *parent = nullptr);
+    ~Provisioner() override;
+
+    /**
+     * A manifest of the installed (or updateable) entries amongst the given ones
+     */
+    static QByteArray exportManifest(const Entry::List &entries);
+
+    /**
+     * Read a manifest as written by exportManifest()
+     * @param ok Set to whether the manifest could be read
+     */
+    static QList<ManifestEntry> parseManifest(const QByteArray &manifest, bool *ok = nullptr);
+
+    /**
+     * How many entries are looked up and installed at the same time (4 by default)
+     */
+    void setMaxParallel(int maxParallel);
+    int maxParallel() const;
+
+    /**
+     * Install the given entries. Progress is reported through entryFinished(), and
+     * finished() is emitted once all of them are done.
+     *
+     * The entries are looked up on the providers of the engine, so those need to have
+     * been loaded already (see EngineBase::signalProvidersLoaded()).
+     */
+    void install(const QList<KNSCore::Provisioner::ManifestEntry> &entries);
+
+    /**
+     * The statistics of the current (or most recent) run
+     */
+    Statistics statistics() const;
+
+    /**
+     * Emitted for every entry in the manifest once it has been dealt with
+     * @param entry The manifest entry
+     * @param success Whether the entry is now installed (including having been installed already)
+     */
+    Q_SIGNAL void entryFinished(const KNSCore::Provisioner::ManifestEntry &entry, bool success);
+
+    /**
+     * Emitted once all the entries have been dealt with
+     */
+    Q_SIGNAL void finished();
+
+private:
+    void startNext();
+    void resolve(const KNSCore::Provisioner::ManifestEntry &manifestEntry);
+    void loadCatalogue(const QSharedPointer<KNSCore::Provider> &provider);
+    void loadEntryDetails(const QSharedPointer<KNSCore::Provider> &provider, const KNSCore::Provisioner::ManifestEntry &manifestEntry);
+    void found(const KNSCore::Provisioner::ManifestEntry &manifestEntry, const KNSCore::Entry &entry);
+    void notFound(const KNSCore::Provisioner::ManifestEntry &manifestEntry);
+    void installEntry(const KNSCore::Provisioner::ManifestEntry &manifestEntry, const KNSCore::Entry &entry);
+    void entryDone(const KNSCore::Provisioner::ManifestEntry &manifestEntry, bool success);
+
+    const std::unique_ptr<ProvisionerPrivate> d;
+};
+
+}
+
+#endif
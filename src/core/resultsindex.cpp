@@ -0,0 +1,141 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include "resultsindex_p.h"
+
+#include <QCollator>
+
+#include <algorithm>
+
+using namespace KNSCore;
+
+// Shared, as creating a collator means loading the collation rules of the locale
+static const QCollator &nameCollator()
+{
+    static const QCollator collator = []() {
+        QCollator collator;
+        collator.setCaseSensitivity(Qt::CaseInsensitive);
+        collator.setNumericMode(true);
+        return collator;
+    }();
+    return collator;
+}
+
+void ResultsIndex::clear()
+{
+    m_entries.clear();
+    m_rows.clear();
+    m_categoryIds.clear();
+    m_nameKeys.clear();
+    m_ratings.clear();
+    m_downloads.clear();
+    m_dates.clear();
+    m_categories.clear();
+    m_status.clear();
+}
+
+int ResultsIndex::categoryId(const QString &category)
+{
+    auto id = m_categoryIds.constFind(category);
+    if (id == m_categoryIds.constEnd()) {
+        id = m_categoryIds.insert(category, m_categoryIds.count());
+    }
+    return *id;
+}
+
+void ResultsIndex::add(const KNSCore::Entry::List &entries)
+{
+    const QCollator &collator = nameCollator();
+    for (const Entry &entry : entries) {
+        if (update(entry)) {
+            continue;
+        }
+        m_rows.insert(entry.key(), m_entries.count());
+        m_entries << entry;
+        m_nameKeys.push_back(collator.sortKey(entry.name()));
+        m_ratings.push_back(entry.rating());
+        m_downloads.push_back(entry.downloadCount());
+        m_dates.push_back(entry.releaseDate().toJulianDay());
+        m_categories.push_back(categoryId(entry.category()));
+        m_status.push_back(quint8(entry.status()));
+    }
+}
+
+bool ResultsIndex::update(const KNSCore::Entry &entry)
+{
+    const auto row = m_rows.constFind(entry.key());
+    if (row == m_rows.constEnd()) {
+        return false;
+    }
+    const int i = *row;
+    m_entries[i] = entry;
+    m_nameKeys[i] = nameCollator().sortKey(entry.name());
+    m_ratings[i] = entry.rating();
+    m_downloads[i] = entry.downloadCount();
+    m_dates[i] = entry.releaseDate().toJulianDay();
+    m_categories[i] = categoryId(entry.category());
+    m_status[i] = quint8(entry.status());
+    return true;
+}
+
+int ResultsIndex::count() const
+{
+    return m_entries.count();
+}
+
+KNSCore::Entry::List ResultsIndex::query(KNSCore::Provider::Filter filter, const QStringList &categories, KNSCore::Provider::SortMode sortMode) const
+{
+    if (filter != Provider::None && filter != Provider::Updates) {
+        return {};
+    }
+
+    // Which category ids are wanted, looked up once rather than for every entry
+    std::vector<bool> wantedCategories(m_categoryIds.count(), categories.isEmpty());
+    for (const QString &category : categories) {
+        const auto id = m_categoryIds.constFind(category);
+        if (id != m_categoryIds.constEnd()) {
+            wantedCategories[*id] = true;
+        }
+    }
+
+    std::vector<int> rows;
+    rows.reserve(m_entries.count());
+    const quint8 updateable = quint8(Entry::Updateable);
+    for (int i = 0; i < int(m_status.size()); ++i) {
+        if (wantedCategories[m_categories[i]] && (filter != Provider::Updates || m_status[i] == updateable)) {
+            rows.push_back(i);
+        }
+    }
+
+    const auto sortDescending = [&rows](const auto &column) {
+        std::stable_sort(rows.begin(), rows.end(), [&column](int a, int b) {
+            return column[a] > column[b];
+        });
+    };
+    switch (sortMode) {
+    case Provider::Newest:
+        sortDescending(m_dates);
+        break;
+    case Provider::Rating:
+        sortDescending(m_ratings);
+        break;
+    case Provider::Downloads:
+        sortDescending(m_downloads);
+        break;
+    case Provider::Alphabetical:
+        std::stable_sort(rows.begin(), rows.end(), [this](int a, int b) {
+            return m_nameKeys[a].compare(m_nameKeys[b]) < 0;
+        });
+        break;
+    }
+
+    Entry::List result;
+    result.reserve(rows.size());
+    for (int row : rows) {
+        result << m_entries.at(row);
+    }
+    return result;
+}
@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KNEWSTUFF3_RESULTSINDEX_P_H
+#define KNEWSTUFF3_RESULTSINDEX_P_H
+
+#include <QCollatorSortKey>
+#include <QHash>
+
+#include "entry.h"
+#include "provider.h"
+
+#include "knewstuffcore_export.h"
+
+#include <vector>
+
+namespace KNSCore
+{
+/**
+ * The entries of a set of results, with the fields they are sorted and filtered by kept
+ * in columns of their own. This allows re-sorting and narrowing down results which are
+ * already loaded without going back to the providers, and without touching the entries
+ * themselves (which, being shared, are comparatively expensive to get at).
+ *
+ * @internal
+ */
+class KNEWSTUFFCORE_EXPORT ResultsIndex
+{
+public:
+    void clear();
+
+    /**
+     * Add entries to the index, in the order the providers returned them. Entries which are
+     * already in the index are updated.
+     */
+    void add(const KNSCore::Entry::List &entries);
+
+    /**
+     * Update an entry which is already in the index, for example after its status changed
+     * @return Whether the entry is in the index
+     */
+    bool update(const KNSCore::Entry &entry);
+
+    int count() const;
+
+    /**
+     * The entries matching the given filter and categories, in the given order. Entries which
+     * compare equal are kept in the order they were added.
+     * @param filter Only None and Updates can be answered from the index, anything else returns nothing
+     * @param categories The categories to include, or all of them if empty
+     */
+    KNSCore::Entry::List query(KNSCore::Provider::Filter filter, const QStringList &categories, KNSCore::Provider::SortMode sortMode) const;
+
+private:
+    int categoryId(const QString &category);
+
+    Entry::List m_entries;
+    QHash<EntryKey, int> m_rows;
+    QHash<QString, int> m_categoryIds;
+
+    // One value per entry, in the order of m_entries
+    std::vector<QCollatorSortKey> m_nameKeys;
+    std::vector<int> m_ratings;
+    std::vector<int> m_downloads;
+    std::vector<qint64> m_dates;
+    std::vector<int> m_categories;
+    std::vector<quint8> m_status;
+};
+
+}
+
+#endif
@@ -8,14 +8,41 @@
 #include "enginebase_p.h"
 #include "knewstuffcore_debug.h"
 
+#include <QTimer>
+
+#include <algorithm>
+
 using namespace KNSCore;
 
 class KNSCore::ResultsStreamPrivate
 {
 public:
+    enum ProviderState {
+        Loading, // Waiting for the provider to respond to the current page
+        PageLoaded, // The provider returned entries for the current page, there may be more
+        Exhausted, // The provider returned an empty page, so there is nothing more to get from it
+        Failed,
+        TimedOut, // The provider did not respond before the deadline
+    };
+
     QList<QSharedPointer<KNSCore::Provider>> providers;
+    QHash<const Provider *, ProviderState> providerStates;
     EngineBase *engine;
     Provider::SearchRequest request;
+    QTimer deadlineTimer;
+    bool finished = false;
+    bool localResultsSent = false;
+    // Entries found locally which none of the providers turned up (yet)
+    QHash<EntryKey, Entry> localOnlyEntries;
+    // While asking the providers, some of which may respond right away, before the others were asked
+    bool fetching = false;
+
+    bool hasProviderIn(ProviderState state) const
+    {
+        return std::any_of(providerStates.cbegin(), providerStates.cend(), [state](ProviderState providerState) {
+            return providerState == state;
+        });
+    }
 };
 
 ResultsStream::ResultsStream(const Provider::SearchRequest &request, EngineBase *base)
@@ -24,30 +51,46 @@ ResultsStream::ResultsStream(const Provider::SearchRequest &request, EngineBase
     d->engine = base;
     d->request = request;
     d->providers = base->d->providers.values();
-    auto finished = [this](const KNSCore::Provider::SearchRequest &request, const KNSCore::Entry::List &entries) {
-        d->providers.removeAll(static_cast<Provider *>(sender()));
-        if (entries.isEmpty() && d->providers.isEmpty()) {
-            finish();
-        }
-
-        if (request == d->request) {
-            Q_EMIT entriesFound(entries);
-        }
-    };
-    auto failed = [this](const KNSCore::Provider::SearchRequest &request) {
-        if (request == d->request) {
-            finish();
-        }
-    };
-    for (const auto &provider : d->providers) {
-        connect(provider.data(), &Provider::loadingFinished, this, finished);
-        connect(provider.data(), &Provider::entryDetailsLoaded, this, [this](const KNSCore::Entry &entry) {
+    d->deadlineTimer.setSingleShot(true);
+    connect(&d->deadlineTimer, &QTimer::timeout, this, &ResultsStream::handleDeadline);
+    for (const auto &provider : std::as_const(d->providers)) {
+        const Provider *p = provider.data();
+        d->providerStates.insert(p, ResultsStreamPrivate::PageLoaded);
+        connect(p, &Provider::loadingFinished, this, [this, p](const KNSCore::Provider::SearchRequest &request, const KNSCore::Entry::List &entries) {
+            if (!(request == d->request)) {
+                return;
+            }
+            const ResultsStreamPrivate::ProviderState previousState = d->providerStates.value(p);
+            d->providerStates[p] = entries.isEmpty() ? ResultsStreamPrivate::Exhausted : ResultsStreamPrivate::PageLoaded;
+            if (previousState == ResultsStreamPrivate::TimedOut) {
+                qCDebug(KNEWSTUFFCORE) << "Provider" << p->id() << "responded after the deadline with" << entries.count() << "entries";
+            }
+            for (const Entry &entry : entries) {
+                d->localOnlyEntries.remove(entry.key());
+            }
+            if (!entries.isEmpty() || !d->finished) {
+                Q_EMIT entriesFound(entries);
+            }
+            if (!d->finished && d->request.deadline > 0) {
+                // The request is still making progress, so the others get as long again
+                d->deadlineTimer.start(d->request.deadline);
+            }
+            checkFinished();
+        });
+        connect(p, &Provider::entryDetailsLoaded, this, [this](const KNSCore::Entry &entry) {
             if (d->request.filter == KNSCore::Provider::ExactEntryId && d->request.searchTerm == entry.uniqueId()) {
                 Q_EMIT entriesFound({entry});
                 finish();
             }
         });
-        connect(provider.data(), &Provider::loadingFailed, this, failed);
+        connect(p, &Provider::loadingFailed, this, [this, p](const KNSCore::Provider::SearchRequest &request) {
+            if (request == d->request) {
+                d->providerStates[p] = ResultsStreamPrivate::Failed;
+                // What we found locally may well be all there is to go by, so it stays
+                d->localOnlyEntries.clear();
+                checkFinished();
+            }
+        });
     }
 }
 
@@ -55,25 +98,66 @@ ResultsStream::~ResultsStream() = default;
 
 void ResultsStream::fetch()
 {
+    if (!d->localResultsSent && d->request.filter == Provider::None && !d->request.searchTerm.isEmpty()) {
+        // What we already know about goes first, the providers may well take a while
+        d->localResultsSent = true;
+        const Entry::List localEntries = d->engine->searchLocally(d->request);
+        if (!localEntries.isEmpty()) {
+            qCDebug(KNEWSTUFFCORE) << "Found" << localEntries.count() << "entries locally for" << d->request.searchTerm;
+            for (const Entry &entry : localEntries) {
+                d->localOnlyEntries.insert(entry.key(), entry);
+            }
+            Q_EMIT entriesFound(localEntries);
+        }
+    }
+
     if (d->request.filter != Provider::Installed) {
         // when asking for installed entries, never use the cache
         Entry::List cacheEntries = d->engine->cache()->requestFromCache(d->request);
         if (!cacheEntries.isEmpty()) {
+            for (const Entry &entry : std::as_const(cacheEntries)) {
+                d->localOnlyEntries.remove(entry.key());
+            }
             Q_EMIT entriesFound(cacheEntries);
+            removeLocalOnlyEntries();
+            if (d->engine->isOffline()) {
+                // There is nobody to ask for more than this
+                finish();
+            }
             return;
         }
     }
 
+    d->fetching = true;
     for (const QSharedPointer<KNSCore::Provider> &p : std::as_const(d->providers)) {
+        ResultsStreamPrivate::ProviderState &state = d->providerStates[p.data()];
+        if (state == ResultsStreamPrivate::Exhausted || state == ResultsStreamPrivate::Failed) {
+            // Nothing more to ask this one for
+            continue;
+        }
         if (p->isInitialized()) {
+            state = ResultsStreamPrivate::Loading;
             p->loadEntries(d->request);
+        } else if (d->engine->isOffline()) {
+            // It would only be initialized once the network comes back, so do not wait for it
+            qCDebug(KNEWSTUFFCORE) << "Offline, skipping the uninitialized provider" << p->id();
+            state = ResultsStreamPrivate::Failed;
+            d->localOnlyEntries.clear();
         } else {
+            state = ResultsStreamPrivate::Loading;
             connect(p.get(), &KNSCore::Provider::providerInitialized, this, [this, p] {
                 disconnect(p.get(), &KNSCore::Provider::providerInitialized, this, nullptr);
                 p->loadEntries(d->request);
             });
         }
     }
+    d->fetching = false;
+
+    if (d->request.deadline > 0 && d->hasProviderIn(ResultsStreamPrivate::Loading)) {
+        d->deadlineTimer.start(d->request.deadline);
+    } else {
+        checkFinished();
+    }
 }
 
 void ResultsStream::fetchMore()
@@ -82,10 +166,81 @@ void ResultsStream::fetchMore()
     fetch();
 }
 
+QStringList ResultsStream::timedOutProviders() const
+{
+    QStringList ids;
+    for (const auto &provider : std::as_const(d->providers)) {
+        if (d->providerStates.value(provider.data()) == ResultsStreamPrivate::TimedOut) {
+            ids << provider->id();
+        }
+    }
+    return ids;
+}
+
+void ResultsStream::checkFinished()
+{
+    if (d->finished) {
+        // Waiting for stragglers only, we are done once none are left
+        if (!d->hasProviderIn(ResultsStreamPrivate::TimedOut)) {
+            deleteLater();
+        }
+        return;
+    }
+    if (d->hasProviderIn(ResultsStreamPrivate::Loading)) {
+        return;
+    }
+    if (!d->fetching) {
+        removeLocalOnlyEntries();
+    }
+    d->deadlineTimer.stop();
+    // A provider which returned entries for this page may well have more, so we only
+    // finish once everybody has run out of entries (or gave up)
+    if (!d->hasProviderIn(ResultsStreamPrivate::PageLoaded)) {
+        finish();
+    }
+}
+
+void ResultsStream::handleDeadline()
+{
+    if (d->finished) {
+        // The grace period for late results is over as well
+        deleteLater();
+        return;
+    }
+    for (auto it = d->providerStates.begin(); it != d->providerStates.end(); ++it) {
+        if (it.value() == ResultsStreamPrivate::Loading) {
+            it.value() = ResultsStreamPrivate::TimedOut;
+        }
+    }
+    qCDebug(KNEWSTUFFCORE) << "Deadline passed for" << d->request << "without a response from" << timedOutProviders();
+    // Those which did not respond may still have them
+    d->localOnlyEntries.clear();
+    finish();
+}
+
+void ResultsStream::removeLocalOnlyEntries()
+{
+    if (!d->localOnlyEntries.isEmpty()) {
+        qCDebug(KNEWSTUFFCORE) << "None of the providers had" << d->localOnlyEntries.count() << "of the entries found locally";
+        const Entry::List entries = d->localOnlyEntries.values();
+        d->localOnlyEntries.clear();
+        Q_EMIT entriesRemoved(entries);
+    }
+}
+
 void ResultsStream::finish()
 {
+    if (d->finished) {
+        return;
+    }
+    d->finished = true;
     Q_EMIT finished();
-    deleteLater();
+    if (d->hasProviderIn(ResultsStreamPrivate::TimedOut)) {
+        // Stick around for a while, so late results can still be delivered
+        d->deadlineTimer.start(d->request.deadline);
+    } else {
+        deleteLater();
+    }
 }
 
 #include "moc_resultsstream.cpp"
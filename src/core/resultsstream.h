@@ -27,6 +27,15 @@ class ResultsStreamPrivate;
  * Once we have reached the end of the requested stream, the object shall emit
  * @m finished and delete itself.
  *
+ * If the request has a deadline, the stream finishes with the results at hand once none of the
+ * providers has responded for that long, and timedOutProviders() lists those which had not responded.
+ * Results those providers deliver later on are still emitted through @m entriesFound,
+ * and the stream deletes itself once they all responded, or a further deadline has passed.
+ *
+ * When searching for a term, the entries matching it locally (see Cache::search()) are emitted
+ * first. The same entries may then come along again from the providers. Those which none of
+ * the providers turn up are taken back through @m entriesRemoved once they have all responded.
+ *
  * @since 6.0
  */
 class KNEWSTUFFCORE_EXPORT ResultsStream : public QObject
@@ -41,14 +50,29 @@ public:
     /// Increments the requested page and issues another search
     void fetchMore();
 
+    /**
+     * The IDs of the providers which had not responded by the time the deadline
+     * of the request passed.
+     * @see Provider::SearchRequest::deadline
+     */
+    QStringList timedOutProviders() const;
+
 Q_SIGNALS:
     void entriesFound(const KNSCore::Entry::List &entries);
+    /**
+     * Entries found locally, which turned out not to be amongst the results of the providers
+     * after all, and should not be shown anymore
+     */
+    void entriesRemoved(const KNSCore::Entry::List &entries);
     void finished();
 
 private:
     friend class EngineBase;
     ResultsStream(const Provider::SearchRequest &request, EngineBase *base);
     void finish();
+    void checkFinished();
+    void handleDeadline();
+    void removeLocalOnlyEntries();
 
     std::unique_ptr<ResultsStreamPrivate> d;
 };
@@ -37,13 +37,20 @@ public:
         q->deleteLater();
     }
 
+    // Only the provider an entry came from gets to say where else its payload can be found
+    void install(const KNSCore::Entry &entry)
+    {
+        const QSharedPointer<Provider> provider = m_engine->provider(entry.providerId());
+        m_engine->d->installation->install(entry, provider ? provider->mirrorsFor(QUrl(entry.payload())) : QList<QUrl>());
+    }
+
     EngineBase *const m_engine;
     Transaction *const q;
     bool m_finished = false;
     // Used for updating purposes - we ought to be saving this information, but we also have to deal with old stuff, and so... this will have to do for now
     // TODO KF6: Installed state needs to move onto a per-downloadlink basis rather than per-entry
-    QMap<Entry, QStringList> payloads;
-    QMap<Entry, QString> payloadToIdentify;
+    QHash<EntryKey, QStringList> payloads;
+    QHash<EntryKey, QString> payloadToIdentify;
     const Entry subject;
 };
 
@@ -174,22 +181,24 @@ Transaction *Transaction::install(EngineBase *engine, const KNSCore::Entry &_ent
                         // If there is only one downloadable item (which also includes a predefined payload name), then we can fairly safely assume that's what
                         // we're wanting to update, meaning we can bypass some of the more expensive operations in downloadLinkLoaded
                         qCDebug(KNEWSTUFFCORE) << "Just the one download link, so let's use that";
-                        ret->d->payloadToIdentify[entry] = QString{};
+                        ret->d->payloadToIdentify[entry.key()] = QString{};
                         linkId = 1;
                     } else {
                         qCDebug(KNEWSTUFFCORE) << "Try and identify a download link to use from a total of" << entry.downloadLinkCount();
                         // While this seems silly, the payload gets reset when fetching the new download link information
-                        ret->d->payloadToIdentify[entry] = entry.payload();
+                        ret->d->payloadToIdentify[entry.key()] = entry.payload();
                         // Drop a fresh list in place so we've got something to work with when we get the links
-                        ret->d->payloads[entry] = QStringList{};
+                        ret->d->payloads[entry.key()] = QStringList{};
                         linkId = 1;
                     }
                 } else {
                     qCDebug(KNEWSTUFFCORE) << "Link ID already known" << linkId;
                     // If there is no payload to identify, we will assume the payload is already known and just use that
-                    ret->d->payloadToIdentify[entry] = QString{};
+                    ret->d->payloadToIdentify[entry.key()] = QString{};
                 }
 
+                // Remembered in the registry, so the same link can be picked again later on (see Provisioner::exportManifest())
+                entry.setInstalledLinkId(linkId);
                 p->loadPayloadLink(entry, linkId);
 
                 ret->d->m_finished = false;
@@ -202,19 +211,23 @@ Transaction *Transaction::install(EngineBase *engine, const KNSCore::Entry &_ent
 
 void Transaction::downloadLinkLoaded(const KNSCore::Entry &entry)
 {
+    if (entry.key() != d->subject.key()) {
+        // The provider tells everybody about every link, and other transactions may well be going on at the same time
+        return;
+    }
     if (entry.status() == KNSCore::Entry::Updating) {
-        if (d->payloadToIdentify[entry].isEmpty()) {
+        if (d->payloadToIdentify[entry.key()].isEmpty()) {
             // If there's nothing to identify, and we've arrived here, then we know what the payload is
             qCDebug(KNEWSTUFFCORE) << "If there's nothing to identify, and we've arrived here, then we know what the payload is";
-            d->m_engine->d->installation->install(entry);
-            d->payloadToIdentify.remove(entry);
+            d->install(entry);
+            d->payloadToIdentify.remove(entry.key());
             d->finish();
-        } else if (d->payloads[entry].count() < entry.downloadLinkCount()) {
+        } else if (d->payloads[entry.key()].count() < entry.downloadLinkCount()) {
             // We've got more to get before we can attempt to identify anything, so fetch the next one...
             qCDebug(KNEWSTUFFCORE) << "We've got more to get before we can attempt to identify anything, so fetch the next one...";
-            QStringList payloads = d->payloads[entry];
+            QStringList payloads = d->payloads[entry.key()];
             payloads << entry.payload();
-            d->payloads[entry] = payloads;
+            d->payloads[entry.key()] = payloads;
             QSharedPointer<Provider> p = d->m_engine->d->providers.value(entry.providerId());
             if (p) {
                 // ok, so this should definitely always work, but... safety first, kids!
@@ -224,9 +237,9 @@ void Transaction::downloadLinkLoaded(const KNSCore::Entry &entry)
             // We now have all the links, so let's try and identify the correct one...
             qCDebug(KNEWSTUFFCORE) << "We now have all the links, so let's try and identify the correct one...";
             QString identifiedLink;
-            const QString payloadToIdentify = d->payloadToIdentify[entry];
+            const QString payloadToIdentify = d->payloadToIdentify[entry.key()];
             const QList<Entry::DownloadLinkInformation> downloadLinks = entry.downloadLinkInformationList();
-            const QStringList &payloads = d->payloads[entry];
+            const QStringList &payloads = d->payloads[entry.key()];
 
             if (payloads.contains(payloadToIdentify)) {
                 // Simplest option, the link hasn't changed at all
@@ -274,9 +287,11 @@ void Transaction::downloadLinkLoaded(const KNSCore::Entry &entry)
             if (!identifiedLink.isEmpty()) {
                 KNSCore::Entry theEntry(entry);
                 theEntry.setPayload(identifiedLink);
-                d->m_engine->d->installation->install(theEntry);
+                // The links were loaded in order, starting with the first one
+                theEntry.setInstalledLinkId(payloads.indexOf(identifiedLink) + 1);
+                d->install(theEntry);
                 connect(d->m_engine->d->installation, &Installation::signalInstallationFinished, this, [this, entry](const KNSCore::Entry &finishedEntry) {
-                    if (entry.uniqueId() == finishedEntry.uniqueId()) {
+                    if (entry.key() == finishedEntry.key()) {
                         d->finish();
                     }
                 });
@@ -291,14 +306,14 @@ void Transaction::downloadLinkLoaded(const KNSCore::Entry &entry)
             }
             // As the serverside data may change before next time this is called, even in the same session,
             // let's not make assumptions, and just get rid of this
-            d->payloads.remove(entry);
-            d->payloadToIdentify.remove(entry);
+            d->payloads.remove(entry.key());
+            d->payloadToIdentify.remove(entry.key());
             d->finish();
         }
     } else {
-        d->m_engine->d->installation->install(entry);
+        d->install(entry);
         connect(d->m_engine->d->installation, &Installation::signalInstallationFinished, this, [this, entry](const KNSCore::Entry &finishedEntry) {
-            if (entry.uniqueId() == finishedEntry.uniqueId()) {
+            if (entry.key() == finishedEntry.key()) {
                 d->finish();
             }
         });
@@ -0,0 +1,161 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include "trigramindex_p.h"
+
+#include <QSet>
+
+#include <algorithm>
+
+using namespace KNSCore;
+
+// How many of the trigrams of the search term an entry has to share to be a match. Low enough for a
+// typo or two in a word, high enough to not match everything which happens to share a few letters.
+static const double MIN_SIMILARITY{0.5};
+
+QList<TrigramIndex::Trigram> TrigramIndex::trigrams(const QString &text)
+{
+    // Each word is padded, so the start and end of a word count for more than the middle (like pg_trgm does it)
+    QList<Trigram> result;
+    QSet<Trigram> seen;
+    const QString folded = text.toCaseFolded();
+    QString word;
+    const auto addWord = [&result, &seen, &word]() {
+        if (word.isEmpty()) {
+            return;
+        }
+        const QString padded = QLatin1String("  ") + word + QLatin1Char(' ');
+        for (qsizetype i = 0; i + 3 <= padded.size(); ++i) {
+            const Trigram trigram = (Trigram(padded.at(i).unicode()) << 32) | (Trigram(padded.at(i + 1).unicode()) << 16) | padded.at(i + 2).unicode();
+            if (!seen.contains(trigram)) {
+                seen.insert(trigram);
+                result << trigram;
+            }
+        }
+        word.clear();
+    };
+    for (const QChar c : folded) {
+        if (c.isLetterOrNumber()) {
+            word += c;
+        } else {
+            addWord();
+        }
+    }
+    addWord();
+    return result;
+}
+
+void TrigramIndex::clear()
+{
+    m_entries.clear();
+    m_slots.clear();
+    m_postings.clear();
+    m_deadSlots = 0;
+}
+
+void TrigramIndex::compact()
+{
+    Entry::List entries;
+    entries.reserve(m_slots.count());
+    for (const Entry &entry : std::as_const(m_entries)) {
+        if (entry.isValid()) {
+            entries << entry;
+        }
+    }
+    clear();
+    add(entries);
+}
+
+static QString searchableText(const Entry &entry)
+{
+    QString text = entry.name() + QLatin1Char(' ') + entry.summary() + QLatin1Char(' ') + entry.author().name();
+    const QStringList tags = entry.tags();
+    for (const QString &tag : tags) {
+        text += QLatin1Char(' ') + tag;
+    }
+    return text;
+}
+
+void TrigramIndex::add(const KNSCore::Entry &entry)
+{
+    if (!entry.isValid()) {
+        return;
+    }
+    const QString text = searchableText(entry);
+    const auto previous = m_slots.constFind(entry.key());
+    if (previous != m_slots.constEnd()) {
+        if (searchableText(m_entries.at(*previous)) == text) {
+            // Seen again (as happens with every page the entry is on), nothing to index
+            m_entries[*previous] = entry;
+            return;
+        }
+        // The postings of the old slot are left for search() to skip, which is cheaper than finding them all
+        m_entries[*previous] = Entry();
+        ++m_deadSlots;
+        if (m_deadSlots > m_entries.count() / 2) {
+            compact();
+        }
+    }
+    const int slot = m_entries.count();
+    m_slots.insert(entry.key(), slot);
+    m_entries << entry;
+
+    const QList<Trigram> entryTrigrams = trigrams(text);
+    for (const Trigram trigram : entryTrigrams) {
+        m_postings[trigram] << slot;
+    }
+}
+
+void TrigramIndex::add(const KNSCore::Entry::List &entries)
+{
+    for (const Entry &entry : entries) {
+        add(entry);
+    }
+}
+
+int TrigramIndex::count() const
+{
+    return m_slots.count();
+}
+
+KNSCore::Entry::List TrigramIndex::search(const QString &term, int maxResults) const
+{
+    const QList<Trigram> termTrigrams = trigrams(term);
+    if (termTrigrams.isEmpty()) {
+        return {};
+    }
+    QHash<int, int> shared;
+    for (const Trigram trigram : termTrigrams) {
+        const auto posting = m_postings.constFind(trigram);
+        if (posting == m_postings.constEnd()) {
+            continue;
+        }
+        for (const int slot : *posting) {
+            ++shared[slot];
+        }
+    }
+
+    const int minShared = qMax(1, int(termTrigrams.count() * MIN_SIMILARITY + 0.5));
+    QList<QPair<int, int>> matches; // shared trigrams, slot
+    for (auto it = shared.cbegin(); it != shared.cend(); ++it) {
+        if (it.value() >= minShared && m_entries.at(it.key()).isValid()) {
+            matches << qMakePair(it.value(), it.key());
+        }
+    }
+    // Best first, and amongst equally good ones, those indexed first
+    std::sort(matches.begin(), matches.end(), [](const QPair<int, int> &a, const QPair<int, int> &b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    Entry::List result;
+    for (const auto &match : std::as_const(matches)) {
+        if (result.count() >= maxResults) {
+            break;
+        }
+        result << m_entries.at(match.second);
+    }
+    return result;
+}
@@ -0,0 +1,60 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KNEWSTUFF3_TRIGRAMINDEX_P_H
+#define KNEWSTUFF3_TRIGRAMINDEX_P_H
+
+#include <QHash>
+
+#include "entry.h"
+
+#include "knewstuffcore_export.h"
+
+namespace KNSCore
+{
+/**
+ * An index of the trigrams (runs of three characters) in the name, summary, author and
+ * tags of entries. Looking up which entries share most of their trigrams with a search
+ * term is quick, and tolerates typos, as a typo only affects the few trigrams around it.
+ *
+ * @internal
+ */
+class KNEWSTUFFCORE_EXPORT TrigramIndex
+{
+public:
+    void clear();
+
+    /**
+     * Add an entry to the index, replacing what was indexed for it before
+     */
+    void add(const KNSCore::Entry &entry);
+    void add(const KNSCore::Entry::List &entries);
+
+    int count() const;
+
+    /**
+     * The entries matching the search term best, best first
+     * @param term What to look for
+     * @param maxResults The largest number of entries to return
+     */
+    KNSCore::Entry::List search(const QString &term, int maxResults = 50) const;
+
+private:
+    typedef quint64 Trigram;
+    static QList<Trigram> trigrams(const QString &text);
+    // Re-index without the slots of replaced entries
+    void compact();
+
+    // Entries by slot, slots of entries which were replaced are left empty
+    QList<Entry> m_entries;
+    QHash<EntryKey, int> m_slots;
+    QHash<Trigram, QList<int>> m_postings;
+    int m_deadSlots = 0;
+};
+
+}
+
+#endif
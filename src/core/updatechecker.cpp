@@ -0,0 +1,335 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include "updatechecker.h"
+
+#include "cache.h"
+#include "enginebase.h"
+#include "jobs/connectivity.h"
+#include "knewstuffcore_debug.h"
+
+#include <KConfig>
+#include <KConfigGroup>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QPointer>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTimer>
+
+#include <algorithm>
+
+using namespace KNSCore;
+
+// How long a group may take before we stop waiting for its providers, so a background check always ends
+static const int GROUP_TIMEOUT{120000};
+
+namespace
+{
+// Gives access to the providers, which the checker talks to directly, and tells them about
+// the installed entries of every configuration in the group rather than just the one it was set up with
+class CheckerEngine : public EngineBase
+{
+public:
+    CheckerEngine(const QHash<QString, QHash<EntryKey, Entry>> &installed, QObject *parent = nullptr)
+        : EngineBase(parent)
+        , installed(installed)
+    {
+        // Nobody is going to install anything from here
+        setPrefetchPayloadLinks(false);
+    }
+    using EngineBase::providers;
+
+protected:
+    Entry::List cachedEntriesForProvider(const QString &providerId) const override
+    {
+        return installed.value(providerId).values();
+    }
+
+private:
+    const QHash<QString, QHash<EntryKey, Entry>> installed;
+};
+
+struct InstalledConfig {
+    QString configFile;
+    QString providersKey;
+    Entry::List installed;
+};
+
+// Reads just enough of a configuration to know where its providers come from, along with what it has installed
+bool readConfig(const QString &configFile, InstalledConfig *config)
+{
+    const QString resolved = QFileInfo(configFile).isAbsolute()
+        ? configFile
+        : QStandardPaths::locate(QStandardPaths::GenericDataLocation, QStringLiteral("knsrcfiles/%1").arg(configFile));
+    if (!QFileInfo::exists(resolved)) {
+        qCWarning(KNEWSTUFFCORE) << "The knsrc file" << configFile << "does not exist";
+        return false;
+    }
+    const KConfig conf(resolved);
+    const KConfigGroup group = conf.hasGroup(QStringLiteral("KNewStuff")) ? conf.group(QStringLiteral("KNewStuff")) : conf.group(QStringLiteral("KNewStuff3"));
+    if (!group.exists()) {
+        qCWarning(KNEWSTUFFCORE) << configFile << "doesn't contain a KNewStuff or KNewStuff3 section.";
+        return false;
+    }
+
+    // The same rules EngineBase::init() uses to find the providers
+    QUrl providersUrl = group.readEntry("ProvidersUrl", QUrl(QStringLiteral("https://autoconfig.kde.org/ocs/providers.xml")));
+    if (group.readEntry("UseLocalProvidersFile", false)) {
+        providersUrl = QUrl::fromLocalFile(QLatin1String("%1.providers").arg(configFile.left(configFile.length() - 6)));
+    }
+    const QString mirror = group.readEntry("Mirror");
+    if (!mirror.isEmpty()) {
+        providersUrl = QUrl::fromLocalFile(QDir(mirror).filePath(QStringLiteral("mirror.providers")));
+    }
+
+    const QSharedPointer<Cache> cache = Cache::getCache(QFileInfo(resolved).completeBaseName());
+    cache->readRegistry();
+    const Entry::List registry = cache->registry();
+    config->configFile = configFile;
+    config->providersKey = providersUrl.toString();
+    config->installed.clear();
+    for (const Entry &entry : registry) {
+        if (entry.status() == Entry::Installed || entry.status() == Entry::Updateable) {
+            config->installed << entry;
+        }
+    }
+    return true;
+}
+}
+
+class KNSCore::UpdateCheckerPrivate
+{
+public:
+    struct Group {
+        QStringList configFiles;
+        // The installed entries of all the configurations in the group, by provider
+        QHash<QString, QHash<EntryKey, Entry>> installed;
+        // Which configurations installed which entries
+        QMultiHash<EntryKey, QString> owners;
+        QPointer<CheckerEngine> engine;
+        QTimer *timer = nullptr;
+        bool loading = false;
+        int pendingProviders = 0;
+    };
+
+    QStringList configFiles;
+    int maxParallel = 2;
+    bool checking = false;
+
+    QList<Group> groups;
+    int nextGroup = 0;
+    int activeGroups = 0;
+    QList<QPair<QString, Entry>> updateable;
+
+    void addUpdateable(const Group &group, const Entry &entry)
+    {
+        const QList<QString> owners = group.owners.values(entry.key());
+        for (const QString &configFile : owners) {
+            auto existing = std::find_if(updateable.begin(), updateable.end(), [&configFile, &entry](const QPair<QString, Entry> &known) {
+                return known.first == configFile && known.second.key() == entry.key();
+            });
+            if (existing == updateable.end()) {
+                updateable << qMakePair(configFile, entry);
+            } else {
+                existing->second = entry;
+            }
+        }
+    }
+};
+
+UpdateChecker::UpdateChecker(QObject *parent)
+    : QObject(parent)
+    , d(new UpdateCheckerPrivate)
+{
+    d->configFiles = EngineBase::availableConfigFiles();
+}
+
+UpdateChecker::~UpdateChecker()
+{
+    for (const UpdateCheckerPrivate::Group &group : std::as_const(d->groups)) {
+        delete group.engine;
+    }
+}
+
+void UpdateChecker::setConfigFiles(const QStringList &configFiles)
+{
+    d->configFiles = configFiles;
+}
+
+QStringList UpdateChecker::configFiles() const
+{
+    return d->configFiles;
+}
+
+void UpdateChecker::setMaxParallel(int maxParallel)
+{
+    d->maxParallel = qMax(1, maxParallel);
+}
+
+int UpdateChecker::maxParallel() const
+{
+    return d->maxParallel;
+}
+
+bool UpdateChecker::isChecking() const
+{
+    return d->checking;
+}
+
+Entry::List UpdateChecker::updateableEntries(const QString &configFile) const
+{
+    Entry::List entries;
+    QSet<EntryKey> seen;
+    for (const auto &[owner, entry] : std::as_const(d->updateable)) {
+        if (configFile.isEmpty() ? !seen.contains(entry.key()) : owner == configFile) {
+            seen.insert(entry.key());
+            entries << entry;
+        }
+    }
+    return entries;
+}
+
+void UpdateChecker::check()
+{
+    if (d->checking) {
+        return;
+    }
+    d->checking = true;
+    d->groups.clear();
+    d->nextGroup = 0;
+    d->activeGroups = 0;
+    d->updateable.clear();
+
+    // Reading the registries is cheap, and for most configurations shows there is nothing to check
+    QHash<QString, int> groupForProviders;
+    for (const QString &configFile : std::as_const(d->configFiles)) {
+        InstalledConfig config;
+        if (!readConfig(configFile, &config) || config.installed.isEmpty()) {
+            continue;
+        }
+        auto groupIndex = groupForProviders.constFind(config.providersKey);
+        if (groupIndex == groupForProviders.constEnd()) {
+            groupIndex = groupForProviders.insert(config.providersKey, d->groups.count());
+            d->groups << UpdateCheckerPrivate::Group();
+        }
+        UpdateCheckerPrivate::Group &group = d->groups[*groupIndex];
+        group.configFiles << configFile;
+        for (const Entry &entry : std::as_const(config.installed)) {
+            group.installed[entry.providerId()].insert(entry.key(), entry);
+            group.owners.insert(entry.key(), configFile);
+            if (entry.status() == Entry::Updateable) {
+                d->addUpdateable(group, entry);
+            }
+        }
+    }
+    qCDebug(KNEWSTUFFCORE) << "Checking for updates in" << d->groups.count() << "groups of configurations out of" << d->configFiles.count();
+
+    if (!Connectivity::instance()->isOnline()) {
+        // Nothing to ask, so what the registries know already is all there is
+        d->nextGroup = d->groups.count();
+    }
+    // Not straight away, so finished() is never emitted from within check()
+    QTimer::singleShot(0, this, &UpdateChecker::startNext);
+}
+
+void UpdateChecker::startNext()
+{
+    while (d->activeGroups < d->maxParallel && d->nextGroup < d->groups.count()) {
+        const int groupIndex = d->nextGroup++;
+        UpdateCheckerPrivate::Group &group = d->groups[groupIndex];
+        ++d->activeGroups;
+        qCDebug(KNEWSTUFFCORE) << "Checking for updates to" << group.configFiles;
+
+        group.timer = new QTimer(this);
+        group.timer->setSingleShot(true);
+        connect(group.timer, &QTimer::timeout, this, [this, groupIndex]() {
+            qCWarning(KNEWSTUFFCORE) << "Checking for updates to" << d->groups[groupIndex].configFiles << "is taking too long, giving up";
+            groupFinished(groupIndex);
+        });
+        group.timer->start(GROUP_TIMEOUT);
+
+        // All configurations in the group share their providers, so any of them will do to load those
+        group.engine = new CheckerEngine(group.installed, this);
+        connect(group.engine, &EngineBase::signalErrorCode, this, [this, groupIndex](const KNSCore::ErrorCode &error) {
+            if (error == KNSCore::ProviderError || error == KNSCore::ConfigFileError) {
+                groupFinished(groupIndex);
+            }
+        });
+        connect(group.engine, &EngineBase::signalProvidersLoaded, this, [this, groupIndex]() {
+            UpdateCheckerPrivate::Group &group = d->groups[groupIndex];
+            if (group.loading || !group.engine) {
+                return;
+            }
+            group.loading = true;
+            Provider::SearchRequest request(Provider::Newest, Provider::Updates, QString(), QStringList(), 0);
+            request.deadline = group.engine->requestDeadline();
+            const auto providers = group.engine->providers();
+            for (const QSharedPointer<Provider> &provider : providers) {
+                if (!provider->isInitialized() || !group.installed.contains(provider->id())) {
+                    continue;
+                }
+                ++group.pendingProviders;
+                connect(provider.data(),
+                        &Provider::loadingFinished,
+                        this,
+                        [this, groupIndex, request](const KNSCore::Provider::SearchRequest &loaded, const KNSCore::Entry::List &entries) {
+                            UpdateCheckerPrivate::Group &group = d->groups[groupIndex];
+                            if (!(loaded == request) || !group.engine) {
+                                return;
+                            }
+                            for (const Entry &entry : entries) {
+                                if (entry.status() == Entry::Updateable) {
+                                    d->addUpdateable(group, entry);
+                                }
+                            }
+                            if (--group.pendingProviders == 0) {
+                                groupFinished(groupIndex);
+                            }
+                        });
+                connect(provider.data(), &Provider::loadingFailed, this, [this, groupIndex, request](const KNSCore::Provider::SearchRequest &failed) {
+                    UpdateCheckerPrivate::Group &group = d->groups[groupIndex];
+                    if (failed == request && group.engine && --group.pendingProviders == 0) {
+                        groupFinished(groupIndex);
+                    }
+                });
+                // One check per provider, covering what every configuration in the group installed from it,
+                // which the engine told it about when it was initialized
+                provider->loadEntries(request);
+            }
+            if (group.pendingProviders == 0) {
+                groupFinished(groupIndex);
+            }
+        });
+        if (!group.engine->init(group.configFiles.first())) {
+            groupFinished(groupIndex);
+        }
+    }
+
+    if (d->activeGroups == 0 && d->nextGroup >= d->groups.count()) {
+        d->checking = false;
+        qCDebug(KNEWSTUFFCORE) << "Update check finished," << d->updateable.count() << "updates found";
+        Q_EMIT finished();
+    }
+}
+
+void UpdateChecker::groupFinished(int groupIndex)
+{
+    UpdateCheckerPrivate::Group &group = d->groups[groupIndex];
+    if (!group.engine) {
+        return;
+    }
+    // Not straight away, as we may well be in the middle of one of its signals
+    group.engine->deleteLater();
+    group.engine = nullptr;
+    group.timer->deleteLater();
+    group.timer = nullptr;
+    --d->activeGroups;
+    QTimer::singleShot(0, this, &UpdateChecker::startNext);
+}
+
+#include "moc_updatechecker.cpp"
@@ -0,0 +1,95 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KNEWSTUFF3_UPDATECHECKER_H
+#define KNEWSTUFF3_UPDATECHECKER_H
+
+#include <QObject>
+
+#include "entry.h"
+
+#include "knewstuffcore_export.h"
+
+#include <memory>
+
+namespace KNSCore
+{
+class UpdateCheckerPrivate;
+
+/**
+ * Checks for updates to everything installed through any of the knsrc configurations on
+ * the system in one go, for example to notify the user about them in the background.
+ *
+ * Rather than setting up an engine for every configuration, the checker first reads their
+ * registries, and leaves out the configurations which have nothing installed. The rest are
+ * grouped by the providers they use, and each group only loads its providers once, which
+ * are then asked about the installed entries of all the configurations in the group
+ * together. A few groups are checked at the same time.
+ *
+ * @code
+ * auto checker = new KNSCore::UpdateChecker(this);
+ * connect(checker, &KNSCore::UpdateChecker::finished, this, [checker]() {
+ *     const KNSCore::Entry::List updates = checker->updateableEntries();
+ *     ...
+ * });
+ * checker->check();
+ * @endcode
+ *
+ * While offline, only entries already known to be updateable are reported.
+ *
+ * @since 6.0
+ */
+class KNEWSTUFFCORE_EXPORT UpdateChecker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit UpdateChecker(QObject *parent = nullptr);
+    ~UpdateChecker() override;
+
+    /**
+     * The configurations to check, EngineBase::availableConfigFiles() by default
+     */
+    void setConfigFiles(const QStringList &configFiles);
+    QStringList configFiles() const;
+
+    /**
+     * How many groups of configurations sharing their providers are checked at the same time (2 by default)
+     */
+    void setMaxParallel(int maxParallel);
+    int maxParallel() const;
+
+    /**
+     * Start checking for updates. Does nothing if a check is already running.
+     * finished() is emitted once done.
+     */
+    void check();
+
+    /**
+     * Whether a check is running
+     */
+    bool isChecking() const;
+
+    /**
+     * The entries found to be updateable by the most recent check
+     * @param configFile Only return the entries installed through this configuration, or all of them if empty
+     */
+    Entry::List updateableEntries(const QString &configFile = QString()) const;
+
+    /**
+     * Emitted when a check is done
+     */
+    Q_SIGNAL void finished();
+
+private:
+    void startNext();
+    void groupFinished(int group);
+
+    const std::unique_ptr<UpdateCheckerPrivate> d;
+};
+
+}
+
+#endif
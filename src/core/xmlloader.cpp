@@ -16,7 +16,10 @@
 #include <KConfig>
 
 #include <QByteArray>
+#include <QCoreApplication>
 #include <QFile>
+#include <QPointer>
+#include <QThreadPool>
 #include <QTimer>
 
 namespace KNSCore
@@ -34,6 +37,30 @@ void handleData(XmlLoader *q, const QByteArray &data)
     }
 }
 
+void handleDataInBackground(XmlLoader *q, const QByteArray &data)
+{
+    // The loader might be gone by the time parsing is done, so we only touch it back on the main thread, and if it still exists
+    QPointer<XmlLoader> loader(q);
+    QThreadPool::globalInstance()->start([loader, data]() {
+        QDomDocument doc;
+        const bool valid = static_cast<bool>(doc.setContent(data));
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [loader, doc, valid]() {
+                if (!loader) {
+                    return;
+                }
+                if (valid) {
+                    Q_EMIT loader->signalLoaded(doc);
+                } else {
+                    Q_EMIT loader->signalFailed();
+                }
+                loader->deleteLater();
+            },
+            Qt::QueuedConnection);
+    });
+}
+
 XmlLoader::XmlLoader(QObject *parent)
     : QObject(parent)
 {
@@ -49,7 +76,16 @@ void XmlLoader::load(const QUrl &url)
         m_jobdata.clear();
         static const QStringList remoteSchemeOptions{QLatin1String{"http"}, QLatin1String{"https"}, QLatin1String{"ftp"}};
         if (remoteSchemeOptions.contains(url.scheme())) {
-            HTTPJob *job = HTTPJob::get(url, Reload, JobFlag::HideProgressInfo);
+            HTTPJob *job = HTTPJob::get(url, m_loadType, JobFlag::HideProgressInfo);
+            job->setTransferTimeout(m_transferTimeout);
+            job->setHedgingEnabled(m_hedgingEnabled);
+            job->setMirrors(m_mirrors);
+            if (!m_etag.isEmpty()) {
+                job->setRequestHeader(QByteArrayLiteral("If-None-Match"), m_etag);
+            }
+            if (!m_lastModified.isEmpty()) {
+                job->setRequestHeader(QByteArrayLiteral("If-Modified-Since"), m_lastModified);
+            }
             connect(job, &KJob::result, this, &XmlLoader::slotJobResult);
             connect(job, &HTTPJob::data, this, &XmlLoader::slotJobData);
             connect(job, &HTTPJob::httpError, this, &XmlLoader::signalHttpError);
@@ -77,12 +113,28 @@ void XmlLoader::slotJobData(KJob *, const QByteArray &data)
 
 void XmlLoader::slotJobResult(KJob *job)
 {
-    deleteLater();
     if (job->error()) {
+        deleteLater();
         Q_EMIT signalFailed();
-    } else {
-        handleData(this, m_jobdata);
+        return;
+    }
+    HTTPJob *httpJob = qobject_cast<HTTPJob *>(job);
+    if (httpJob && httpJob->statusCode() == 304) {
+        deleteLater();
+        Q_EMIT signalNotModified();
+        return;
     }
+    if (httpJob) {
+        m_etag = httpJob->responseHeader(QByteArrayLiteral("ETag"));
+        m_lastModified = httpJob->responseHeader(QByteArrayLiteral("Last-Modified"));
+    }
+    if (m_parseInBackground) {
+        // deletes the loader once done
+        handleDataInBackground(this, m_jobdata);
+        return;
+    }
+    deleteLater();
+    handleData(this, m_jobdata);
 }
 
 QDomElement addElement(QDomDocument &doc, QDomElement &parent, const QString &tag, const QString &value)
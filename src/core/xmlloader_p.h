@@ -11,6 +11,7 @@
 #ifndef KNEWSTUFF3_XMLLOADER_P_H
 #define KNEWSTUFF3_XMLLOADER_P_H
 
+#include "jobs/jobbase.h"
 #include "provider.h"
 #include <QNetworkReply>
 #include <QObject>
@@ -59,6 +60,78 @@ public:
         m_searchTerm = searchTerm;
     }
 
+    /**
+     * Abort remote loads when no data has arrived for this long
+     * @param msecs The timeout in milliseconds, 0 meaning no timeout
+     */
+    void setTransferTimeout(int msecs)
+    {
+        m_transferTimeout = msecs;
+    }
+
+    /**
+     * How remote loads make use of the local cache (Reload by default)
+     */
+    void setLoadType(LoadType loadType)
+    {
+        m_loadType = loadType;
+    }
+
+    /**
+     * Hedge remote loads, sending a second request if the first one is slow to respond
+     * @see HTTPJob::setHedgingEnabled
+     */
+    void setHedgingEnabled(bool enabled)
+    {
+        m_hedgingEnabled = enabled;
+    }
+
+    /**
+     * Other locations the document can be loaded from, see Provider::mirrorsFor()
+     */
+    void setMirrors(const QList<QUrl> &mirrors)
+    {
+        m_mirrors = mirrors;
+    }
+
+    /**
+     * Parse the loaded document on the global thread pool rather than on the thread the loader lives in.
+     * Useful when several large documents are loaded at the same time. Off by default.
+     */
+    void setParseInBackground(bool parseInBackground)
+    {
+        m_parseInBackground = parseInBackground;
+    }
+
+    /**
+     * Make remote loads conditional on the document having changed since it was last
+     * fetched. If the server reports it has not, signalNotModified() is emitted rather
+     * than signalLoaded().
+     * @param etag The ETag the document was last served with, or empty
+     * @param lastModified The Last-Modified date the document was last served with, or empty
+     */
+    void setValidators(const QByteArray &etag, const QByteArray &lastModified)
+    {
+        m_etag = etag;
+        m_lastModified = lastModified;
+    }
+
+    /**
+     * The ETag validator of the loaded document, valid once signalLoaded has been emitted
+     */
+    QByteArray etag() const
+    {
+        return m_etag;
+    }
+
+    /**
+     * The Last-Modified validator of the loaded document, valid once signalLoaded has been emitted
+     */
+    QByteArray lastModified() const
+    {
+        return m_lastModified;
+    }
+
     Provider::Filter filter() const
     {
         return m_filter;
@@ -74,6 +147,10 @@ Q_SIGNALS:
      */
     void signalLoaded(const QDomDocument &);
     void signalFailed();
+    /**
+     * Emitted instead of signalLoaded when the validators passed to setValidators() are still current
+     */
+    void signalNotModified();
     /**
      * Fired in case there is a http error reported
      * In some instances this is useful information for our users, and we want to make sure we report this centrally
@@ -92,6 +169,13 @@ private:
     QByteArray m_jobdata;
     Provider::Filter m_filter;
     QString m_searchTerm;
+    int m_transferTimeout = 0;
+    LoadType m_loadType = Reload;
+    bool m_hedgingEnabled = false;
+    bool m_parseInBackground = false;
+    QList<QUrl> m_mirrors;
+    QByteArray m_etag;
+    QByteArray m_lastModified;
 };
 
 }
@@ -17,6 +17,7 @@
 
 #include <knewstuffcore_debug.h>
 
+#include "cachedentries_p.h"
 #include "tagsfilterchecker.h"
 
 namespace KNSCore
@@ -83,6 +84,10 @@ static const QLatin1String KEY_MIME_TYPE{"data##mimetype="};
 static const QLatin1String KEY_URL{"data##url="};
 static const QLatin1String KEY_LANGUAGE{"data##language="};
 
+// How many navigation feeds we keep parsed in memory, and for how long we trust them without asking the server
+static const int FEED_CACHE_SIZE{32};
+static const int FEED_REVALIDATE_AFTER{60}; // seconds
+
 class OPDSProviderPrivate
 {
 public:
@@ -111,12 +116,42 @@ public:
 
     XmlLoader *xmlLoader;
 
-    Entry::List cachedEntries;
+    CachedEntries cachedEntries;
     Provider::SearchRequest currentRequest;
 
     QUrl openSearchDocumentURL;
     QString openSearchTemplate;
 
+    /***
+     * Navigating an OPDS catalog means going back and forth between the same few feeds,
+     * so we keep the parsed result of each around, along with the validators the server
+     * sent it with, to show them again immediately and only ask the server whether they
+     * changed.
+     */
+    struct CachedFeed {
+        Entry::List entries;
+        QList<Provider::SearchPreset> presets;
+        QString selfUrl;
+        QByteArray etag;
+        QByteArray lastModified;
+        QDateTime fetched;
+    };
+    QHash<QUrl, CachedFeed> feedCache;
+
+    void cacheFeed(const QUrl &url, const CachedFeed &feed)
+    {
+        if (!feedCache.contains(url) && feedCache.size() >= FEED_CACHE_SIZE) {
+            auto oldest = feedCache.begin();
+            for (auto it = feedCache.begin(); it != feedCache.end(); ++it) {
+                if (it->fetched < oldest->fetched) {
+                    oldest = it;
+                }
+            }
+            feedCache.erase(oldest);
+        }
+        feedCache.insert(url, feed);
+    }
+
     // Generate an opensearch string.
     QUrl openSearchStringForRequest(const KNSCore::Provider::SearchRequest &request)
     {
@@ -197,18 +232,19 @@ while (!el.isNull()) {
  * @brief parseFeedData
  * The main parsing function of this provider. Receives a QDomDocument
  * and parses that with Syndication's atom reader.
+ * @param url the url the document was fetched from
  * @param doc
  */
-void parseFeedData(const QDomDocument &doc)
+void parseFeedData(const QUrl &url, const QDomDocument &doc, const QByteArray &etag = QByteArray(), const QByteArray &lastModified = QByteArray())
 {
-    Syndication::DocumentSource source(doc.toByteArray(), currentUrl.toString());
+    Syndication::DocumentSource source(doc.toByteArray(), url.toString());
     Syndication::Atom::Parser parser;
     Syndication::Atom::FeedDocumentPtr feedDoc = parser.parse(source).staticCast<Syndication::Atom::FeedDocument>();
 
     QString fullEntryMimeType = QStringList({OPDS_ATOM_MT, OPDS_TYPE_ENTRY, OPDS_PROFILE}).join(QStringLiteral(";"));
 
     if (!feedDoc->isValid()) {
-        qCWarning(KNEWSTUFFCORE) << "OPDS Feed at" << currentUrl << "not valid";
+        qCWarning(KNEWSTUFFCORE) << "OPDS Feed at" << url << "not valid";
         Q_EMIT q->loadingFailed(currentRequest);
         return;
     }
@@ -338,11 +374,8 @@ void parseFeedData(const QDomDocument &doc)
         entry.setUniqueId(feedEntry.id());
 
         entry.setStatus(KNSCore::Entry::Invalid);
-        for (const Entry &cachedEntry : std::as_const(cachedEntries)) {
-            if (entry.uniqueId() == cachedEntry.uniqueId()) {
-                entry = cachedEntry;
-                break;
-            }
+        if (cachedEntries.contains(entry.key())) {
+            entry = cachedEntries.value(entry.key());
         }
 
         // This is a bit of a pickle: atom feeds can have multiple categories.
@@ -513,6 +546,7 @@ void parseFeedData(const QDomDocument &doc)
         Q_EMIT q->entryDetailsLoaded(entries.first());
         loadingExtraDetails = false;
     } else {
+        cacheFeed(url, CachedFeed{entries, presets, selfUrl, etag, lastModified, QDateTime::currentDateTime()});
         Q_EMIT q->loadingFinished(currentRequest, entries);
     }
     Q_EMIT q->searchPresetsLoaded(presets);
@@ -550,10 +584,9 @@ void OPDSProvider::loadEntries(const KNSCore::Provider::SearchRequest &request)
         Q_EMIT loadingFinished(request, d->installedEntries());
         return;
     } else if (request.filter == Provider::ExactEntryId) {
-        for (Entry entry : d->cachedEntries) {
-            if (entry.uniqueId() == request.searchTerm) {
-                loadEntryDetails(entry);
-            }
+        const Entry entry = d->cachedEntries.value(entryKey(d->providerId, request.searchTerm));
+        if (entry.isValid()) {
+            loadEntryDetails(entry);
         }
     } else {
         if (QUrl(request.searchTerm).scheme().startsWith(QStringLiteral("http"))) {
@@ -568,16 +601,58 @@ void OPDSProvider::loadEntries(const KNSCore::Provider::SearchRequest &request)
 
         QUrl url = d->currentUrl;
         if (!url.isEmpty()) {
-            qCDebug(KNEWSTUFFCORE) << "requesting url" << url;
-            d->xmlLoader = new XmlLoader(this);
             d->currentTime = QDateTime::currentDateTime();
             d->loadingExtraDetails = false;
-            connect(d->xmlLoader, &XmlLoader::signalLoaded, this, [this](const QDomDocument &doc) {
-                d->parseFeedData(doc);
+
+            const auto cached = d->feedCache.constFind(url);
+            const bool isCached = cached != d->feedCache.constEnd();
+            if (isCached) {
+                // Show what we have straight away, and only then (and only if it has been a while) check whether it changed
+                const OPDSProviderPrivate::CachedFeed feed = cached.value();
+                d->selfUrl = feed.selfUrl;
+                QTimer::singleShot(0, this, [this, request, feed]() {
+                    Q_EMIT loadingFinished(request, feed.entries);
+                    Q_EMIT searchPresetsLoaded(feed.presets);
+                });
+                if (feed.fetched.secsTo(d->currentTime) < FEED_REVALIDATE_AFTER) {
+                    return;
+                }
+                qCDebug(KNEWSTUFFCORE) << "revalidating cached feed" << url;
+            } else {
+                qCDebug(KNEWSTUFFCORE) << "requesting url" << url;
+            }
+
+            XmlLoader *loader = new XmlLoader(this);
+            d->xmlLoader = loader;
+            connect(loader, &XmlLoader::signalLoaded, this, [this, loader, url](const QDomDocument &doc) {
+                if (d->currentUrl != url) {
+                    // We have since moved on, so this would be reported as the results of a request it does not belong to
+                    qCDebug(KNEWSTUFFCORE) << "Dropping stale feed" << url;
+                    return;
+                }
+                d->parseFeedData(url, doc, loader->etag(), loader->lastModified());
             });
-            connect(d->xmlLoader, &XmlLoader::signalFailed, this, [this]() {
+            connect(loader, &XmlLoader::signalNotModified, this, [this, url]() {
+                auto feed = d->feedCache.find(url);
+                if (feed != d->feedCache.end()) {
+                    feed->fetched = QDateTime::currentDateTime();
+                }
+            });
+            connect(loader, &XmlLoader::signalFailed, this, [this, url, isCached]() {
+                if (d->currentUrl != url) {
+                    return;
+                }
+                if (isCached) {
+                    qCDebug(KNEWSTUFFCORE) << "Could not revalidate cached feed" << url << ", keeping the cached copy";
+                    return;
+                }
                 d->slotLoadingFailed();
             });
+            if (isCached) {
+                loader->setValidators(cached->etag, cached->lastModified);
+            }
+            // Not hedged, as catalogue feeds can be large
+            d->xmlLoader->setTransferTimeout(request.deadline);
             d->xmlLoader->load(url);
         } else {
             Q_EMIT loadingFailed(request);
@@ -602,12 +677,15 @@ void OPDSProvider::loadEntryDetails(const Entry &entry)
         d->xmlLoader = new XmlLoader(this);
         d->currentTime = QDateTime::currentDateTime();
         d->loadingExtraDetails = true;
-        connect(d->xmlLoader, &XmlLoader::signalLoaded, this, [this](const QDomDocument &doc) {
-            d->parseFeedData(doc);
+        connect(d->xmlLoader, &XmlLoader::signalLoaded, this, [this, url](const QDomDocument &doc) {
+            d->parseFeedData(url, doc);
         });
         connect(d->xmlLoader, &XmlLoader::signalFailed, this, [this]() {
             d->slotLoadingFailed();
         });
+        d->xmlLoader->setTransferTimeout(d->currentRequest.deadline);
+        // A single entry, so cheap enough to ask for twice if the server is slow to respond
+        d->xmlLoader->setHedgingEnabled(true);
         d->xmlLoader->load(url);
     }
 }
@@ -663,7 +741,30 @@ bool OPDSProvider::isInitialized() const
 
 void OPDSProvider::setCachedEntries(const KNSCore::Entry::List &cachedEntries)
 {
-    d->cachedEntries = cachedEntries;
+    d->cachedEntries.clear();
+    for (const Entry &entry : cachedEntries) {
+        d->cachedEntries.insert(entry);
+    }
+}
+
+qint64 OPDSProvider::memoryUsage() const
+{
+    qint64 size = 0;
+    for (const Entry &entry : std::as_const(d->cachedEntries)) {
+        size += entry.memoryUsage();
+    }
+    for (const OPDSProviderPrivate::CachedFeed &feed : std::as_const(d->feedCache)) {
+        for (const Entry &entry : feed.entries) {
+            size += entry.memoryUsage();
+        }
+    }
+    return size;
+}
+
+void OPDSProvider::trimMemory()
+{
+    // The feeds are simply fetched again when navigated to
+    d->feedCache.clear();
 }
 }
 
@@ -70,6 +70,9 @@ public:
     bool isInitialized() const override;
     void setCachedEntries(const KNSCore::Entry::List &cachedEntries) override;
 
+    qint64 memoryUsage() const override;
+    void trimMemory() override;
+
     const std::unique_ptr<OPDSProviderPrivate> d;
 
     Q_DISABLE_COPY(OPDSProvider)
@@ -33,6 +33,7 @@ KCM.SimpleKCM {
     property alias shortSummary: shortSummaryItem.text
     property alias summary: summaryItem.text
     property alias previews: screenshotsItem.screenshotsModel
+    property alias smallPreviews: screenshotsItem.placeholders
     property string homepage
     property string donationLink
     property int status
@@ -64,6 +65,7 @@ KCM.SimpleKCM {
 
         component.author = modelData(NewStuff.ItemsModel.AuthorRole);
         component.name = modelData(NewStuff.ItemsModel.NameRole);
+        component.smallPreviews = modelData(NewStuff.ItemsModel.PreviewsSmallRole);
         component.previews = modelData(NewStuff.ItemsModel.PreviewsRole);
         component.shortSummary = modelData(NewStuff.ItemsModel.ShortSummaryRole);
         component.summary = modelData(NewStuff.ItemsModel.SummaryRole);
@@ -15,6 +15,9 @@ import org.kde.kirigami as Kirigami
 Flickable {
     id: root
     property alias screenshotsModel: screenshotsRep.model
+    // Smaller versions of the screenshots, in the same order, which are usually cached already
+    // and are shown scaled up until the full size ones have arrived
+    property var placeholders: []
     readonly property alias count: screenshotsRep.count
     property int currentIndex: -1
     property Item currentItem: screenshotsRep.itemAt(currentIndex)
@@ -101,7 +104,8 @@ Flickable {
 
             delegate: MouseArea {
                 readonly property url imageSource: modelData
-                readonly property real proportion: thumbnail.sourceSize.width>1 ? thumbnail.sourceSize.height/thumbnail.sourceSize.width : 1
+                readonly property Image shownImage: thumbnail.status == Image.Ready || placeholder.status != Image.Ready ? thumbnail : placeholder
+                readonly property real proportion: shownImage.sourceSize.width>1 ? shownImage.sourceSize.height/shownImage.sourceSize.width : 1
                 anchors.verticalCenter: parent.verticalCenter
                 width: Math.max(50, height/proportion)
                 height: screenshotsLayout.height - 2 * Kirigami.Units.largeSpacing
@@ -115,8 +119,8 @@ Flickable {
                 }
 
                 Kirigami.ShadowedRectangle {
-                    visible: thumbnail.status == Image.Ready
-                    anchors.fill: thumbnail
+                    visible: shownImage.status == Image.Ready
+                    anchors.fill: shownImage
                     Kirigami.Theme.colorSet: Kirigami.Theme.View
                     shadow.size: Kirigami.Units.largeSpacing
                     shadow.color: Qt.rgba(0, 0, 0, 0.3)
@@ -124,16 +128,30 @@ Flickable {
 
                 BusyIndicator {
                     visible: running
-                    running: thumbnail.status == Image.Loading
+                    running: thumbnail.status != Image.Ready && placeholder.status != Image.Ready && (thumbnail.status == Image.Loading || placeholder.status == Image.Loading)
                     anchors.centerIn: parent
                 }
 
+                Image {
+                    id: placeholder
+                    source: root.placeholders && index < root.placeholders.length ? root.placeholders[index] : ""
+                    visible: thumbnail.status != Image.Ready
+                    height: parent.height
+                    fillMode: Image.PreserveAspectFit
+                    smooth: true
+                    asynchronous: true
+                }
+
                 AnimatedImage {
                     id: thumbnail
-                    source: modelData
+                    // Only go for the full size image once the placeholder is done with, so it does not have to
+                    // compete with it (nor with the rest of the details) for the connection
+                    source: placeholder.status == Image.Loading ? "" : modelData
+                    visible: status == Image.Ready
                     height: parent.height
                     fillMode: Image.PreserveAspectFit
                     smooth: true
+                    asynchronous: true
                 }
             }
         }
@@ -16,6 +16,7 @@
 #include "quicksettings.h"
 #include "searchpresetmodel.h"
 
+#include "facetsmodel.h"
 #include "provider.h"
 #include "providersmodel.h"
 #include "question.h"
@@ -82,6 +83,9 @@ void QmlPlugins::registerTypes(const char *uri)
 
     // Version 1.85
     qmlRegisterType<KNSCore::ProvidersModel>(uri, 1, 85, "ProvidersModel");
+
+    // Version 1.91
+    qmlRegisterType<KNSCore::FacetsModel>(uri, 1, 91, "FacetsModel");
 }
 
 #include "moc_qmlplugin.cpp"
@@ -11,8 +11,12 @@
 #include "installation_p.h"
 #include "knewstuffquick_debug.h"
 #include "quicksettings.h"
+#include "resultsindex_p.h"
+#include "resultsstream.h"
 
 #include <KLocalizedString>
+#include <QElapsedTimer>
+#include <QPointer>
 #include <QTimer>
 
 #include "categoriesmodel.h"
@@ -41,8 +45,23 @@ public:
     int numDataJobs = 0;
     int numPictureJobs = 0;
     int numInstallJobs = 0;
+
+    // The results of the request last sent to the providers, see Engine::reorderLocally()
+    KNSCore::ResultsIndex resultsIndex;
+    KNSCore::Provider::SearchRequest indexedRequest;
+    bool indexUsable = false;
+    int indexPending = 0;
+
+    // Asks the providers for the first page when searching for a term, see Engine::reloadEntries()
+    QPointer<KNSCore::ResultsStream> searchStream;
 };
 
+// Whether two requests ask for the same set of entries, whatever their order and page
+static bool sameResults(const KNSCore::Provider::SearchRequest &a, const KNSCore::Provider::SearchRequest &b)
+{
+    return a.filter == b.filter && a.searchTerm == b.searchTerm && a.categories == b.categories && a.pageSize == b.pageSize;
+}
+
 Engine::Engine(QObject *parent)
     : KNSCore::EngineBase(parent)
     , d(new EnginePrivate)
@@ -74,6 +93,12 @@ Engine::Engine(QObject *parent)
     connect(this, &EngineBase::signalProvidersLoaded, this, [this]() {
         d->currentRequest.categories = EngineBase::categories();
     });
+    connect(this, &EngineBase::resultsRefiltered, this, [this]() {
+        // The pages in the cache follow the new tag filters, so show them again, which needs no network for what was loaded already
+        if (d->currentPage >= 0 && d->currentRequest.filter != KNSCore::Provider::Installed && d->currentRequest.filter != KNSCore::Provider::Updates) {
+            reloadEntries();
+        }
+    });
 
     connect(this,
             &KNSCore::EngineBase::signalErrorCode,
@@ -122,9 +147,11 @@ bool Engine::init(const QString &configfile)
 {
     const bool valid = EngineBase::init(configfile);
     if (valid) {
+        d->currentRequest.deadline = requestDeadline();
         connect(this, &Engine::signalEntryEvent, cache().data(), [this](const KNSCore::Entry &entry, KNSCore::Entry::EntryEvent event) {
             if (event == KNSCore::Entry::StatusChangedEvent) {
                 cache()->registerChangedEntry(entry);
+                d->resultsIndex.update(entry);
             }
         });
         const auto slotEntryChanged = [this](const KNSCore::Entry &entry) {
@@ -215,7 +242,9 @@ void Engine::setCategoriesFilter(const QStringList &newCategoriesFilter)
 {
     if (d->currentRequest.categories != newCategoriesFilter) {
         d->currentRequest.categories = newCategoriesFilter;
-        reloadEntries();
+        if (!reorderLocally()) {
+            reloadEntries();
+        }
         Q_EMIT categoriesFilterChanged();
     }
 }
@@ -229,7 +258,9 @@ void Engine::setFilter(KNSCore::Provider::Filter newFilter)
 {
     if (d->currentRequest.filter != newFilter) {
         d->currentRequest.filter = newFilter;
-        reloadEntries();
+        if (!reorderLocally()) {
+            reloadEntries();
+        }
         Q_EMIT filterChanged();
     }
 }
@@ -243,7 +274,9 @@ void Engine::setSortOrder(KNSCore::Provider::SortMode mode)
 {
     if (d->currentRequest.sortMode != mode) {
         d->currentRequest.sortMode = mode;
-        reloadEntries();
+        if (!reorderLocally()) {
+            reloadEntries();
+        }
         Q_EMIT sortOrderChanged();
     }
 }
@@ -283,7 +316,55 @@ void Engine::updateEntryContents(const KNSCore::Entry &entry)
     if (provider.isNull() || !provider->isInitialized()) {
         return;
     }
-    provider->loadEntryDetails(entry);
+    const KNSCore::Entry details = cachedEntryDetails(entry);
+    if (details.isValid()) {
+        qCDebug(KNEWSTUFFQUICK) << "Using the previously loaded details for" << entry.name();
+        Q_EMIT signalEntryEvent(details, KNSCore::Entry::DetailsLoadedEvent);
+    } else {
+        provider->loadEntryDetails(entry);
+    }
+    // Someone looking at the details is somebody who might well press install next
+    prefetchPayloadLinks(entry);
+}
+
+bool Engine::reorderLocally()
+{
+    const KNSCore::Provider::SearchRequest &request = d->currentRequest;
+    const KNSCore::Provider::SearchRequest &indexed = d->indexedRequest;
+    if (!d->indexUsable || d->indexPending > 0 || indexed.filter != KNSCore::Provider::None || request.searchTerm != indexed.searchTerm
+        || request.pageSize != indexed.pageSize) {
+        return false;
+    }
+    if (request.filter != KNSCore::Provider::None && request.filter != KNSCore::Provider::Updates) {
+        return false;
+    }
+    // Providers may well not filter by category at all, so only narrowing down is done by category here
+    const bool sameCategories = request.categories == indexed.categories;
+    if (!sameCategories) {
+        if (request.categories.isEmpty()) {
+            return false;
+        }
+        for (const QString &category : request.categories) {
+            if (!indexed.categories.isEmpty() && !indexed.categories.contains(category)) {
+                return false;
+            }
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const KNSCore::Entry::List entries = d->resultsIndex.query(request.filter, sameCategories ? QStringList() : request.categories, request.sortMode);
+    qCDebug(KNEWSTUFFQUICK) << "Ordered" << entries.count() << "of" << d->resultsIndex.count() << "loaded entries locally in" << timer.nsecsElapsed() / 1000
+                            << "us";
+
+    Q_EMIT signalResetView();
+    d->currentRequest.page = 0;
+    d->currentPage = 0;
+    d->numDataJobs = 0;
+    updateStatus();
+    // These are not what the providers would send for the request (the cache does not tell filters apart), so stay out of the cache
+    Q_EMIT signalEntriesLoaded(entries);
+    return true;
 }
 
 void Engine::reloadEntries()
@@ -293,19 +374,42 @@ void Engine::reloadEntries()
     d->currentRequest.page = 0;
     d->numDataJobs = 0;
 
+    d->resultsIndex.clear();
+    d->indexedRequest = d->currentRequest;
+    d->indexPending = 0;
+    d->indexUsable = false;
+
+    if (d->searchStream) {
+        // Whatever it still has to say is about the previous search
+        d->searchStream->disconnect();
+        d->searchStream->deleteLater();
+    }
+    KNSCore::ResultsStream *stream = nullptr;
+    if (d->currentRequest.filter == KNSCore::Provider::None && !d->currentRequest.searchTerm.isEmpty()) {
+        // The stream shows what we already know about straight away, as the providers may well take a while, and
+        // takes back what none of them turn up. It looks at the same cache as we do below, so it asks the providers
+        // for exactly what we would have asked them for.
+        stream = search(d->currentRequest);
+        stream->setParent(this);
+        d->searchStream = stream;
+        Q_EMIT signalSearchStarted(stream);
+    }
+
     const auto providersList = EngineBase::providers();
+    bool allComplete = !providersList.isEmpty();
     for (const QSharedPointer<KNSCore::Provider> &p : providersList) {
+        allComplete = allComplete && p->isInitialized() && p->providesCompleteResults();
         if (p->isInitialized()) {
             if (d->currentRequest.filter == KNSCore::Provider::Installed) {
                 // when asking for installed entries, never use the cache
                 p->loadEntries(d->currentRequest);
             } else {
-                // take entries from cache until there are no more
-                KNSCore::Entry::List cacheEntries;
+                // take pages from cache until there are no more (they are shared with the cache, so this copies nothing)
+                QList<KNSCore::Entry::List> cachePages;
                 KNSCore::Entry::List lastCache = cache()->requestFromCache(d->currentRequest);
                 while (!lastCache.isEmpty()) {
                     qCDebug(KNEWSTUFFQUICK) << "From cache";
-                    cacheEntries << lastCache;
+                    cachePages << lastCache;
 
                     d->currentPage = d->currentRequest.page;
                     ++d->currentRequest.page;
@@ -317,18 +421,31 @@ void Engine::reloadEntries()
                     d->currentRequest.page = d->currentPage;
                 }
 
-                if (!cacheEntries.isEmpty()) {
-                    Q_EMIT signalEntriesLoaded(cacheEntries);
+                if (!cachePages.isEmpty()) {
+                    for (const KNSCore::Entry::List &page : std::as_const(cachePages)) {
+                        d->resultsIndex.add(page);
+                        Q_EMIT signalEntriesLoaded(page);
+                    }
                 } else {
                     qCDebug(KNEWSTUFFQUICK) << "From provider";
-                    p->loadEntries(d->currentRequest);
+                    if (!stream) {
+                        p->loadEntries(d->currentRequest);
+                    }
 
+                    ++d->indexPending;
                     ++d->numDataJobs;
                     updateStatus();
                 }
             }
+        } else if (isOffline() && d->currentRequest.filter == KNSCore::Provider::Installed) {
+            // The provider cannot be reached, but we know well enough what was installed from it
+            Q_EMIT signalEntriesLoaded(cache()->registryForProvider(p->id()));
         }
     }
+    d->indexUsable = allComplete;
+    if (stream) {
+        stream->fetch();
+    }
 }
 void Engine::addProvider(QSharedPointer<KNSCore::Provider> provider)
 {
@@ -340,6 +457,10 @@ void Engine::addProvider(QSharedPointer<KNSCore::Provider> provider)
         if (request.filter != KNSCore::Provider::Updates) {
             cache()->insertRequest(request, entries);
         }
+        if (request.page == 0 && request.sortMode == d->indexedRequest.sortMode && sameResults(request, d->indexedRequest)) {
+            d->resultsIndex.add(entries);
+            d->indexPending = qMax(0, d->indexPending - 1);
+        }
         Q_EMIT signalEntriesLoaded(entries);
 
         --d->numDataJobs;
@@ -356,6 +477,9 @@ void Engine::loadPreview(const KNSCore::Entry &entry, KNSCore::Entry::PreviewTyp
 {
     qCDebug(KNEWSTUFFQUICK) << "START  preview: " << entry.name() << type;
     auto l = new KNSCore::ImageLoader(entry, type, this);
+    if (const QSharedPointer<KNSCore::Provider> provider = EngineBase::provider(entry.providerId())) {
+        l->setMirrors(provider->mirrorsFor(QUrl(entry.previewUrl(type))));
+    }
     connect(l, &KNSCore::ImageLoader::signalPreviewLoaded, this, [this](const KNSCore::Entry &entry, KNSCore::Entry::PreviewType type) {
         qCDebug(KNEWSTUFFQUICK) << "FINISH preview: " << entry.name() << type;
         Q_EMIT signalEntryPreviewLoaded(entry, type);
@@ -14,6 +14,7 @@
 #include "entry.h"
 #include "errorcode.h"
 #include "provider.h"
+#include "resultsstream.h"
 #include "transaction.h"
 
 class EnginePrivate;
@@ -220,6 +221,7 @@ Q_SIGNALS:
     void entryPreviewLoaded(const KNSCore::Entry &, KNSCore::Entry::PreviewType);
 
     void signalEntriesLoaded(const KNSCore::Entry::List &entries); ///@internal
+    void signalSearchStarted(KNSCore::ResultsStream *stream); ///@internal
 private:
     bool init(const QString &configfile) override;
     void updateStatus() override;
@@ -227,6 +229,8 @@ private:
     Q_SIGNAL void signalEntryEvent(const KNSCore::Entry &entry, KNSCore::Entry::EntryEvent event);
     void registerTransaction(KNSCore::Transaction *transactions);
     void doRequest();
+    // Re-sort or narrow down the loaded results without asking the providers, if they are all there
+    bool reorderLocally();
     const std::unique_ptr<EnginePrivate> d;
 };
 
@@ -26,7 +26,7 @@ public:
     KNSCore::ItemsModel *model;
     Engine *engine;
 
-    QHash<QString, KNSCore::CommentsModel *> commentsModels;
+    QHash<KNSCore::EntryKey, KNSCore::CommentsModel *> commentsModels;
 
     bool initModel()
     {
@@ -43,6 +43,15 @@ public:
         q->connect(engine, &Engine::signalEntriesLoaded, model, [this](const KNSCore::Entry::List &entries) {
             model->slotEntriesLoaded(entries);
         });
+        // Searching for a term shows the matches we know about first, and takes back those the providers do not have
+        q->connect(engine, &Engine::signalSearchStarted, model, [this](KNSCore::ResultsStream *stream) {
+            q->connect(stream, &KNSCore::ResultsStream::entriesFound, model, &KNSCore::ItemsModel::slotEntriesLoaded);
+            q->connect(stream, &KNSCore::ResultsStream::entriesRemoved, model, [this](const KNSCore::Entry::List &entries) {
+                for (const KNSCore::Entry &entry : entries) {
+                    model->removeEntry(entry);
+                }
+            });
+        });
         q->connect(engine, &Engine::entryEvent, model, [this](const KNSCore::Entry &entry, KNSCore::Entry::EntryEvent event) {
             if (event == KNSCore::Entry::DetailsLoadedEvent && engine->filter() != KNSCore::Provider::Updates) {
                 model->slotEntriesLoaded(KNSCore::Entry::List{entry});
@@ -283,12 +292,12 @@ QVariant ItemsModel::data(const QModelIndex &index, int role) const
         }
         case CommentsModelRole: {
             KNSCore::CommentsModel *commentsModel{nullptr};
-            if (!d->commentsModels.contains(entry.uniqueId())) {
+            if (!d->commentsModels.contains(entry.key())) {
                 commentsModel = new KNSCore::CommentsModel(d->engine);
                 commentsModel->setEntry(entry);
-                d->commentsModels[entry.uniqueId()] = commentsModel;
+                d->commentsModels[entry.key()] = commentsModel;
             } else {
-                commentsModel = d->commentsModels[entry.uniqueId()];
+                commentsModel = d->commentsModels[entry.key()];
             }
             return QVariant::fromValue(commentsModel);
         }
@@ -12,12 +12,51 @@
 
 #include "xmlloader_p.h"
 
+#include <KLocalizedString>
+#include <QSharedPointer>
 #include <QTimer>
 #include <knewstuffcore_debug.h>
-#include <tagsfilterchecker.h>
 
 namespace KNSCore
 {
+// Feeds may link to their payloads and previews relative to where the feed itself lives
+static void resolveRelativeUrls(Entry &entry, const QUrl &feedUrl)
+{
+    if (!entry.payload().isEmpty() && QUrl(entry.payload()).isRelative()) {
+        entry.setPayload(feedUrl.resolved(QUrl(entry.payload())).toString());
+    }
+    for (int type = Entry::PreviewSmall1; type <= Entry::PreviewBig3; ++type) {
+        const QString preview = entry.previewUrl(Entry::PreviewType(type));
+        if (!preview.isEmpty() && QUrl(preview).isRelative()) {
+            entry.setPreviewUrl(feedUrl.resolved(QUrl(preview)).toString(), Entry::PreviewType(type));
+        }
+    }
+    QList<Entry::DownloadLinkInformation> links = entry.downloadLinkInformationList();
+    if (!links.isEmpty()) {
+        for (Entry::DownloadLinkInformation &link : links) {
+            if (!link.descriptionLink.isEmpty() && QUrl(link.descriptionLink).isRelative()) {
+                link.descriptionLink = feedUrl.resolved(QUrl(link.descriptionLink)).toString();
+            }
+        }
+        entry.clearDownloadLinkInformation();
+        for (const Entry::DownloadLinkInformation &link : std::as_const(links)) {
+            entry.appendDownloadLinkInformation(link);
+        }
+    }
+}
+
+// Feeds offering more than the one payload list all of them as download links, which point straight at the payload
+static QString payloadForLink(const Entry &entry, int linkId)
+{
+    const QList<Entry::DownloadLinkInformation> links = entry.downloadLinkInformationList();
+    for (const Entry::DownloadLinkInformation &link : links) {
+        if (link.id == linkId && !link.descriptionLink.isEmpty()) {
+            return link.descriptionLink;
+        }
+    }
+    return entry.payload();
+}
+
 StaticXmlProvider::StaticXmlProvider()
     : mInitialized(false)
 {
@@ -36,26 +75,18 @@ bool StaticXmlProvider::setProviderXML(const QDomElement &xmldata)
 
     mUploadUrl = QUrl(xmldata.attribute(QStringLiteral("uploadurl")));
     mNoUploadUrl = QUrl(xmldata.attribute(QStringLiteral("nouploadurl")));
+    mUpdateManifestUrl = QUrl(xmldata.attribute(QStringLiteral("updatemanifest")));
 
-    QString url = xmldata.attribute(QStringLiteral("downloadurl"));
-    if (!url.isEmpty()) {
-        mDownloadUrls.insert(QString(), QUrl(url));
-    }
-
-    url = xmldata.attribute(QStringLiteral("downloadurl-latest"));
-    if (!url.isEmpty()) {
-        mDownloadUrls.insert(QStringLiteral("latest"), QUrl(url));
-    }
-
-    url = xmldata.attribute(QStringLiteral("downloadurl-score"));
-    if (!url.isEmpty()) {
-        mDownloadUrls.insert(QStringLiteral("score"), QUrl(url));
-    }
-
-    url = xmldata.attribute(QStringLiteral("downloadurl-downloads"));
-    if (!url.isEmpty()) {
-        mDownloadUrls.insert(QStringLiteral("downloads"), QUrl(url));
-    }
+    // Each feed is made up of one or more shards, the first one of which may be given as an attribute
+    const auto addShard = [this](const QString &feed, const QString &url) {
+        if (!url.isEmpty()) {
+            mDownloadUrls[feed].append(QUrl(url));
+        }
+    };
+    addShard(QString(), xmldata.attribute(QStringLiteral("downloadurl")));
+    addShard(QStringLiteral("latest"), xmldata.attribute(QStringLiteral("downloadurl-latest")));
+    addShard(QStringLiteral("score"), xmldata.attribute(QStringLiteral("downloadurl-score")));
+    addShard(QStringLiteral("downloads"), xmldata.attribute(QStringLiteral("downloadurl-downloads")));
 
     // FIXME: this depends on freedesktop.org icon naming... introduce 'desktopicon'?
     QUrl iconurl(xmldata.attribute(QStringLiteral("icon")));
@@ -67,9 +98,17 @@ bool StaticXmlProvider::setProviderXML(const QDomElement &xmldata)
     QDomNode n;
     QLocale::Language systemLanguage = QLocale::system().language();
     QString firstName;
+    QList<QPair<QString, QUrl>> mirrors;
     for (n = xmldata.firstChild(); !n.isNull(); n = n.nextSibling()) {
         QDomElement e = n.toElement();
-        if (e.tagName() == QLatin1String("title")) {
+        if (e.tagName() == QLatin1String("downloadurl")) {
+            // <downloadurl sort="latest">...</downloadurl>, the sort attribute being empty for the default feed
+            addShard(e.attribute(QStringLiteral("sort")), e.text().trimmed());
+        } else if (e.tagName() == QLatin1String("mirror")) {
+            // <mirror prefix="https://example.org/">https://mirror.example.net/</mirror>, serving everything below
+            // the prefix (by default, wherever the feed is) just the same
+            mirrors << qMakePair(e.attribute(QStringLiteral("prefix")), QUrl(e.text().trimmed()));
+        } else if (e.tagName() == QLatin1String("title")) {
             const QString lang{e.attribute(QLatin1String("lang"))};
             bool useThisTitle{false};
             if (name().isEmpty() && lang.isEmpty()) {
@@ -113,9 +152,32 @@ bool StaticXmlProvider::setProviderXML(const QDomElement &xmldata)
         setWebsite(mNoUploadUrl);
     }
 
-    mId = mDownloadUrls[QString()].url();
-    if (mId.isEmpty()) {
-        mId = mDownloadUrls[mDownloadUrls.begin().key()].url();
+    mId = mDownloadUrls.value(QString()).value(0).url();
+    if (mId.isEmpty() && !mDownloadUrls.isEmpty()) {
+        mId = mDownloadUrls.first().value(0).url();
+    }
+    // Mirrors of other providers keep their id, so their entries are recognised as the same ones
+    if (xmldata.hasAttribute(QStringLiteral("id"))) {
+        mId = xmldata.attribute(QStringLiteral("id"));
+    }
+
+    // A feed only gets to name mirrors for what is on its own server, and those only apply to what we fetch for this provider
+    const QUrl feedUrl = mDownloadUrls.isEmpty() ? QUrl() : mDownloadUrls.first().value(0);
+    for (const auto &[prefix, mirror] : std::as_const(mirrors)) {
+        const QUrl prefixUrl = prefix.isEmpty() ? feedUrl.adjusted(QUrl::RemoveFilename) : QUrl(prefix);
+        if (!prefixUrl.isValid() || !mirror.isValid() || prefixUrl.isLocalFile() || prefixUrl.host().isEmpty()) {
+            continue;
+        }
+        if (prefixUrl.scheme() != feedUrl.scheme() || prefixUrl.host().compare(feedUrl.host(), Qt::CaseInsensitive) != 0) {
+            qCWarning(KNEWSTUFFCORE) << "Ignoring the mirror" << mirror << "of" << prefixUrl << "as it is not on the server of the feed" << feedUrl;
+            continue;
+        }
+        if (prefixUrl.scheme() == QLatin1String("https") && mirror.scheme() != QLatin1String("https")) {
+            qCWarning(KNEWSTUFFCORE) << "Ignoring the mirror" << mirror << "of" << prefixUrl << "as it is not served over https";
+            continue;
+        }
+        qCDebug(KNEWSTUFFCORE) << "Using" << mirror << "as a mirror of" << prefixUrl;
+        addMirror(prefixUrl, mirror);
     }
 
     QTimer::singleShot(0, this, &StaticXmlProvider::slotEmitProviderInitialized);
@@ -137,13 +199,13 @@ bool StaticXmlProvider::isInitialized() const
 void StaticXmlProvider::setCachedEntries(const KNSCore::Entry::List &cachedEntries)
 {
     qCDebug(KNEWSTUFFCORE) << "Set cached entries " << cachedEntries.size();
-    mCachedEntries.append(cachedEntries);
+    for (const Entry &entry : cachedEntries) {
+        mCachedEntries.insert(entry);
+    }
 }
 
 void StaticXmlProvider::loadEntries(const KNSCore::Provider::SearchRequest &request)
 {
-    mCurrentRequest = request;
-
     // static providers only have on page containing everything
     if (request.page > 0) {
         Q_EMIT loadingFinished(request, Entry::List());
@@ -160,62 +222,126 @@ void StaticXmlProvider::loadEntries(const KNSCore::Provider::SearchRequest &requ
         return;
     }
 
-    QUrl url = downloadUrl(request.sortMode);
-    if (!url.isEmpty()) {
-        // TODO first get the entries, then filter with searchString, finally emit the finished signal...
-        // FIXME: don't create an endless number of xmlloaders!
+    if (request.filter == Updates && mUpdateManifestUrl.isValid()) {
+        // Several requests may be underway at the same time, so each one is answered with what it asked for
         XmlLoader *loader = new XmlLoader(this);
-        connect(loader, &XmlLoader::signalLoaded, this, &StaticXmlProvider::slotFeedFileLoaded);
-        connect(loader, &XmlLoader::signalFailed, this, &StaticXmlProvider::slotFeedFailed);
-        loader->setFilter(request.filter);
-        loader->setSearchTerm(request.searchTerm);
-
-        mFeedLoaders.insert(request.sortMode, loader);
+        connect(loader, &XmlLoader::signalLoaded, this, [this, loader, request](const QDomDocument &doc) {
+            updateManifestLoaded(doc, loader->etag(), loader->lastModified(), request);
+        });
+        connect(loader, &XmlLoader::signalNotModified, this, [this, request]() {
+            qCDebug(KNEWSTUFFCORE) << "Update manifest" << mUpdateManifestUrl << "has not changed";
+            emitManifestUpdates(request);
+        });
+        connect(loader, &XmlLoader::signalFailed, this, [this, request]() {
+            Q_EMIT loadingFailed(request);
+        });
+        loader->setValidators(mUpdateManifestEtag, mUpdateManifestLastModified);
+        loader->setTransferTimeout(request.deadline);
+        // Only ids and versions, so cheap enough to ask for twice if the server is slow to respond
+        loader->setHedgingEnabled(true);
+        loader->setMirrors(mirrorsFor(mUpdateManifestUrl));
+        loader->load(mUpdateManifestUrl);
+        return;
+    }
 
-        loader->load(url);
+    const QList<QUrl> urls = downloadUrls(request.sortMode);
+    if (!urls.isEmpty()) {
+        // TODO first get the entries, then filter with searchString, finally emit the finished signal...
+        loadFeed(
+            urls,
+            request.deadline,
+            [this, request, urls](const QList<QDomDocument> &shards) {
+                Entry::List entries;
+                Entry::List unfiltered;
+                for (qsizetype i = 0; i < shards.count(); ++i) {
+                    entries << entriesFromFeed(shards.at(i), urls.at(i), request, &unfiltered);
+                }
+                // Changes to the tag filters can then be applied without loading the feed again
+                retainResults(request, unfiltered);
+                Q_EMIT loadingFinished(request, entries);
+            },
+            [this, request]() {
+                Q_EMIT loadingFailed(request);
+            });
     } else {
         Q_EMIT loadingFailed(request);
     }
 }
 
-QUrl StaticXmlProvider::downloadUrl(SortMode mode) const
+QList<QUrl> StaticXmlProvider::downloadUrls(SortMode mode) const
 {
-    QUrl url;
+    QList<QUrl> urls;
     switch (mode) {
     case Rating:
-        url = mDownloadUrls.value(QStringLiteral("score"));
+        urls = mDownloadUrls.value(QStringLiteral("score"));
         break;
     case Alphabetical:
-        url = mDownloadUrls.value(QString());
+        urls = mDownloadUrls.value(QString());
         break;
     case Newest:
-        url = mDownloadUrls.value(QStringLiteral("latest"));
+        urls = mDownloadUrls.value(QStringLiteral("latest"));
         break;
     case Downloads:
-        url = mDownloadUrls.value(QStringLiteral("downloads"));
+        urls = mDownloadUrls.value(QStringLiteral("downloads"));
         break;
     }
-    if (url.isEmpty()) {
-        url = mDownloadUrls.value(QString());
+    if (urls.isEmpty()) {
+        urls = mDownloadUrls.value(QString());
     }
-    return url;
+    return urls;
 }
 
-void StaticXmlProvider::slotFeedFileLoaded(const QDomDocument &doc)
+void StaticXmlProvider::loadFeed(const QList<QUrl> &shards,
+                                 int deadline,
+                                 const std::function<void(const QList<QDomDocument> &)> &loaded,
+                                 const std::function<void()> &failed)
 {
-    XmlLoader *loader = qobject_cast<KNSCore::XmlLoader *>(sender());
-    if (!loader) {
-        qWarning() << "Loader not found!";
-        Q_EMIT loadingFailed(mCurrentRequest);
-        return;
+    // All the shards are fetched and parsed at the same time, and handed on in the order they were given in once they are all there
+    struct FeedLoad {
+        QList<QDomDocument> shards;
+        qsizetype pending = 0;
+        bool failed = false;
+    };
+    auto feedLoad = QSharedPointer<FeedLoad>::create();
+    feedLoad->shards.resize(shards.count());
+    feedLoad->pending = shards.count();
+
+    for (qsizetype i = 0; i < shards.count(); ++i) {
+        XmlLoader *loader = new XmlLoader(this);
+        connect(loader, &XmlLoader::signalLoaded, this, [feedLoad, i, loaded](const QDomDocument &doc) {
+            if (feedLoad->failed) {
+                return;
+            }
+            feedLoad->shards[i] = doc;
+            if (--feedLoad->pending == 0) {
+                loaded(feedLoad->shards);
+            }
+        });
+        connect(loader, &XmlLoader::signalFailed, this, [feedLoad, failed]() {
+            if (!feedLoad->failed) {
+                feedLoad->failed = true;
+                failed();
+            }
+        });
+        // Not hedged: these are whole catalogues, and a second copy of one would mostly compete with the first
+        loader->setTransferTimeout(deadline);
+        // Feeds change whenever something is published, so we would rather not show week-old copies
+        loader->setLoadType(Revalidate);
+        loader->setParseInBackground(shards.count() > 1);
+        loader->setMirrors(mirrorsFor(shards.at(i)));
+        loader->load(shards.at(i));
     }
+}
 
+Entry::List StaticXmlProvider::entriesFromFeed(const QDomDocument &doc,
+                                               const QUrl &feedUrl,
+                                               const KNSCore::Provider::SearchRequest &request,
+                                               Entry::List *unfiltered)
+{
     // load all the entries from the domdocument given
-    Entry::List entries;
+    Entry::List feedEntries;
     QDomElement element;
 
-    TagsFilterChecker checker(tagFilter());
-    TagsFilterChecker downloadschecker(downloadTagFilter());
     element = doc.documentElement();
     QDomElement n;
     for (n = element.firstChildElement(); !n.isNull(); n = n.nextSiblingElement()) {
@@ -223,10 +349,12 @@ void StaticXmlProvider::slotFeedFileLoaded(const QDomDocument &doc)
         entry.setEntryXML(n.toElement());
         entry.setStatus(KNSCore::Entry::Downloadable);
         entry.setProviderId(mId);
+        resolveRelativeUrls(entry, feedUrl);
+        // we have the full details now, so payload links can come from here
+        mManifestUpdates.remove(entry.key());
 
-        int index = mCachedEntries.indexOf(entry);
-        if (index >= 0) {
-            Entry cacheEntry = mCachedEntries.takeAt(index);
+        if (mCachedEntries.contains(entry.key())) {
+            Entry cacheEntry = mCachedEntries.value(entry.key());
             // check if updateable
             if ((cacheEntry.status() == KNSCore::Entry::Installed)
                 && ((cacheEntry.version() != entry.version()) || (cacheEntry.releaseDate() != entry.releaseDate()))) {
@@ -240,68 +368,105 @@ void StaticXmlProvider::slotFeedFileLoaded(const QDomDocument &doc)
             }
             cacheEntry = entry;
         }
+        feedEntries << entry;
+    }
 
-        if (checker.filterAccepts(entry.tags())) {
-            bool filterAcceptsDownloads = true;
-            if (entry.downloadCount() > 0) {
-                const auto downloadInfoList = entry.downloadLinkInformationList();
-                for (const KNSCore::Entry::DownloadLinkInformation &dli : downloadInfoList) {
-                    if (downloadschecker.filterAccepts(dli.tags)) {
-                        filterAcceptsDownloads = true;
-                        break;
-                    }
-                }
-            }
-            if (filterAcceptsDownloads) {
-                mCachedEntries.append(entry);
-
-                if (searchIncludesEntry(entry)) {
-                    switch (loader->filter()) {
-                    case Installed:
-                        // This is dealth with in loadEntries separately
-                        Q_UNREACHABLE();
-                    case Updates:
-                        if (entry.status() == KNSCore::Entry::Updateable) {
-                            entries << entry;
-                        }
-                        break;
-                    case ExactEntryId:
-                        if (entry.uniqueId() == loader->searchTerm()) {
-                            entries << entry;
-                        }
-                        break;
-                    case None:
-                        entries << entry;
-                        break;
-                    }
-                }
-            } else {
-                qCDebug(KNEWSTUFFCORE) << "Filter has excluded" << entry.name() << "on download filter" << downloadTagFilter();
-            }
-        } else {
-            qCDebug(KNEWSTUFFCORE) << "Filter has excluded" << entry.name() << "on entry filter" << tagFilter();
+    // Entries the tag filters turn down are not known to us at all, as if they were not in the feed
+    QSet<EntryKey> accepted;
+    const Entry::List acceptedEntries = applyTagFilters(feedEntries);
+    for (const Entry &entry : acceptedEntries) {
+        accepted.insert(entry.key());
+        mCachedEntries.insert(entry);
+    }
+
+    Entry::List entries;
+    for (const Entry &entry : std::as_const(feedEntries)) {
+        if (!searchIncludesEntry(entry, request)) {
+            continue;
+        }
+        if (unfiltered) {
+            *unfiltered << entry;
+        }
+        if (accepted.contains(entry.key())) {
+            entries << entry;
         }
     }
-    Q_EMIT loadingFinished(mCurrentRequest, entries);
+    return entries;
 }
 
-void StaticXmlProvider::slotFeedFailed()
+void StaticXmlProvider::updateManifestLoaded(const QDomDocument &doc,
+                                             const QByteArray &etag,
+                                             const QByteArray &lastModified,
+                                             const KNSCore::Provider::SearchRequest &request)
 {
-    Q_EMIT loadingFailed(mCurrentRequest);
+    const QDomElement root = doc.documentElement();
+    if (root.tagName() != QLatin1String("updates")) {
+        qCWarning(KNEWSTUFFCORE) << "Update manifest" << mUpdateManifestUrl << "is not valid";
+        Q_EMIT loadingFailed(request);
+        return;
+    }
+
+    mUpdateManifest.clear();
+    for (QDomElement e = root.firstChildElement(QStringLiteral("entry")); !e.isNull(); e = e.nextSiblingElement(QStringLiteral("entry"))) {
+        ManifestEntry manifestEntry;
+        manifestEntry.version = e.attribute(QStringLiteral("version"));
+        manifestEntry.releaseDate = QDate::fromString(e.attribute(QStringLiteral("releasedate")), Qt::ISODate);
+        mUpdateManifest.insert(e.attribute(QStringLiteral("id")), manifestEntry);
+    }
+
+    mUpdateManifestEtag = etag;
+    mUpdateManifestLastModified = lastModified;
+    emitManifestUpdates(request);
 }
 
-bool StaticXmlProvider::searchIncludesEntry(const KNSCore::Entry &entry) const
+void StaticXmlProvider::emitManifestUpdates(const KNSCore::Provider::SearchRequest &request)
 {
-    if (mCurrentRequest.filter == Updates) {
+    // Same criteria as slotFeedFileLoaded uses: any change in version or release date is an update
+    Entry::List entries;
+    for (Entry entry : std::as_const(mCachedEntries)) {
+        if (entry.status() != KNSCore::Entry::Installed && entry.status() != KNSCore::Entry::Updateable) {
+            continue;
+        }
+        const auto manifestEntry = mUpdateManifest.constFind(entry.uniqueId());
+        if (manifestEntry == mUpdateManifest.constEnd()) {
+            continue;
+        }
+        if (manifestEntry->version != entry.version() || manifestEntry->releaseDate != entry.releaseDate()) {
+            entry.setStatus(KNSCore::Entry::Updateable);
+            entry.setUpdateVersion(manifestEntry->version);
+            entry.setUpdateReleaseDate(manifestEntry->releaseDate);
+            mManifestUpdates.insert(entry.key());
+            if (searchIncludesEntry(entry, request)) {
+                entries << entry;
+            }
+        }
+    }
+    Q_EMIT loadingFinished(request, entries);
+}
+
+bool StaticXmlProvider::searchIncludesEntry(const KNSCore::Entry &entry, const KNSCore::Provider::SearchRequest &request) const
+{
+    // Static feeds are not split up by category, so the categories of the request do not narrow anything down
+    switch (request.filter) {
+    case Installed:
+        // This is dealt with in loadEntries separately
+        Q_UNREACHABLE();
+    case Updates:
         if (entry.status() != KNSCore::Entry::Updateable) {
             return false;
         }
+        break;
+    case ExactEntryId:
+        // The search term is the id here, rather than something to look for in the name
+        return entry.uniqueId() == request.searchTerm;
+    case None:
+        break;
     }
 
-    if (mCurrentRequest.searchTerm.isEmpty()) {
+    if (request.searchTerm.isEmpty()) {
         return true;
     }
-    QString search = mCurrentRequest.searchTerm;
+    const QString &search = request.searchTerm;
     if (entry.name().contains(search, Qt::CaseInsensitive) || entry.summary().contains(search, Qt::CaseInsensitive)
         || entry.author().name().contains(search, Qt::CaseInsensitive)) {
         return true;
@@ -309,10 +474,63 @@ bool StaticXmlProvider::searchIncludesEntry(const KNSCore::Entry &entry) const
     return false;
 }
 
-void StaticXmlProvider::loadPayloadLink(const KNSCore::Entry &entry, int)
+void StaticXmlProvider::loadPayloadLink(const KNSCore::Entry &entry, int linkId)
 {
-    qCDebug(KNEWSTUFFCORE) << "Payload: " << entry.payload();
-    Q_EMIT payloadLinkLoaded(entry);
+    if (mManifestUpdates.contains(entry.key())) {
+        // The manifest only told us there is an update, where to get it is in the feed
+        const QList<QUrl> urls = downloadUrls(Alphabetical);
+        loadFeed(
+            urls,
+            0,
+            [this, entry, urls, linkId](const QList<QDomDocument> &shards) {
+                for (qsizetype i = 0; i < shards.count(); ++i) {
+                    for (QDomElement n = shards.at(i).documentElement().firstChildElement(); !n.isNull(); n = n.nextSiblingElement()) {
+                        Entry feedEntry;
+                        feedEntry.setEntryXML(n);
+                        feedEntry.setProviderId(mId);
+                        if (feedEntry.key() == entry.key()) {
+                            resolveRelativeUrls(feedEntry, urls.at(i));
+                            mManifestUpdates.remove(entry.key());
+                            Entry copy = entry;
+                            copy.setPayload(payloadForLink(feedEntry, linkId));
+                            qCDebug(KNEWSTUFFCORE) << "Payload: " << copy.payload();
+                            Q_EMIT payloadLinkLoaded(copy);
+                            return;
+                        }
+                    }
+                }
+                qCWarning(KNEWSTUFFCORE) << "Entry" << entry.uniqueId() << "is in the update manifest, but not in the feed";
+                Q_EMIT signalErrorCode(KNSCore::NetworkError, i18n("Could not find the update for %1.", entry.name()), QVariant());
+            },
+            [this, entry]() {
+                Q_EMIT signalErrorCode(KNSCore::NetworkError, i18n("Could not fetch the update for %1.", entry.name()), QVariant());
+            });
+        return;
+    }
+
+    Entry copy = entry;
+    copy.setPayload(payloadForLink(entry, linkId));
+    qCDebug(KNEWSTUFFCORE) << "Payload: " << copy.payload();
+    Q_EMIT payloadLinkLoaded(copy);
+}
+
+qint64 StaticXmlProvider::memoryUsage() const
+{
+    // Everything we hold on to is needed to keep track of the entries, so there is nothing to trim
+    qint64 size = 0;
+    for (const Entry &entry : std::as_const(mCachedEntries)) {
+        size += entry.memoryUsage();
+    }
+    for (auto it = mUpdateManifest.cbegin(); it != mUpdateManifest.cend(); ++it) {
+        size += (it.key().size() + it->version.size()) * sizeof(QChar) + sizeof(ManifestEntry);
+    }
+    return size;
+}
+
+bool StaticXmlProvider::providesCompleteResults() const
+{
+    // Everything is on the first page, and the feeds for the various sort modes only differ in their order
+    return true;
 }
 
 Entry::List StaticXmlProvider::installedEntries() const
@@ -10,9 +10,13 @@
 #ifndef KNEWSTUFF3_STATICXMLPROVIDER_P_H
 #define KNEWSTUFF3_STATICXMLPROVIDER_P_H
 
+#include "cachedentries_p.h"
 #include "provider.h"
 #include <QDomDocument>
 #include <QMap>
+#include <QSet>
+
+#include <functional>
 
 namespace KNSCore
 {
@@ -53,26 +57,44 @@ public:
 
     void loadEntries(const KNSCore::Provider::SearchRequest &request) override;
     void loadPayloadLink(const KNSCore::Entry &entry, int) override;
+    qint64 memoryUsage() const override;
+    bool providesCompleteResults() const override;
 
 private Q_SLOTS:
     void slotEmitProviderInitialized();
-    void slotFeedFileLoaded(const QDomDocument &);
-    void slotFeedFailed();
 
 private:
-    bool searchIncludesEntry(const Entry &entry) const;
-    QUrl downloadUrl(SortMode mode) const;
+    bool searchIncludesEntry(const Entry &entry, const KNSCore::Provider::SearchRequest &request) const;
+    QList<QUrl> downloadUrls(SortMode mode) const;
+    void loadFeed(const QList<QUrl> &shards,
+                  int deadline,
+                  const std::function<void(const QList<QDomDocument> &)> &loaded,
+                  const std::function<void()> &failed);
+    Entry::List entriesFromFeed(const QDomDocument &doc, const QUrl &feedUrl, const Provider::SearchRequest &request, Entry::List *unfiltered = nullptr);
     Entry::List installedEntries() const;
+    void updateManifestLoaded(const QDomDocument &doc, const QByteArray &etag, const QByteArray &lastModified, const KNSCore::Provider::SearchRequest &request);
+    void emitManifestUpdates(const KNSCore::Provider::SearchRequest &request);
 
-    // map of download urls to their feed name
-    QMap<QString, QUrl> mDownloadUrls;
+    // map of feed names to the download urls of their shards
+    QMap<QString, QList<QUrl>> mDownloadUrls;
     QUrl mUploadUrl;
     QUrl mNoUploadUrl;
 
+    // The optional update manifest: a compact list of the id, version and release date of every entry,
+    // which lets us check for updates without fetching the whole feed
+    struct ManifestEntry {
+        QString version;
+        QDate releaseDate;
+    };
+    QUrl mUpdateManifestUrl;
+    QHash<QString, ManifestEntry> mUpdateManifest;
+    QByteArray mUpdateManifestEtag;
+    QByteArray mUpdateManifestLastModified;
+    // installed entries the manifest says have an update, but which we have not seen in the feed
+    QSet<EntryKey> mManifestUpdates;
+
     // cache of all entries known from this provider so far, mapped by their id
-    Entry::List mCachedEntries;
-    QMap<Provider::SortMode, XmlLoader *> mFeedLoaders;
-    Provider::SearchRequest mCurrentRequest;
+    CachedEntries mCachedEntries;
     QString mId;
     bool mInitialized;
 
@@ -0,0 +1,51 @@
+/*
+    SPDX-FileCopyrightText: 2024 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include <KLocalizedString>
+#include <KNSCore/MirrorBuilder>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("knewstuff-mirror"));
+    QCoreApplication::setApplicationVersion(QStringLiteral("1.0"));
+    QCoreApplication::setOrganizationDomain(QStringLiteral("kde.org"));
+    KLocalizedString::setApplicationDomain("knewstuff-mirror");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(i18n("Copies everything offered through a KNSRC file into a directory, which can then be used in its place "
+                                          "by setting the Mirror key of the KNSRC file to the path of the directory."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("knsrcfile"), i18n("The KNSRC file whose providers should be mirrored"));
+    parser.addPositionalArgument(QStringLiteral("directory"), i18n("The directory to write the mirror to"));
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 2) {
+        parser.showHelp(1);
+    }
+
+    KNSCore::MirrorBuilder builder;
+    QObject::connect(&builder, &KNSCore::EngineBase::signalMessage, &app, [](const QString &message) {
+        qInfo().noquote() << message;
+    });
+    QObject::connect(&builder, &KNSCore::EngineBase::signalErrorCode, &app, [](const KNSCore::ErrorCode &, const QString &message) {
+        qWarning().noquote() << message;
+    });
+    QObject::connect(&builder, &KNSCore::MirrorBuilder::finished, &app, [&builder](bool success) {
+        qInfo().noquote() << i18n("Mirrored %1 entries, %2 could not be mirrored.", builder.mirroredEntries(), builder.failedEntries());
+        QCoreApplication::exit(success ? 0 : 1);
+    });
+
+    if (!builder.init(parser.positionalArguments().at(0))) {
+        return 1;
+    }
+    builder.build(parser.positionalArguments().at(1));
+
+    return app.exec();
+}
@@ -7,17 +7,34 @@
 
 #include "action.h"
 
+#include "core/enginewarmup_p.h"
 #include "dialog.h"
 #include <KAuthorized>
 #include <KLocalizedString>
 
+// Give the application some time to finish starting up before doing anything
+static const int WARM_UP_DELAY{5000};
+
 namespace KNSWidgets
 {
 class ActionPrivate
 {
 public:
+    KNSCore::EngineWarmUp *warmUp()
+    {
+        if (!warmUpEnabled || dialog || configFile.isEmpty() || !KAuthorized::authorize(KAuthorized::GHNS)) {
+            return nullptr;
+        }
+        if (!engineWarmUp) {
+            engineWarmUp.reset(new KNSCore::EngineWarmUp(configFile));
+        }
+        return engineWarmUp.get();
+    }
+
     QString configFile;
     std::unique_ptr<Dialog> dialog;
+    bool warmUpEnabled = false;
+    std::unique_ptr<KNSCore::EngineWarmUp> engineWarmUp;
 };
 
 Action::Action(const QString &text, const QString &configFile, QObject *parent)
@@ -52,9 +69,30 @@ Action::Action(const QString &text, const QString &configFile, QObject *parent)
         }
         d->dialog->open();
     });
+    connect(this, &QAction::hovered, this, [this]() {
+        // Hovering is the best hint we get that the action is about to be triggered
+        if (KNSCore::EngineWarmUp *warmUp = d->warmUp()) {
+            warmUp->start();
+        }
+    });
 }
 
 Action::~Action() = default;
+
+void Action::setWarmUpEnabled(bool enabled)
+{
+    d->warmUpEnabled = enabled;
+    if (!enabled) {
+        d->engineWarmUp.reset();
+    } else if (KNSCore::EngineWarmUp *warmUp = d->warmUp()) {
+        warmUp->schedule(WARM_UP_DELAY);
+    }
+}
+
+bool Action::warmUpEnabled() const
+{
+    return d->warmUpEnabled;
+}
 }
 
 #include "moc_action.cpp"
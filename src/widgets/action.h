@@ -42,6 +42,17 @@ public:
 
     ~Action();
 
+    /**
+     * Whether to get ready for the dialog ahead of time, by loading the providers and the first
+     * page of entries in the background a little while after this is called, and right away when
+     * the action is hovered. This makes the dialog come up with content, at the cost of some
+     * network traffic for users who never trigger the action. Off by default.
+     *
+     * @since 6.0
+     */
+    void setWarmUpEnabled(bool enabled);
+    bool warmUpEnabled() const;
+
 Q_SIGNALS:
     /**
      * Emitted when the dialog has been closed.
@@ -7,6 +7,7 @@
 
 #include "button.h"
 
+#include "core/enginewarmup_p.h"
 #include "dialog.h"
 #include <KAuthorized>
 #include <KLocalizedString>
@@ -14,6 +15,9 @@
 
 #include <QPointer>
 
+// Give the window the button is in some time to finish showing up before doing anything
+static const int WARM_UP_DELAY{3000};
+
 namespace KNSWidgets
 {
 class ButtonPrivate
@@ -42,9 +46,22 @@ public:
         dialog->open();
     }
 
+    KNSCore::EngineWarmUp *warmUp()
+    {
+        if (!warmUpEnabled || dialog || configFile.isEmpty() || !KAuthorized::authorize(KAuthorized::GHNS)) {
+            return nullptr;
+        }
+        if (!engineWarmUp) {
+            engineWarmUp.reset(new KNSCore::EngineWarmUp(configFile));
+        }
+        return engineWarmUp.get();
+    }
+
     Button *q;
     QString configFile;
     std::unique_ptr<KNSWidgets::Dialog> dialog;
+    bool warmUpEnabled = false;
+    std::unique_ptr<KNSCore::EngineWarmUp> engineWarmUp;
 };
 
 Button::Button(const QString &text, const QString &configFile, QWidget *parent)
@@ -77,6 +94,41 @@ void Button::setConfigFile(const QString &configFile)
 {
     Q_ASSERT_X(!d->dialog, Q_FUNC_INFO, "the configFile property must be set before the dialog is first shown");
     d->configFile = configFile;
+    d->engineWarmUp.reset();
+}
+
+void Button::setWarmUpEnabled(bool enabled)
+{
+    d->warmUpEnabled = enabled;
+    if (!enabled) {
+        d->engineWarmUp.reset();
+    } else if (isVisible()) {
+        if (KNSCore::EngineWarmUp *warmUp = d->warmUp()) {
+            warmUp->schedule(WARM_UP_DELAY);
+        }
+    }
+}
+
+bool Button::warmUpEnabled() const
+{
+    return d->warmUpEnabled;
+}
+
+void Button::showEvent(QShowEvent *event)
+{
+    QPushButton::showEvent(event);
+    if (KNSCore::EngineWarmUp *warmUp = d->warmUp()) {
+        warmUp->schedule(WARM_UP_DELAY);
+    }
+}
+
+void Button::enterEvent(QEnterEvent *event)
+{
+    QPushButton::enterEvent(event);
+    // Hovering is the best hint we get that the button is about to be clicked
+    if (KNSCore::EngineWarmUp *warmUp = d->warmUp()) {
+        warmUp->start();
+    }
 }
 }
 
@@ -55,12 +55,27 @@ public:
      */
     void setConfigFile(const QString &configFile);
 
+    /**
+     * Whether to get ready for the dialog ahead of time, by loading the providers and the first
+     * page of entries in the background shortly after the button is shown, and right away when
+     * it is hovered. This makes the dialog come up with content, at the cost of some network
+     * traffic for users who never click the button. Off by default.
+     *
+     * @since 6.0
+     */
+    void setWarmUpEnabled(bool enabled);
+    bool warmUpEnabled() const;
+
 Q_SIGNALS:
     /**
      * emitted when the dialog has been closed
      */
     void dialogFinished(const QList<KNSCore::Entry> &changedEntries);
 
+protected:
+    void showEvent(QShowEvent *event) override;
+    void enterEvent(QEnterEvent *event) override;
+
 private:
     const std::unique_ptr<ButtonPrivate> d;
 };